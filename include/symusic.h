@@ -14,6 +14,18 @@
 #include "symusic/conversion.h"
 #include "symusic/pianoroll.h"
 #include "symusic/soa.h"
+#include "symusic/compact.h"
+#include "symusic/interval.h"
+#include "symusic/pipeline.h"
+#include "symusic/field.h"
+#include "symusic/predicate.h"
+#include "symusic/sort_key.h"
+#include "symusic/time_warp.h"
+#include "symusic/concat.h"
+#include "symusic/tempo_map.h"
+#include "symusic/beat_grid.h"
+#include "symusic/segment.h"
+#include "symusic/parallel.h"
 
 #include "symusic/io/common.h"
 #include "symusic/io/midi.h"
@@ -0,0 +1,105 @@
+#pragma once
+
+#ifndef LIBSYMUSIC_BEAT_GRID_H
+#define LIBSYMUSIC_BEAT_GRID_H
+
+#include <span>
+#include "symusic/mtype.h"
+#include "symusic/score.h"
+
+namespace symusic {
+
+/*
+ *  BeatGrid is the bar and beat grid of a score, computed once from its time signatures (and
+ *  its tempos for Second scores) and queried any number of times.
+ *  A bar of n/d has n beats of a 1/d note. The first bar starts at time 0 in the time signature
+ *  in effect there (4/4 if there is none), and each time signature starting in the middle of a
+ *  bar cuts it short and starts a new bar. Before time 0 and after the last time signature, the
+ *  grid is extended with the time signature in effect there.
+ *  The grid is built in quarter notes and mapped to the unit of the score, which is linear for
+ *  Tick and Quarter, and follows the tempos for Second (500000 mspq before the first tempo).
+ *  locate maps a time to (bar, beat, position), counted from 0, where position in [0, 1) is the
+ *  fraction of the beat elapsed, in quarter notes, so it's still musical for Second scores.
+ *  The grid is a snapshot: rebuild it after the time signatures or tempos are modified.
+ *  Score::beat_grid() caches the grid of a score until it's no longer a match (see matches).
+ */
+template<TType T>
+class BeatGrid {
+public:
+    typedef T                ttype;
+    typedef typename T::unit unit;
+
+    struct Position {
+        i32 bar;
+        i32 beat;
+        f64 position;
+    };
+
+    // results of batched queries, one for each time
+    struct Batch {
+        vec<i32> bars;
+        vec<i32> beats;
+        vec<f64> positions;
+    };
+
+    // the grid until the end of the score
+    explicit BeatGrid(const Score<T>& score) : BeatGrid(score, score.end()) {}
+
+    // the grid until end, beats and downbeats are the ones in [0, end]
+    BeatGrid(const Score<T>& score, unit end);
+
+    // true if the grid is built until end from exactly these time signatures, and the
+    // ticks_per_quarter (for Tick) or tempos (for Second) it depends on
+    [[nodiscard]] bool matches(const Score<T>& score, unit end) const;
+
+    // heap memory held by the grid, including the object itself, in bytes
+    [[nodiscard]] size_t memory_usage() const;
+
+    // times of the beats in [0, end]
+    [[nodiscard]] const vec<unit>& beats() const { return beat_times; }
+
+    // times of the downbeats (the first beats of the bars) in [0, end]
+    [[nodiscard]] const vec<unit>& downbeats() const { return downbeat_times; }
+
+    // start of any bar, including the ones out of [0, end]
+    [[nodiscard]] unit downbeat(i64 bar) const;
+
+    [[nodiscard]] Position locate(unit time) const;
+
+    // locate each time, sorted times are located in one walk over the grid
+    [[nodiscard]] Batch locate(std::span<const unit> times) const;
+
+private:
+    // what the grid is built from, checked by matches
+    unit                  grid_end;
+    i32                   tpq;
+    vec<TimeSignature<T>> signature_source;
+    vec<Tempo<T>>         tempo_source;   // only for Second
+
+    // piecewise linear map from the time of the score to quarters,
+    // quarters = pivot_quarters[i] + (time - pivot_times[i]) * rates[i] after the i-th pivot
+    vec<f64> pivot_times;
+    vec<f64> pivot_quarters;
+    vec<f64> rates;
+
+    // the grid in quarters, until the first downbeat after both end and the last time signature
+    vec<f64> beat_quarters;
+    vec<i32> beat_bars;    // bar of each beat
+    vec<u32> bar_firsts;   // first beat of each bar
+    // the beat length (in quarters) and beats per bar before 0 and after the grid
+    f64 head_length = 1, tail_length = 1;
+    i32 head_beats = 4, tail_beats = 4;
+
+    vec<unit> beat_times;
+    vec<unit> downbeat_times;
+
+    [[nodiscard]] f64 to_quarters(unit time) const;
+
+    [[nodiscard]] unit from_quarters(f64 quarters) const;
+
+    [[nodiscard]] Position locate_quarters(f64 quarters, size_t& hint) const;
+};
+
+}   // namespace symusic
+
+#endif   // LIBSYMUSIC_BEAT_GRID_H
@@ -0,0 +1,117 @@
+#pragma once
+
+#ifndef LIBSYMUSIC_COMPACT_H
+#define LIBSYMUSIC_COMPACT_H
+
+#include "symusic/mtype.h"
+#include "symusic/event.h"
+#include "symusic/track.h"
+
+namespace symusic {
+
+/*
+ *  CompactNotes is a read-only, compressed storage of notes, designed for holding large corpora
+ *  in memory. Notes are split into blocks of `block_size` notes, and each block is encoded as:
+ *  - onsets:    delta coded against the previous note (the first one against the block base),
+ *               written as zigzag varints of the order preserving integer form of the time
+ *  - durations: zigzag varints for Tick, raw 4 bytes for Quarter and Second
+ *  - pitch and velocity: packed into 14 bits per note if all of them lie in [0, 128),
+ *               otherwise stored as 2 raw bytes
+ *  A block index is kept, so that any block could be decoded independently (random access),
+ *  while decoding all the blocks in order gives a fast sequential scan.
+ */
+template<TType T>
+class CompactNotes {
+public:
+    typedef T                ttype;
+    typedef typename T::unit unit;
+
+    CompactNotes() = default;
+
+    explicit CompactNotes(const vec<Note<T>>& notes, size_t block_size = 128);
+
+    explicit CompactNotes(const pyvec<Note<T>>& notes, size_t block_size = 128);
+
+    // number of notes
+    [[nodiscard]] size_t size() const { return num; }
+
+    [[nodiscard]] bool empty() const { return num == 0; }
+
+    [[nodiscard]] size_t block_size() const { return blk_size; }
+
+    [[nodiscard]] size_t block_num() const { return blocks.size(); }
+
+    // heap memory used by the encoded data and the block index
+    [[nodiscard]] size_t nbytes() const;
+
+    // decode the b-th block, and append the notes to out
+    void decode_block(size_t b, vec<Note<T>>& out) const;
+
+    [[nodiscard]] vec<Note<T>> decode_block(size_t b) const;
+
+    // decode the notes in [begin, end), only the blocks covering the range are touched
+    [[nodiscard]] vec<Note<T>> decode_range(size_t begin, size_t end) const;
+
+    // decode all the notes sequentially
+    [[nodiscard]] vec<Note<T>> decode() const;
+
+    // random access, decodes the block containing the i-th note
+    [[nodiscard]] Note<T> at(size_t i) const;
+
+    bool operator==(const CompactNotes& other) const = default;
+
+private:
+    struct Block {
+        unit base;       // onset of the first note in the block
+        u32  offset;     // byte offset of the block in data
+        u32  pv_offset;  // byte offset of the pitch & velocity section in data
+        bool packed;     // whether pitch & velocity are packed in 14 bits
+
+        bool operator==(const Block& other) const = default;
+    };
+
+    size_t     num      = 0;
+    size_t     blk_size = 128;
+    vec<Block> blocks;
+    vec<u8>    data;
+
+    void encode(std::span<const Note<T>> notes);
+};
+
+/*
+ *  CompactTrack is a read-only backing of Track, with the notes stored in CompactNotes.
+ *  The other event lists are usually much shorter than notes, so they are kept as they are.
+ *  Use to_track() to materialize a normal Track when it is actually needed.
+ */
+template<TType T>
+struct CompactTrack {
+    typedef T                ttype;
+    typedef typename T::unit unit;
+
+    std::string           name;
+    u8                    program = 0;
+    bool                  is_drum = false;
+    CompactNotes<T>       notes;
+    vec<ControlChange<T>> controls;
+    vec<PitchBend<T>>     pitch_bends;
+    vec<Pedal<T>>         pedals;
+    vec<TextMeta<T>>      lyrics;
+
+    CompactTrack() = default;
+
+    explicit CompactTrack(const Track<T>& track, size_t block_size = 128);
+
+    [[nodiscard]] size_t note_num() const { return notes.size(); }
+
+    // heap memory used by the compact track
+    [[nodiscard]] size_t nbytes() const;
+
+    // materialize a normal Track
+    [[nodiscard]] Track<T> to_track() const;
+
+    bool operator==(const CompactTrack& other) const = default;
+};
+
+}   // namespace symusic
+
+#endif   // LIBSYMUSIC_COMPACT_H
@@ -0,0 +1,38 @@
+#pragma once
+
+#ifndef LIBSYMUSIC_CONCAT_H
+#define LIBSYMUSIC_CONCAT_H
+
+#include <span>
+#include "symusic/mtype.h"
+#include "symusic/score.h"
+
+namespace symusic::ops {
+
+/*
+ *  Concatenate scores one after another, each starting gap after the end of the previous one.
+ *  - The result takes the ticks_per_quarter of the first score, and Tick scores of other tpq are
+ *    resampled to it first. Quarter and Second times don't depend on tpq.
+ *  - Tracks are matched by (program, is_drum): the k-th track of a (program, is_drum) in each
+ *    score goes to the same track, named after the first one seen.
+ *  - Tempo, time signature and key signature maps are reconciled: at the start of each score,
+ *    the one in effect there (the default 120 qpm and 4/4 if there is none) is inserted when it
+ *    differs from the one in effect in the result so far, so that each score keeps its own maps.
+ *  The sizes of all the output lists are counted first, so each of them is allocated once.
+ */
+template<TType T>
+Score<T> concat(std::span<const shared<Score<T>>> scores, typename T::unit gap = 0);
+
+/*
+ *  Insert other into score at time at: the events of score starting at or after at are delayed
+ *  by the length (end) of other, and other is placed at at. Tracks and maps are merged as in
+ *  concat, and the maps of score in effect at at are restored after other.
+ *  Notes of score starting before at are kept as they are, even if they end after at.
+ *  For Tick scores of different tpq, other is resampled to the tpq of score.
+ */
+template<TType T>
+Score<T> splice(const Score<T>& score, typename T::unit at, const Score<T>& other);
+
+}   // namespace symusic::ops
+
+#endif   // LIBSYMUSIC_CONCAT_H
@@ -8,16 +8,57 @@
 
 #include "symusic/time_unit.h"
 #include "symusic/score.h"
+#include "symusic/tempo_map.h"
+#include "symusic/parallel.h"
 
 namespace symusic {
 
 template<TType To, TType From>
 Score<To> convert(
-    const Score<From>& score, typename To::unit min_dur = static_cast<typename To::unit>(0)
+    const Score<From>& score,
+    typename To::unit  min_dur = static_cast<typename To::unit>(0),
+    ExecPolicy         policy  = ExecPolicy::SEQUENTIAL
 );
 
+// convert a single track, following the tempo map of its score, e.g. score.tempo_map()
+template<TType To, TType From>
+Track<To> convert(
+    const Track<From>&    track,
+    const TempoMap<From>& tempo_map,
+    typename To::unit     min_dur = static_cast<typename To::unit>(0)
+);
+
+// convert only the events in [start, end) (in the unit of From), the same as converting
+// score.clip(start, end), except that the times still follow all the tempos of the score
+template<TType To, TType From>
+Score<To> convert(
+    const Score<From>&  score,
+    typename From::unit start,
+    typename From::unit end,
+    typename To::unit   min_dur = static_cast<typename To::unit>(0),
+    ExecPolicy          policy  = ExecPolicy::SEQUENTIAL
+);
+
+// resample to tpq ticks per quarter, the times are rounded half away from zero.
+// Tick scores are scaled exactly in integers, and Quarter or Second scores are converted to the
+// new ticks directly, without converting to the ticks of the score first
 template<TType T>
-Score<Tick> resample(const Score<T>& score, i32 tpq, Tick::unit min_dur = 0);
+Score<Tick> resample(
+    const Score<T>& score,
+    i32             tpq,
+    Tick::unit      min_dur = 0,
+    ExecPolicy      policy  = ExecPolicy::SEQUENTIAL
+);
+
+// the same as resample, but modify the score in place, so no new score is allocated.
+// Only the lists shared with copies of the score are copied. If the new times overflow int32,
+// std::overflow_error is thrown before the score is modified
+void resample_inplace(
+    Score<Tick>& score,
+    i32          tpq,
+    Tick::unit   min_dur = 0,
+    ExecPolicy   policy  = ExecPolicy::SEQUENTIAL
+);
 
 template<TType T>
 Score<T> to_shared(ScoreNative<T>&& score);
@@ -35,27 +76,40 @@ TrackNative<T> to_native(const Track<T>& track);
  *  Conversion between shared and native
  */
 
+namespace details {
+// release the capacity reserved (e.g. during parsing) if it's far more than needed
+template<typename T>
+vec<T>&& trim(vec<T>& data) {
+    if (data.capacity() > data.size() + data.size() / 2) data.shrink_to_fit();
+    return std::move(data);
+}
+}   // namespace details
+
 template<TType T>
 Track<T> to_shared(TrackNative<T>&& track) {
-    Track<T> new_track{std::move(track.name), track.program, track.is_drum};
-    new_track.notes       = std::make_shared<pyvec<Note<T>>>(std::move(track.notes));
-    new_track.controls    = std::make_shared<pyvec<ControlChange<T>>>(std::move(track.controls));
-    new_track.pedals      = std::make_shared<pyvec<Pedal<T>>>(std::move(track.pedals));
-    new_track.pitch_bends = std::make_shared<pyvec<PitchBend<T>>>(std::move(track.pitch_bends));
-    new_track.lyrics      = std::make_shared<pyvec<TextMeta<T>>>(std::move(track.lyrics));
-    return new_track;
+    return {
+        std::move(track.name),
+        track.program,
+        track.is_drum,
+        details::trim(track.notes),
+        details::trim(track.controls),
+        details::trim(track.pitch_bends),
+        details::trim(track.pedals),
+        details::trim(track.lyrics)
+    };
 }
 
 template<TType T>
 Score<T> to_shared(ScoreNative<T>&& score) {
-    Score<T> new_score{score.ticks_per_quarter};
-    new_score.tempos  = std::make_shared<pyvec<Tempo<T>>>(std::move(score.tempos));
-    // new_score.lyrics  = std::make_shared<pyvec<TextMeta<T>>>(std::move(score.lyrics));
-    new_score.markers = std::make_shared<pyvec<TextMeta<T>>>(std::move(score.markers));
-    new_score.time_signatures
-        = std::make_shared<pyvec<TimeSignature<T>>>(std::move(score.time_signatures));
-    new_score.key_signatures
-        = std::make_shared<pyvec<KeySignature<T>>>(std::move(score.key_signatures));
+    Score<T> new_score{
+        score.ticks_per_quarter,
+        std::make_shared<vec<shared<Track<T>>>>(),
+        details::trim(score.time_signatures),
+        details::trim(score.key_signatures),
+        details::trim(score.tempos),
+        // details::trim(score.lyrics),
+        details::trim(score.markers)
+    };
     new_score.tracks->reserve(score.tracks.size());
     // clang-format off
     for (auto& track : score.tracks) {
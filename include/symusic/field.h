@@ -0,0 +1,107 @@
+#pragma once
+
+#ifndef LIBSYMUSIC_FIELD_H
+#define LIBSYMUSIC_FIELD_H
+
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include "symusic/mtype.h"
+#include "symusic/event.h"
+#include "symusic/track.h"
+
+namespace symusic {
+
+/*
+ *  Fields<E> lists the numeric fields of an event (or a track) that could be referred to by name,
+ *  e.g. in the predicate expressions of filter or the keys of sort.
+ *  - names:       the field names, in the order of their indices
+ *  - index(name): the index of a field, throws std::invalid_argument for unknown names
+ *  - visit(i, f): call f with a getter of the i-th field, i.e. `V getter(const E&)` where V is
+ *                 the type of the field, so that the loops inside f are specialized for each field
+ *  All the fields are exactly representable as f64.
+ */
+template<typename E>
+struct Fields;
+
+namespace details {
+template<size_t N>
+size_t field_index(const std::array<std::string_view, N>& names, const std::string_view name) {
+    for (size_t i = 0; i < N; ++i) {
+        if (names[i] == name) return i;
+    }
+    std::string msg = "symusic::Fields: unknown field \"" + std::string(name) + "\", expected one of";
+    for (const auto& n : names) msg += " " + std::string(n);
+    throw std::invalid_argument(msg);
+}
+}   // namespace details
+
+#define FIELD_NAME(NAME, TYPE, EXPR) #NAME,
+#define FIELD_COUNT(NAME, TYPE, EXPR) +1
+
+#define DEFINE_FIELDS(EVENT, LIST)                                                              \
+    template<TType T>                                                                           \
+    struct Fields<EVENT<T>> {                                                                   \
+        typedef EVENT<T>         self_t;                                                        \
+        typedef typename T::unit unit;                                                          \
+        static constexpr std::array<std::string_view, 0 LIST(FIELD_COUNT)> names{               \
+            LIST(FIELD_NAME)                                                                    \
+        };                                                                                      \
+        static size_t index(const std::string_view name) {                                      \
+            return details::field_index(names, name);                                           \
+        }                                                                                       \
+        template<typename F>                                                                    \
+        static decltype(auto) visit(const size_t field, F&& f) {                                \
+            size_t i = 0;                                                                       \
+            LIST(FIELD_VISIT)                                                                   \
+            throw std::out_of_range("symusic::Fields: field index out of range");               \
+        }                                                                                       \
+    };
+
+#define FIELD_VISIT(NAME, TYPE, EXPR) \
+    if (field == i++) return f([](const self_t& e) { return static_cast<TYPE>(EXPR); });
+
+// X(name, type, expression of the event e)
+#define NOTE_FIELDS(X)                                                                   \
+    X(time, unit, e.time) X(duration, unit, e.duration) X(end, unit, e.end())           \
+    X(pitch, i8, e.pitch) X(velocity, i8, e.velocity)
+#define PEDAL_FIELDS(X) X(time, unit, e.time) X(duration, unit, e.duration) X(end, unit, e.end())
+#define CONTROL_FIELDS(X) X(time, unit, e.time) X(number, u8, e.number) X(value, u8, e.value)
+#define TIMESIG_FIELDS(X) \
+    X(time, unit, e.time) X(numerator, u8, e.numerator) X(denominator, u8, e.denominator)
+#define KEYSIG_FIELDS(X) X(time, unit, e.time) X(key, i8, e.key) X(tonality, i8, e.tonality)
+#define TEMPO_FIELDS(X) X(time, unit, e.time) X(mspq, i32, e.mspq) X(qpm, f64, e.qpm())
+#define PITCHBEND_FIELDS(X) X(time, unit, e.time) X(value, i32, e.value)
+#define TEXTMETA_FIELDS(X) X(time, unit, e.time)
+#define TRACK_FIELDS(X)                                                                  \
+    X(program, u8, e.program) X(is_drum, bool, e.is_drum) X(note_num, u64, e.note_num()) \
+    X(start, unit, e.start()) X(end, unit, e.end())
+
+DEFINE_FIELDS(Note, NOTE_FIELDS)
+DEFINE_FIELDS(Pedal, PEDAL_FIELDS)
+DEFINE_FIELDS(ControlChange, CONTROL_FIELDS)
+DEFINE_FIELDS(TimeSignature, TIMESIG_FIELDS)
+DEFINE_FIELDS(KeySignature, KEYSIG_FIELDS)
+DEFINE_FIELDS(Tempo, TEMPO_FIELDS)
+DEFINE_FIELDS(PitchBend, PITCHBEND_FIELDS)
+DEFINE_FIELDS(TextMeta, TEXTMETA_FIELDS)
+DEFINE_FIELDS(Track, TRACK_FIELDS)
+
+#undef NOTE_FIELDS
+#undef PEDAL_FIELDS
+#undef CONTROL_FIELDS
+#undef TIMESIG_FIELDS
+#undef KEYSIG_FIELDS
+#undef TEMPO_FIELDS
+#undef PITCHBEND_FIELDS
+#undef TEXTMETA_FIELDS
+#undef TRACK_FIELDS
+#undef DEFINE_FIELDS
+#undef FIELD_VISIT
+#undef FIELD_COUNT
+#undef FIELD_NAME
+
+}   // namespace symusic
+
+#endif   // LIBSYMUSIC_FIELD_H
@@ -0,0 +1,74 @@
+#pragma once
+
+#ifndef LIBSYMUSIC_INTERVAL_H
+#define LIBSYMUSIC_INTERVAL_H
+
+#include <span>
+#include "symusic/mtype.h"
+#include "symusic/event.h"
+#include "symusic/track.h"
+
+namespace symusic {
+
+/*
+ *  IntervalIndex answers "which notes are sounding at t" and "which notes overlap [begin, end)"
+ *  in logarithmic time (plus the size of the answer), instead of scanning all the notes.
+ *  Notes are sorted by onset, and a segment tree over the sorted notes keeps the max offset of
+ *  each subtree, so that subtrees without any overlapping note are skipped.
+ *  A note occupies [start, start + duration), so notes with non-positive duration never overlap.
+ *  Results are indices into the original note list, in onset order.
+ *  The index is a snapshot: rebuild it after the notes are modified.
+ */
+template<TType T>
+class IntervalIndex {
+public:
+    typedef T                ttype;
+    typedef typename T::unit unit;
+
+    // results of batched queries in compressed sparse rows,
+    // i.e. the answer to the i-th query is indices[offsets[i]:offsets[i + 1]]
+    struct Batch {
+        vec<u64> offsets;
+        vec<u32> indices;
+    };
+
+    IntervalIndex() = default;
+
+    explicit IntervalIndex(const pyvec<Note<T>>& notes);
+
+    explicit IntervalIndex(const Track<T>& track) : IntervalIndex(*track.notes) {}
+
+    [[nodiscard]] size_t size() const { return starts.size(); }
+
+    [[nodiscard]] bool empty() const { return starts.empty(); }
+
+    // indices of the notes sounding at time t, i.e. start <= t < end
+    [[nodiscard]] vec<u32> at(unit t) const;
+
+    // indices of the notes overlapping [begin, end), i.e. start < end && begin < note end,
+    // among the notes with positive duration
+    [[nodiscard]] vec<u32> overlap(unit begin, unit end) const;
+
+    [[nodiscard]] Batch at_batch(std::span<const unit> times) const;
+
+    [[nodiscard]] Batch overlap_batch(
+        std::span<const unit> range_begins, std::span<const unit> range_ends
+    ) const;
+
+private:
+    vec<unit> starts;    // onsets of the notes, sorted
+    vec<unit> ends;      // offsets of the notes, in the same order as starts
+    vec<u32>  order;     // index of each sorted note in the original list
+    vec<unit> max_end;   // segment tree of the max offset, the root is max_end[1]
+    size_t    leaf_num = 0;
+
+    // append the notes among the first `limit` sorted ones, whose offset is greater than bound
+    void collect(size_t limit, unit bound, vec<u32>& out) const;
+
+    void collect(size_t node, size_t lo, size_t hi, size_t limit, unit bound, vec<u32>& out)
+        const;
+};
+
+}   // namespace symusic
+
+#endif   // LIBSYMUSIC_INTERVAL_H
@@ -0,0 +1,98 @@
+#pragma once
+
+#ifndef LIBSYMUSIC_MEMORY_H
+#define LIBSYMUSIC_MEMORY_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include "symusic/mtype.h"
+#include "symusic/event.h"
+
+namespace symusic {
+
+/*
+ *  Heap memory held by a Track or a Score, in bytes, broken down by the kind of the data.
+ *  The numbers are estimated from the capacities of the containers, so the slack reserved but
+ *  not used is included, and shrink_to_fit() lowers them: each event list is counted as its
+ *  element buffer and pointer array, and each allocated block of lists (the lists of a track
+ *  or a score share one, see TrackLists) as a whole, with its control block and the slots of
+ *  the lists moved out of it, once per owner. The tempo map and the beat grid cached by a
+ *  score are counted in other. Lists shared by copy-on-write copies are counted in every owner.
+ */
+struct MemoryUsage {
+    size_t notes           = 0;
+    size_t controls        = 0;
+    size_t pitch_bends     = 0;
+    size_t pedals          = 0;
+    size_t lyrics          = 0;
+    size_t time_signatures = 0;
+    size_t key_signatures  = 0;
+    size_t tempos          = 0;
+    size_t markers         = 0;
+    size_t other           = 0;   // track and score objects, names, track list, cached maps
+
+    [[nodiscard]] size_t total() const {
+        return notes + controls + pitch_bends + pedals + lyrics + time_signatures + key_signatures
+               + tempos + markers + other;
+    }
+
+    MemoryUsage& operator+=(const MemoryUsage& o) {
+        notes += o.notes;
+        controls += o.controls;
+        pitch_bends += o.pitch_bends;
+        pedals += o.pedals;
+        lyrics += o.lyrics;
+        time_signatures += o.time_signatures;
+        key_signatures += o.key_signatures;
+        tempos += o.tempos;
+        markers += o.markers;
+        other += o.other;
+        return *this;
+    }
+};
+
+namespace details {
+// a shared_ptr created by make_shared allocates the control block along with the object
+constexpr size_t control_block_size = sizeof(void*) + 2 * sizeof(i32);
+
+// heap memory of a string, zero if it's stored inside the object (small string optimization).
+// The addresses are compared as integers, since they point into unrelated objects
+inline size_t string_memory_usage(const std::string& str) {
+    const auto self = reinterpret_cast<std::uintptr_t>(&str);
+    const auto data = reinterpret_cast<std::uintptr_t>(str.data());
+    if (data >= self && data < self + sizeof(std::string)) return 0;
+    return str.capacity() + 1;
+}
+
+// the control blocks of the given lists, each distinct block counted once
+template<typename... L>
+size_t control_blocks_usage(const shared<L>&... lists) {
+    const std::array<shared<const void>, sizeof...(L)> owners{lists...};
+    size_t ans = 0;
+    for (size_t i = 0; i < owners.size(); ++i) {
+        bool seen = false;
+        for (size_t j = 0; j < i && !seen; ++j) {
+            seen = !owners[i].owner_before(owners[j]) && !owners[j].owner_before(owners[i]);
+        }
+        if (!seen) ans += control_block_size;
+    }
+    return ans;
+}
+}   // namespace details
+
+// heap memory held by an event list, including the text of TextMeta, but not its control block.
+// pyvec reserves its element buffer along with its pointer array, so both follow capacity()
+template<TimeEvent T>
+size_t memory_usage(const shared<pyvec<T>>& events) {
+    size_t ans = sizeof(pyvec<T>);
+    ans += events->capacity() * (sizeof(T) + sizeof(T*));
+    if constexpr (std::is_same_v<T, TextMeta<typename T::ttype>>) {
+        for (const auto& event : *events) ans += details::string_memory_usage(event.text);
+    }
+    return ans;
+}
+
+}   // namespace symusic
+
+#endif   // LIBSYMUSIC_MEMORY_H
@@ -8,10 +8,20 @@
 
 #include "symusic/event.h"
 #include "symusic/score.h"
+#include "symusic/time_warp.h"
+#include "symusic/field.h"
 #include "pdqsort.h"
 #include "pyvec.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <span>
 #include <stdexcept>
+#include <string>
 
 namespace symusic::ops {
 
@@ -95,10 +105,46 @@ void filter_inplace(vec<shared<T>>& data, Filter t_fiter) {
     data.resize(i);
 }
 
+namespace details {
+// index range of the events with start <= time < end (or time <= end if end_inclusive),
+// the events must be sorted by time
+template<TimeEvent T>
+std::pair<size_t, size_t> sorted_time_range(
+    const pyvec<T>&        events,
+    const typename T::unit start,
+    const typename T::unit end,
+    const bool             end_inclusive = false
+) {
+    const auto begin = events.cbegin();
+    const auto first
+        = std::partition_point(begin, events.cend(), [start](const T& e) { return e.time < start; });
+    const auto last = end_inclusive
+        ? std::partition_point(first, events.cend(), [end](const T& e) { return e.time <= end; })
+        : std::partition_point(first, events.cend(), [end](const T& e) { return e.time < end; });
+    return {static_cast<size_t>(first - begin), static_cast<size_t>(last - begin)};
+}
+}   // namespace details
+
+// If the events are known to be sorted by time, binary search is used to find the kept range,
+// and durations are assumed to be non-negative when clip_end is true
 template<TimeEvent T>
 void clip_inplace(
-    pyvec<T>& events, typename T::unit start, typename T::unit end, const bool clip_end = false
+    pyvec<T>&        events,
+    typename T::unit start,
+    typename T::unit end,
+    const bool       clip_end = false,
+    const bool       sorted   = false
 ) {
+    if (sorted) {
+        const bool by_end        = HashDuration<T> && clip_end;
+        const auto [first, last] = details::sorted_time_range(events, start, end, by_end);
+        events.resize(last);
+        events.erase(events.begin(), events.begin() + static_cast<ptrdiff_t>(first));
+        if constexpr (HashDuration<T>) {
+            if (clip_end) events.filter([end](const T& event) { return event.end() <= end; });
+        }
+        return;
+    }
     if constexpr (HashDuration<T>) {
         if (clip_end) {
             events.filter([start, end](const T& event) {
@@ -124,22 +170,85 @@ pyvec<T> clip(
     return ans;
 }
 
+// deep copy clip, only the kept events are copied
 template<TimeEvent T>
-void clip_with_sentinel_inplace(pyvec<T>& events, typename T::unit start, typename T::unit end) {
+pyvec<T> clip_copy(
+    const pyvec<T>&  events,
+    typename T::unit start,
+    typename T::unit end,
+    const bool       clip_end = false,
+    const bool       sorted   = false
+) {
+    vec<T> ans;
+    if (sorted) {
+        const bool by_end        = HashDuration<T> && clip_end;
+        const auto [first, last] = details::sorted_time_range(events, start, end, by_end);
+        ans.reserve(last - first);
+        for (size_t i = first; i < last; ++i) {
+            const T& event = events[i];
+            if constexpr (HashDuration<T>) {
+                if (clip_end && event.end() > end) continue;
+            }
+            ans.push_back(event);
+        }
+        return {std::move(ans)};
+    }
+    for (const T& event : events) {
+        bool keep = event.time >= start;
+        if constexpr (HashDuration<T>) {
+            keep &= clip_end ? event.end() <= end : event.time < end;
+        } else {
+            keep &= event.time < end;
+        }
+        if (keep) ans.push_back(event);
+    }
+    return {std::move(ans)};
+}
+
+template<TimeEvent T>
+void clip_with_sentinel_inplace(
+    pyvec<T>& events, typename T::unit start, typename T::unit end, const bool sorted = false
+) {
     if (events.empty()) return;
+    if (sorted) {
+        // keep the events in (start, end), and the first of the latest events before start
+        const auto [first, last] = details::sorted_time_range(events, start, end);
+        size_t kept_begin        = first;
+        while (kept_begin < last && events[kept_begin].time == start) ++kept_begin;
+        size_t sentinel = kept_begin;
+        if (sentinel > 0) {
+            const auto latest = events[sentinel - 1].time;
+            while (sentinel > 0 && events[sentinel - 1].time == latest) --sentinel;
+        }
+        const bool has_sentinel = kept_begin > 0;
+        T          sentinel_event{};
+        if (has_sentinel) {
+            sentinel_event      = events[sentinel];
+            sentinel_event.time = start;
+        }
+        events.resize(last);
+        events.erase(events.begin(), events.begin() + static_cast<ptrdiff_t>(kept_begin));
+        if (has_sentinel) events.insert(events.begin(), sentinel_event);
+        return;
+    }
 
-    T sentinel{};
-    sentinel.time = std::numeric_limits<typename T::unit>::min();
-    events.filter([start, end, &sentinel](const T& event) {
+    // numeric_limits::min() is the smallest positive value for floating point units,
+    // so track whether a sentinel is found instead of comparing to it
+    T    sentinel{};
+    bool found = false;
+    events.filter([start, end, &sentinel, &found](const T& event) {
         if (event.time <= start) {
-            if ((sentinel.time) < event.time) { sentinel = *event; }
+            if (!found || (sentinel.time) < event.time) {
+                sentinel = *event;
+                found    = true;
+            }
         } else if ((event.time) < end) {
             return true;
         }
         return false;
     });
 
-    if (sentinel.time != std::numeric_limits<typename T::unit>::min()) {
+    if (found) {
         sentinel.time = start;
         events.insert(events.begin(), sentinel);
     }
@@ -155,6 +264,27 @@ vec<shared<T>> clip_with_sentinel(
     return ans;
 }
 
+// deep copy version of clip_with_sentinel_inplace, only the kept events are copied if sorted
+template<TimeEvent T>
+pyvec<T> clip_with_sentinel_copy(
+    const pyvec<T>& events, typename T::unit start, typename T::unit end, const bool sorted = false
+) {
+    if (!sorted) {
+        auto ans = events.deepcopy();
+        clip_with_sentinel_inplace(ans, start, end);
+        return ans;
+    }
+    auto [first, last] = details::sorted_time_range(events, start, end);
+    // step back to the latest events before start, one of which is used as the sentinel
+    if (first > 0) {
+        const auto latest = events[first - 1].time;
+        while (first > 0 && events[first - 1].time == latest) --first;
+    }
+    const auto begin = events.cbegin();
+    pyvec<T>   ans(vec<T>(begin + static_cast<ptrdiff_t>(first), begin + static_cast<ptrdiff_t>(last)));
+    clip_with_sentinel_inplace(ans, start, end, true);
+    return ans;
+}
 
 // make sure T has time and duration fields using requires
 template<TimeEvent T>
@@ -177,157 +307,343 @@ vec<shared<T>> clamp_dur(
     return new_events;
 }
 
-namespace details {
+/*
+ *  Shift kernels. Events of a pyvec are reached through an array of pointers, so the loops below
+ *  are kept free of branches and function calls, leaving the compiler room to unroll them.
+ *  Pitch and velocity live in [0, 127]: without saturate, the range of the field is checked in a
+ *  read-only pass first, so that an overflow throws before any note is modified; with saturate,
+ *  the results are clamped into [0, 127].
+ */
 template<TimeEvent T>
-void adjust_time_inplace_inner(
-    pyvec<T>&                    events,
-    const vec<typename T::unit>& original_times,
-    const vec<typename T::unit>& new_times
-) {
-    using unit = typename T::unit;
-    // check if the events have duration
-    constexpr bool has_dur = HashDuration<T>;
-    auto           get_end = [has_dur](const T& event) {
-        if constexpr (has_dur) { return event.time + event.duration; }
-        return event.time;
-    };
-    // return empty vector if events is empty
-    if (events.empty()) return;
-    auto get_factor = [&original_times, &new_times](const size_t x) {
-        f64 factor = static_cast<f64>(new_times[x] - new_times[x - 1])
-               / static_cast<f64>(original_times[x] - original_times[x - 1]);
-        return factor;
-    };
+void shift_time_inplace(pyvec<T>& events, const typename T::unit offset) {
+    if (offset == 0) return;
+    for (auto& event : events) event.time += offset;
+}
 
-    const auto range = std::make_pair(original_times.front(), original_times.back());
+namespace details {
+// the minimum and maximum of pitch (or velocity) among the notes
+template<auto field, TType T>
+std::pair<i32, i32> field_range(const pyvec<Note<T>>& notes) {
+    i32 lo = std::numeric_limits<i32>::max();
+    i32 hi = std::numeric_limits<i32>::min();
+    for (const auto& note : notes) {
+        const i32 x = note.*field;
+        lo          = std::min(lo, x);
+        hi          = std::max(hi, x);
+    }
+    return {lo, hi};
+}
 
-    auto valid = [get_end, range](const T& event) {
-        return (event.time >= range.first) & (get_end(event) <= range.second);
-    };
+template<auto field, TType T>
+void check_shift(const pyvec<Note<T>>& notes, const i8 offset, const char* name) {
+    if (offset == 0 || notes.empty()) return;
+    const auto [lo, hi] = field_range<field>(notes);
+    if (lo + offset < 0 || hi + offset > 127) {
+        throw std::range_error(
+            std::string("symusic::shift_") + name + ": overflow while shifting " + name + " in ["
+            + std::to_string(lo) + ", " + std::to_string(hi) + "] by " + std::to_string(offset)
+        );
+    }
+}
 
-    auto cur_range  = std::make_pair(original_times[0], original_times[1]);
-    auto cur_factor = get_factor(1);
-    auto pivot_new  = new_times[0];
+inline i8 add_i8(const i8 x, const i8 offset, const bool saturate) {
+    const i32 ans = x + offset;
+    return static_cast<i8>(saturate ? std::clamp(ans, 0, 127) : ans);
+}
+}   // namespace details
 
-    size_t i = 0;
-    // clang-format off
-    for (size_t j = 0; j < events.size(); j++) {
-        T& event = events[j];
-        if (!valid(event)) continue;
-        if ((event.time) < cur_range.first | (event.time) > cur_range.second) {
-            auto idx = std::lower_bound(original_times.begin() + 1, original_times.end(), event.time)
-                - original_times.begin();
-            cur_factor = get_factor(idx);
-            cur_range  = std::make_pair(original_times[idx - 1], original_times[idx]);
-            pivot_new  = new_times[idx - 1];
+// shift time, pitch and velocity of the notes in one pass
+template<TType T>
+void shift_notes_inplace(
+    pyvec<Note<T>>&        notes,
+    const typename T::unit time,
+    const i8               pitch,
+    const i8               velocity,
+    const bool             saturate = false
+) {
+    if (!saturate) {
+        details::check_shift<&Note<T>::pitch>(notes, pitch, "pitch");
+        details::check_shift<&Note<T>::velocity>(notes, velocity, "velocity");
+    }
+    if (pitch == 0 && velocity == 0) return shift_time_inplace(notes, time);
+    for (auto& note : notes) {
+        note.time += time;
+        note.pitch    = details::add_i8(note.pitch, pitch, saturate);
+        note.velocity = details::add_i8(note.velocity, velocity, saturate);
+    }
+}
+
+// which ends of the notes and pedals are snapped to the grid by quantize
+enum class QuantizeMode : u8 { ONSET, OFFSET, BOTH };
+
+namespace details {
+// the grid points are k * grid, with the odd ones delayed by swing * grid. Each pair of grid
+// points is a period of 2 * grid, so a time is snapped by comparing its offset in the period
+// with the midpoints of the three candidates 0, (1 + swing) * grid and 2 * grid
+class QuantizeGrid {
+public:
+    QuantizeGrid(const f64 grid, const f64 swing) :
+        period{2 * grid}, odd{(1 + swing) * grid}, lo_mid{odd / 2}, hi_mid{(odd + period) / 2} {
+        if (!(grid > 0)) {
+            throw std::invalid_argument(
+                "symusic::quantize: grid should be positive, got " + std::to_string(grid)
+            );
+        }
+        if (!(swing >= 0 && swing < 1)) {
+            throw std::invalid_argument(
+                "symusic::quantize: swing should be in [0, 1), got " + std::to_string(swing)
+            );
+        }
+    }
+
+    template<typename unit>
+    unit operator()(const unit time) const {
+        const auto t      = static_cast<f64>(time);
+        const f64  base   = std::floor(t / period) * period;
+        const f64  offset = t - base;
+        const f64  ans    = base + (offset < lo_mid ? 0 : offset < hi_mid ? odd : period);
+        if constexpr (std::is_integral_v<unit>) {
+            return static_cast<unit>(std::llround(ans));
+        } else {
+            return static_cast<unit>(ans);
         }
-        unit start = pivot_new
-            + static_cast<typename T::unit>(cur_factor * static_cast<f64>(event.time - cur_range.first));
-        if constexpr (has_dur) {
-            auto original_end = get_end(event);
-            if (original_end > cur_range.second) {
-                auto idx = std::lower_bound(original_times.begin() + 1, original_times.end(), original_end)
-                    - original_times.begin();
-                cur_factor = get_factor(idx);
-                cur_range  = std::make_pair(original_times[idx - 1], original_times[idx]);
-                pivot_new  = new_times[idx - 1];
+    }
+
+private:
+    f64 period, odd, lo_mid, hi_mid;
+};
+}   // namespace details
+
+// Snap the events to a grid of the given step (in the unit of the events, could be fractional,
+// e.g. 480 / 7 ticks), with odd grid points delayed by swing * grid.
+// For events with duration, mode decides what is snapped: ONSET moves the onset and keeps the
+// duration (so the offset moves along), OFFSET snaps the offset and keeps the onset, and BOTH
+// snaps both ends. Durations shorter than min_dur are then extended to min_dur.
+// Other events always have their time snapped. Since snapping is monotone, sorted lists stay sorted
+template<TimeEvent T>
+void quantize_inplace(
+    pyvec<T>&              events,
+    const f64              grid,
+    const QuantizeMode     mode    = QuantizeMode::BOTH,
+    const typename T::unit min_dur = 0,
+    const f64              swing   = 0
+) {
+    const details::QuantizeGrid snap(grid, swing);
+    if constexpr (HashDuration<T>) {
+        switch (mode) {
+        case QuantizeMode::ONSET:
+            for (auto& event : events) {
+                event.time     = snap(event.time);
+                event.duration = std::max(event.duration, min_dur);
+            }
+            break;
+        case QuantizeMode::OFFSET:
+            for (auto& event : events) {
+                event.duration = std::max(snap(event.end()) - event.time, min_dur);
+            }
+            break;
+        default:
+            for (auto& event : events) {
+                const auto start = snap(event.time);
+                event.duration   = std::max(snap(event.end()) - start, min_dur);
+                event.time       = start;
             }
-            unit end = pivot_new
-                + static_cast<typename T::unit>(cur_factor * static_cast<f64>(original_end - cur_range.first));
-            event.duration = end - start;
         }
-        event.time = start;
-        *(events.pbegin() + i) = *(events.pbegin() + j);
-        ++i;
+    } else {
+        for (auto& event : events) event.time = snap(event.time);
     }
-    events.resize(i);
-    // clang-format on
 }
 
-template<typename T>
-void check_times(const vec<T>& original_times, const vec<T>& new_times) {
-    if (original_times.size() != new_times.size()) {
+template<TType T>
+void quantize_inplace(
+    Track<T>&              track,
+    const f64              grid,
+    const QuantizeMode     mode    = QuantizeMode::BOTH,
+    const typename T::unit min_dur = 0,
+    const f64              swing   = 0
+) {
+    // validate before detaching
+    const details::QuantizeGrid check(grid, swing);
+    track.detach();
+    quantize_inplace(*track.notes, grid, mode, min_dur, swing);
+    quantize_inplace(*track.pedals, grid, mode, min_dur, swing);
+    quantize_inplace(*track.controls, grid, mode, min_dur, swing);
+    quantize_inplace(*track.pitch_bends, grid, mode, min_dur, swing);
+    quantize_inplace(*track.lyrics, grid, mode, min_dur, swing);
+}
+
+// the grid step of a score is given as divisions of a quarter note, e.g. 4 for sixteenth notes,
+// and converted with ticks_per_quarter for Tick scores.
+// Second scores have no fixed quarter length, so they are rejected
+template<TType T>
+void quantize_inplace(
+    Score<T>&              score,
+    const f64              division,
+    const QuantizeMode     mode    = QuantizeMode::BOTH,
+    const typename T::unit min_dur = 0,
+    const f64              swing   = 0
+) {
+    if constexpr (std::is_same_v<T, Second>) {
         throw std::invalid_argument(
-            "symusic::ops::adjust_time: original_times and new_times should have the same size"
+            "symusic::quantize: a Second score has no fixed quarter length, "
+            "convert it to Tick or Quarter first"
         );
+    } else {
+        if (!(division > 0)) {
+            throw std::invalid_argument(
+                "symusic::quantize: division should be positive, got " + std::to_string(division)
+            );
+        }
+        const f64 quarter = std::is_same_v<T, Tick> ? static_cast<f64>(score.ticks_per_quarter) : 1;
+        const f64 grid    = quarter / division;
+        const details::QuantizeGrid check(grid, swing);
+        for (const shared<Track<T>>& track : *score.tracks) {
+            quantize_inplace(*track, grid, mode, min_dur, swing);
+        }
+        score.detach();
+        quantize_inplace(*score.time_signatures, grid, mode, min_dur, swing);
+        quantize_inplace(*score.key_signatures, grid, mode, min_dur, swing);
+        quantize_inplace(*score.tempos, grid, mode, min_dur, swing);
+        quantize_inplace(*score.markers, grid, mode, min_dur, swing);
     }
-    if (original_times.size() < 2) {
-        throw std::invalid_argument("symusic::ops::adjust_time: original_times and new_times "
-                                    "should have at least 2 elements");
+}
+
+template<typename T>
+T quantize(
+    const T&                data,
+    const f64               grid,
+    const QuantizeMode      mode    = QuantizeMode::BOTH,
+    const typename T::unit  min_dur = 0,
+    const f64               swing   = 0
+) {
+    T new_data = data.cow_copy();
+    quantize_inplace(new_data, grid, mode, min_dur, swing);
+    return new_data;
+}
+
+// Extend the notes released while the sustain pedal is down to the pedal release, the same as
+// a synthesizer does. A sustained note is cut at the next onset of the same pitch, since the
+// key is struck again. A note released exactly when the pedal goes down is sustained.
+// The notes are visited once in reverse onset order, keeping the next onset of each pitch,
+// and the pedal spans are merged into disjoint intervals found by binary search.
+// Onsets are not changed, so the order of the notes is kept
+template<TType T>
+void apply_sustain_inplace(
+    pyvec<Note<T>>&        notes,
+    const pyvec<Pedal<T>>& pedals,
+    const bool             notes_sorted  = false,
+    const bool             pedals_sorted = false
+) {
+    using unit = typename T::unit;
+    if (notes.empty() || pedals.empty()) return;
+
+    vec<std::pair<unit, unit>> spans;
+    spans.reserve(pedals.size());
+    for (const auto& pedal : pedals) spans.emplace_back(pedal.time, pedal.end());
+    if (!pedals_sorted) pdqsort_branchless(spans.begin(), spans.end());
+    size_t merged = 0;
+    for (const auto& span : spans) {
+        if (merged != 0 && span.first <= spans[merged - 1].second) {
+            spans[merged - 1].second = std::max(spans[merged - 1].second, span.second);
+        } else {
+            spans[merged++] = span;
+        }
     }
-    if (!std::is_sorted(original_times.begin(), original_times.end())) {
-        throw std::invalid_argument("symusic::ops::adjust_time: original_times should be sorted");
+    spans.resize(merged);
+
+    vec<u32> order(notes.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (!notes_sorted) {
+        pdqsort_branchless(order.begin(), order.end(), [&notes](const u32 a, const u32 b) {
+            return notes[a].time < notes[b].time;
+        });
     }
-    if (!std::is_sorted(new_times.begin(), new_times.end())) {
-        throw std::invalid_argument("symusic::ops::adjust_time: new_times should be sorted");
+
+    // indexed by the pitch as u8, so that invalid pitches don't go out of bounds
+    std::array<unit, 256> next_onset;
+    next_onset.fill(std::numeric_limits<unit>::max());
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        auto&      note  = notes[*it];
+        const auto pitch = static_cast<u8>(note.pitch);
+        const unit end   = note.end();
+        // the last span starting at or before the release
+        const auto span = std::upper_bound(
+            spans.begin(), spans.end(), end,
+            [](const unit t, const std::pair<unit, unit>& x) { return t < x.first; }
+        );
+        if (span != spans.begin() && end < (span - 1)->second) {
+            const unit release = std::min((span - 1)->second, next_onset[pitch]);
+            if (release > end) note.duration = release - note.time;
+        }
+        next_onset[pitch] = note.time;
     }
 }
 
-}   // namespace details
-
-template<bool check_times = true, TimeEvent T>
+// see TimeWarp, each call validates the times and precomputes the slopes once
+template<TimeEvent T>
 void adjust_time_inplace(
     pyvec<T>&                    events,
     const vec<typename T::unit>& original_times,
     const vec<typename T::unit>& new_times
 ) {
-    if constexpr (check_times) { details::check_times(original_times, new_times); }
-    return details::adjust_time_inplace_inner(events, original_times, new_times);
+    TimeWarp<typename T::ttype>(original_times, new_times).apply_inplace(events);
 }
 
-template<bool check_times = true, TType T>
+template<TType T>
 void adjust_time_inplace(
     Track<T>&                    track,
     const vec<typename T::unit>& original_times,
     const vec<typename T::unit>& new_times
 ) {
-    if constexpr (check_times) { details::check_times(original_times, new_times); }
-    adjust_time_inplace<false>(*(track.notes), original_times, new_times);
-    adjust_time_inplace<false>(*(track.controls), original_times, new_times);
-    adjust_time_inplace<false>(*(track.pitch_bends), original_times, new_times);
-    adjust_time_inplace<false>(*(track.pedals), original_times, new_times);
-    adjust_time_inplace<false>(*(track.lyrics), original_times, new_times);
+    TimeWarp<T>(original_times, new_times).apply_inplace(track);
 }
 
-template<bool check_times = true, TType T>
+template<TType T>
 void adjust_time_inplace(
     Score<T>&                    score,
     const vec<typename T::unit>& original_times,
-    const vec<typename T::unit>& new_times
+    const vec<typename T::unit>& new_times,
+    const ExecPolicy             policy = ExecPolicy::SEQUENTIAL
 ) {
-    if constexpr (check_times) { details::check_times(original_times, new_times); }
-    for (const shared<Track<T>>& track : *(score.tracks)) {
-        adjust_time_inplace<false>(*track, original_times, new_times);
-    }
-    adjust_time_inplace<false>(*(score.time_signatures), original_times, new_times);
-    adjust_time_inplace<false>(*(score.key_signatures), original_times, new_times);
-    adjust_time_inplace<false>(*(score.tempos), original_times, new_times);
-    // adjust_time_inplace<false>(*(score.lyrics), original_times, new_times);
-    adjust_time_inplace<false>(*(score.markers), original_times, new_times);
+    TimeWarp<T>(original_times, new_times).apply_inplace(score, policy);
 }
 
+// the policy is only used by scores, see parallel.h
 template<typename T>
 T adjust_time(
     const T&                     data,
     const vec<typename T::unit>& original_times,
-    const vec<typename T::unit>& new_times
+    const vec<typename T::unit>& new_times,
+    const ExecPolicy             policy = ExecPolicy::SEQUENTIAL
 ) {
-    T new_data = data.deepcopy();
-    adjust_time_inplace<false>(new_data, original_times, new_times);
+    T new_data = [&data] {
+        if constexpr (requires { data.cow_copy(); }) return data.cow_copy();
+        else return data.deepcopy();
+    }();
+    if constexpr (requires { new_data.tracks; }) {
+        adjust_time_inplace(new_data, original_times, new_times, policy);
+    } else {
+        adjust_time_inplace(new_data, original_times, new_times);
+    }
     return new_data;
 }
 
+// If the events are known to be sorted by time, start is O(1), and so is end for events without duration
 template<TimeEvent T>
-typename T::unit start(const pyvec<T>& events) {
+typename T::unit start(const pyvec<T>& events, const bool sorted = false) {
     if (events.empty()) return 0;
+    if (sorted) return events.front().time;
     typename T::unit ans = std::numeric_limits<typename T::unit>::max();
     for (const T& event : events) { ans = std::min(ans, event.time); }
     return ans;
 }
 
 template<TimeEvent T>
-typename T::unit end(const pyvec<T>& events) {
+typename T::unit end(const pyvec<T>& events, const bool sorted = false) {
     if (events.empty()) return 0;
+    if constexpr (!HashDuration<T>) {
+        if (sorted) return events.back().time;
+    }
     typename T::unit ans     = std::numeric_limits<typename T::unit>::min();
     auto             get_end = [](const T& event) {
         if constexpr (HashDuration<T>) { return event.end(); }
@@ -337,6 +653,209 @@ typename T::unit end(const pyvec<T>& events) {
     return ans;
 }
 
+namespace details {
+// k-way merge of lists sorted by time, ties are taken in the order of the lists.
+// The heads of the lists are kept in a min heap, and a run of events from one list is copied
+// without touching the heap as long as they come before the next head
+template<TimeEvent E>
+pyvec<E> merge_sorted(const vec<const pyvec<E>*>& lists) {
+    using Head   = std::pair<typename E::unit, size_t>;
+    size_t total = 0;
+    for (const auto* list : lists) total += list->size();
+    vec<E> ans;
+    ans.reserve(total);
+
+    auto      later = [](const Head& a, const Head& b) { return b < a; };
+    vec<Head> heap;
+    heap.reserve(lists.size());
+    for (size_t k = 0; k < lists.size(); ++k) {
+        if (!lists[k]->empty()) heap.emplace_back(lists[k]->front().time, k);
+    }
+    std::make_heap(heap.begin(), heap.end(), later);
+    vec<size_t> pos(lists.size(), 0);
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        const size_t k = heap.back().second;
+        heap.pop_back();
+        const auto& list = *lists[k];
+        size_t&     i    = pos[k];
+        do {
+            ans.push_back(list[i++]);
+        } while (i < list.size() && (heap.empty() || Head{list[i].time, k} < heap.front()));
+        if (i < list.size()) {
+            heap.emplace_back(list[i].time, k);
+            std::push_heap(heap.begin(), heap.end(), later);
+        }
+    }
+    return pyvec<E>(std::move(ans));
+}
+
+// merge one kind of list of the tracks, the lists not known to be sorted are checked,
+// and stably sorted by time into a copy if they are not
+template<TType T, TimeEvent E>
+pyvec<E> merge_track_lists(
+    const std::span<const shared<Track<T>>> tracks,
+    shared<pyvec<E>> Track<T>::*const       member,
+    const u8                                kind
+) {
+    vec<const pyvec<E>*> lists;
+    vec<pyvec<E>>        sorted;
+    lists.reserve(tracks.size());
+    sorted.reserve(tracks.size());   // keep the pointers to the copies valid
+    auto by_time = [](const E& a, const E& b) { return a.time < b.time; };
+    for (const auto& track : tracks) {
+        const pyvec<E>& list = *((*track).*member);
+        if (track->is_time_sorted(kind) || list.is_sorted([](const E& e) { return e.time; })) {
+            lists.push_back(&list);
+        } else {
+            auto events = list.collect();
+            std::stable_sort(events.begin(), events.end(), by_time);
+            lists.push_back(&sorted.emplace_back(std::move(events)));
+        }
+    }
+    return merge_sorted(lists);
+}
+}   // namespace details
+
+// Merge the tracks into one track with the name, program and is_drum of the first one.
+// The event lists are k-way merged by time, so the result is sorted by time, and the events
+// of different tracks at the same time keep the order of the tracks
+template<TType T>
+Track<T> merge_tracks(const std::span<const shared<Track<T>>> tracks) {
+    if (tracks.empty()) {
+        throw std::invalid_argument("symusic::merge_tracks: no track to merge");
+    }
+    const auto& first = *tracks.front();
+    Track<T>    ans{
+        first.name,
+        first.program,
+        first.is_drum,
+        details::merge_track_lists(tracks, &Track<T>::notes, Track<T>::NOTES),
+        details::merge_track_lists(tracks, &Track<T>::controls, Track<T>::CONTROLS),
+        details::merge_track_lists(tracks, &Track<T>::pitch_bends, Track<T>::PITCH_BENDS),
+        details::merge_track_lists(tracks, &Track<T>::pedals, Track<T>::PEDALS),
+        details::merge_track_lists(tracks, &Track<T>::lyrics, Track<T>::LYRICS)
+    };
+    ans.time_sorted = Track<T>::ALL;
+    return ans;
+}
+
+// replace the tracks at the indices with their merge, placed at the smallest index
+template<TType T>
+void merge_tracks_inplace(vec<shared<Track<T>>>& tracks, vec<size_t> indices) {
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    if (indices.empty()) return;
+    if (indices.back() >= tracks.size()) {
+        throw std::out_of_range(
+            "symusic::merge_tracks: track index " + std::to_string(indices.back())
+            + " is out of range for " + std::to_string(tracks.size()) + " tracks"
+        );
+    }
+    vec<shared<Track<T>>> selected;
+    selected.reserve(indices.size());
+    for (const size_t i : indices) selected.push_back(tracks[i]);
+    auto   merged = std::make_shared<Track<T>>(merge_tracks<T>(selected));
+    size_t kept   = 0;
+    size_t next   = 0;   // position in indices
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        if (next < indices.size() && indices[next] == i) {
+            if (next++ == 0) tracks[kept++] = merged;
+        } else {
+            tracks[kept++] = std::move(tracks[i]);
+        }
+    }
+    tracks.resize(kept);
+}
+
+// Split the notes of a track by a numeric field of Note (see Fields), e.g. "pitch" or
+// "velocity", into the ranges [boundaries[i], boundaries[i + 1]), one track per range.
+// The notes out of all the ranges are dropped. The notes are distributed in order, so no
+// sorting is needed. The other lists are copied into the first part only, and the other parts
+// hold notes only, so merging the parts back doesn't duplicate them. Each part is allocated
+// anew, so none of them keeps the lists of the track alive
+template<TType T>
+vec<Track<T>> split_track(
+    const Track<T>& track, const std::string_view field, const vec<f64>& boundaries
+) {
+    if (boundaries.size() < 2) {
+        throw std::invalid_argument("symusic::split_track: at least 2 boundaries are needed");
+    }
+    if (std::adjacent_find(boundaries.begin(), boundaries.end(), std::greater_equal<>())
+        != boundaries.end()) {
+        throw std::invalid_argument(
+            "symusic::split_track: boundaries should be strictly increasing"
+        );
+    }
+    const size_t      num = boundaries.size() - 1;
+    vec<vec<Note<T>>> parts(num);
+    Fields<Note<T>>::visit(Fields<Note<T>>::index(field), [&](auto getter) {
+        for (const auto& note : *track.notes) {
+            const auto value = static_cast<f64>(getter(note));
+            const auto it    = std::upper_bound(boundaries.begin(), boundaries.end(), value);
+            if (it == boundaries.begin() || it == boundaries.end()) continue;
+            parts[it - boundaries.begin() - 1].push_back(note);
+        }
+    });
+    vec<Track<T>> ans;
+    ans.reserve(num);
+    const u8 sorted = track.is_time_sorted(Track<T>::NOTES) ? Track<T>::NOTES : 0;
+    for (auto& part : parts) {
+        if (ans.empty()) {
+            ans.emplace_back(
+                track.name,
+                track.program,
+                track.is_drum,
+                pyvec<Note<T>>(std::move(part)),
+                track.controls->deepcopy(),
+                track.pitch_bends->deepcopy(),
+                track.pedals->deepcopy(),
+                track.lyrics->deepcopy()
+            );
+            ans.back().time_sorted = (track.time_sorted & ~track.exposed & ~Track<T>::NOTES) | sorted;
+        } else {
+            ans.emplace_back(
+                track.name,
+                track.program,
+                track.is_drum,
+                pyvec<Note<T>>(std::move(part)),
+                pyvec<ControlChange<T>>{},
+                pyvec<PitchBend<T>>{},
+                pyvec<Pedal<T>>{},
+                pyvec<TextMeta<T>>{}
+            );
+            ans.back().time_sorted = sorted;
+        }
+    }
+    return ans;
+}
+
+// replace the track at the index with its parts, the empty parts are dropped
+template<TType T>
+void split_track_inplace(
+    vec<shared<Track<T>>>& tracks,
+    const size_t           index,
+    const std::string_view field,
+    const vec<f64>&        boundaries
+) {
+    if (index >= tracks.size()) {
+        throw std::out_of_range(
+            "symusic::split_track: track index " + std::to_string(index) + " is out of range for "
+            + std::to_string(tracks.size()) + " tracks"
+        );
+    }
+    vec<shared<Track<T>>> parts;
+    for (auto& part : split_track(*tracks[index], field, boundaries)) {
+        if (!part.empty()) parts.push_back(std::make_shared<Track<T>>(std::move(part)));
+    }
+    tracks.erase(tracks.begin() + static_cast<ptrdiff_t>(index));
+    tracks.insert(
+        tracks.begin() + static_cast<ptrdiff_t>(index),
+        std::make_move_iterator(parts.begin()),
+        std::make_move_iterator(parts.end())
+    );
+}
+
 }   // namespace symusic::ops
 
 #endif   // LIBSYMUSIC_BATCH_OPS_H
@@ -0,0 +1,120 @@
+#pragma once
+
+#ifndef LIBSYMUSIC_PARALLEL_H
+#define LIBSYMUSIC_PARALLEL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "symusic/mtype.h"
+#include "symusic/track.h"
+
+namespace symusic {
+
+/*
+ *  ExecPolicy chooses how the tracks of a score are processed by the score operations that
+ *  take it, e.g. sort_inplace, clip_inplace, convert and resample. The tracks are independent,
+ *  so with PARALLEL they are spread over the shared thread pool, and the lists of the score
+ *  itself are still processed by the calling thread.
+ *  Scores with a single track or fewer than parallel_threshold events stay serial, since
+ *  waking up the pool costs more than it saves for them. So do scores holding the same track
+ *  more than once, or tracks sharing a list, which couldn't be modified from two threads.
+ */
+enum class ExecPolicy : u8 {
+    SEQUENTIAL,
+    PARALLEL,
+};
+
+// the number of events in a score below which ExecPolicy::PARALLEL still runs serially
+constexpr size_t parallel_threshold = 1 << 15;
+
+/*
+ *  ThreadPool is a fixed set of workers taking tasks from a queue in order.
+ *  The shared pool has one worker per hardware thread (minus the caller) and is never destroyed,
+ *  so that no worker is joined while the process (or the python interpreter) is exiting.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads);
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool();
+
+    static ThreadPool& shared();
+
+    [[nodiscard]] size_t size() const { return workers.size(); }
+
+    void submit(std::function<void()> task);
+
+private:
+    std::mutex                        mutex;
+    std::condition_variable           ready;
+    std::deque<std::function<void()>> tasks;
+    vec<std::thread>                  workers;
+    bool                              stopping = false;
+};
+
+namespace details {
+// call f(i) for each i in [0, n), on the shared pool if parallel is true. The caller takes part
+// and never waits for a task that hasn't started, so it's safe to call from a task of the pool,
+// or after a fork that left the pool without workers.
+// The first exception thrown by f is rethrown once all the calls are done.
+void parallel_for(size_t n, bool parallel, const std::function<void(size_t)>& f);
+
+template<TType T>
+size_t event_num(const Track<T>& track) {
+    return track.notes->size() + track.controls->size() + track.pitch_bends->size()
+         + track.pedals->size() + track.lyrics->size();
+}
+
+// whether the tracks are worth, and safe, to be processed in parallel under policy
+template<TType T>
+bool use_parallel(const vec<shared<Track<T>>>& tracks, const ExecPolicy policy) {
+    if (policy != ExecPolicy::PARALLEL || tracks.size() < 2) return false;
+    size_t events = 0;
+    for (const auto& track : tracks) events += event_num(*track);
+    if (events < parallel_threshold) return false;
+    vec<const Track<T>*> ptrs;
+    ptrs.reserve(tracks.size());
+    for (const auto& track : tracks) ptrs.push_back(track.get());
+    std::sort(ptrs.begin(), ptrs.end());
+    if (std::adjacent_find(ptrs.begin(), ptrs.end()) != ptrs.end()) return false;
+    // distinct tracks could still share lists (e.g. shallow copies or cow copies), and
+    // detaching or modifying them from two threads races, so compare their control blocks
+    vec<std::pair<shared<const void>, size_t>> owners;
+    owners.reserve(tracks.size() * 5);
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        const auto& track = *tracks[i];
+        owners.emplace_back(track.notes, i);
+        owners.emplace_back(track.controls, i);
+        owners.emplace_back(track.pitch_bends, i);
+        owners.emplace_back(track.pedals, i);
+        owners.emplace_back(track.lyrics, i);
+    }
+    std::sort(owners.begin(), owners.end(), [](const auto& a, const auto& b) {
+        return a.first.owner_before(b.first);
+    });
+    // the lists of one track share a block, so only a block of two tracks counts
+    for (size_t i = 1; i < owners.size(); ++i) {
+        const auto& [prev, prev_track] = owners[i - 1];
+        const auto& [cur, cur_track]   = owners[i];
+        if (!prev.owner_before(cur) && prev_track != cur_track) return false;
+    }
+    return true;
+}
+
+// call f(i) for the index of each track, in parallel if the policy and the tracks allow it
+template<TType T, typename F>
+void for_each_track(const vec<shared<Track<T>>>& tracks, const ExecPolicy policy, F&& f) {
+    parallel_for(tracks.size(), use_parallel(tracks, policy), std::forward<F>(f));
+}
+}   // namespace details
+
+}   // namespace symusic
+
+#endif   // LIBSYMUSIC_PARALLEL_H
@@ -0,0 +1,103 @@
+#pragma once
+
+#ifndef LIBSYMUSIC_PIPELINE_H
+#define LIBSYMUSIC_PIPELINE_H
+
+#include "symusic/mtype.h"
+#include "symusic/event.h"
+#include "symusic/track.h"
+#include "symusic/score.h"
+
+namespace symusic {
+
+/*
+ *  Pipeline records a chain of transformations (clip, shift, filter, sort) and applies them
+ *  in a single pass over each event list: every event is copied once, run through all the
+ *  steps, and appended to the output if no step drops it. So a chain of n steps costs one
+ *  traversal and one allocation per list, instead of n of each.
+ *  The steps are applied in the order they are added, except that sort always runs last
+ *  (all the other steps are per event, so it makes no difference), and a later sort replaces
+ *  an earlier one.
+ *  Pitch and velocity shifts throw std::range_error on overflow unless saturate is set; since
+ *  the input is never modified, a failed pipeline leaves nothing half done.
+ *  For Score, time signatures, key signatures and tempos are clipped with a sentinel just as
+ *  Score::clip does, so they are processed step by step, which is cheap for these short lists.
+ */
+template<TType T>
+class Pipeline {
+public:
+    typedef T                ttype;
+    typedef typename T::unit unit;
+
+    enum class Kind : u8 {
+        CLIP,
+        SHIFT_TIME,
+        SHIFT_PITCH,
+        SHIFT_VELOCITY,
+        FILTER_PITCH,
+        FILTER_VELOCITY,
+        FILTER_DURATION,
+    };
+
+    struct Step {
+        Kind kind;
+        unit lo;         // start of clip, offset of time shift, or the lower bound of filters
+        unit hi;         // end of clip, or the upper bound of filters
+        i8   offset;     // offset of pitch and velocity shift
+        bool flag;       // clip_end for clip, saturate for pitch and velocity shift
+    };
+
+    Pipeline() = default;
+
+    // keep the events in [start, end), see Track::clip
+    Pipeline& clip(unit start, unit end, bool clip_end = false);
+
+    Pipeline& shift_time(unit offset);
+
+    Pipeline& shift_pitch(i8 offset, bool saturate = false);
+
+    Pipeline& shift_velocity(i8 offset, bool saturate = false);
+
+    // keep the notes with min_pitch <= pitch <= max_pitch
+    Pipeline& filter_pitch(i8 min_pitch, i8 max_pitch);
+
+    // keep the notes with min_velocity <= velocity <= max_velocity
+    Pipeline& filter_velocity(i8 min_velocity, i8 max_velocity);
+
+    // keep the notes and pedals with min_duration <= duration <= max_duration
+    Pipeline& filter_duration(unit min_duration, unit max_duration);
+
+    Pipeline& sort(bool reverse = false);
+
+    [[nodiscard]] const vec<Step>& steps() const { return step_list; }
+
+    // number of recorded steps, including sort
+    [[nodiscard]] size_t size() const { return step_list.size() + has_sort; }
+
+    [[nodiscard]] bool empty() const { return size() == 0; }
+
+    [[nodiscard]] Track<T> apply(const Track<T>& track) const;
+
+    [[nodiscard]] Score<T> apply(const Score<T>& score) const;
+
+private:
+    vec<Step> step_list;
+    bool      has_sort = false;
+    bool      reverse  = false;
+
+    // run all the steps on the event, return false if it is dropped
+    template<TimeEvent E>
+    bool run(E& event) const;
+
+    // copy the kept events of the list in one pass
+    template<TimeEvent E>
+    pyvec<E> run(const pyvec<E>& events) const;
+
+    // the step by step version, for the lists clipped with a sentinel
+    template<TimeEvent E>
+    pyvec<E> run_with_sentinel(const pyvec<E>& events) const;
+};
+
+}   // namespace symusic
+
+#endif   // LIBSYMUSIC_PIPELINE_H
@@ -0,0 +1,78 @@
+#pragma once
+
+#ifndef LIBSYMUSIC_PREDICATE_H
+#define LIBSYMUSIC_PREDICATE_H
+
+#include <span>
+#include <string>
+#include <string_view>
+#include "symusic/mtype.h"
+#include "symusic/event.h"
+#include "symusic/track.h"
+#include "symusic/field.h"
+
+namespace symusic {
+
+namespace details {
+/*
+ *  A predicate expression compiled into postfix code. Grammar:
+ *      expr  := and ("or" and)*
+ *      and   := unary ("and" unary)*
+ *      unary := "not" unary | "(" expr ")" | cmp
+ *      cmp   := field op number | number op field
+ *             | field "in" ("[" | "(") number "," number ("]" | ")")
+ *      op    := "<" | "<=" | ">" | ">=" | "==" | "!="
+ *  "&&", "||" and "!" are accepted as aliases of "and", "or" and "not".
+ *  Fields are the names in Fields<E>, and numbers are parsed as f64.
+ */
+struct PredicateCode {
+    enum Op : u8 { LT, LE, GT, GE, EQ, NE, AND, OR, NOT };
+
+    struct Instr {
+        Op  op;
+        u8  field;   // for comparisons
+        f64 value;   // for comparisons
+    };
+
+    vec<Instr> code;
+    size_t     depth = 0;   // max depth of the evaluation stack
+};
+
+// throws std::invalid_argument with the position of the error
+PredicateCode compile_predicate(std::string_view expr, std::span<const std::string_view> fields);
+}   // namespace details
+
+/*
+ *  Predicate is a filter condition over the numeric fields of events (or tracks), written as
+ *  a small expression, e.g. "pitch in [21, 108) and velocity > 10 and duration >= 30".
+ *  The expression is compiled once, and evaluated in C++ over blocks of events: each comparison
+ *  is a tight loop over one field, and the results are combined as byte masks.
+ *  So filtering doesn't call back into python for each event.
+ */
+template<typename E>
+class Predicate {
+public:
+    // tracks are held by shared_ptr in a TrackList
+    typedef std::conditional_t<std::is_same_v<E, Track<typename E::ttype>>, vec<shared<E>>, pyvec<E>>
+        container;
+
+    explicit Predicate(std::string_view expr);
+
+    [[nodiscard]] const std::string& expression() const { return expr; }
+
+    // 1 for each item satisfying the predicate, 0 otherwise
+    [[nodiscard]] vec<u8> mask(const container& items) const;
+
+    [[nodiscard]] bool operator()(const E& item) const;
+
+    // remove the items not satisfying the predicate, keeping the order of the others
+    void filter_inplace(container& items) const;
+
+private:
+    std::string            expr;
+    details::PredicateCode program;
+};
+
+}   // namespace symusic
+
+#endif   // LIBSYMUSIC_PREDICATE_H
@@ -6,11 +6,65 @@
 #ifndef LIBSYMUSIC_TRACK_HSCORE_H
 #define LIBSYMUSIC_TRACK_HSCORE_H
 
+#include <atomic>
+#include <cassert>
 #include "symusic/event.h"
 #include "symusic/track.h"
+#include "symusic/parallel.h"
 
 namespace symusic {
 
+namespace details {
+// the event lists of a score, allocated in a single block. The track list is kept out of it,
+// since it's handed out and replaced on its own
+template<TType T>
+struct ScoreLists {
+    pyvec<TimeSignature<T>> time_signatures;
+    pyvec<KeySignature<T>>  key_signatures;
+    pyvec<Tempo<T>>         tempos;
+    pyvec<TextMeta<T>>      markers;
+
+    ScoreLists() = default;
+
+    ScoreLists(
+        pyvec<TimeSignature<T>>&& time_signatures,
+        pyvec<KeySignature<T>>&&  key_signatures,
+        pyvec<Tempo<T>>&&         tempos,
+        pyvec<TextMeta<T>>&&      markers
+    ) :
+        time_signatures{std::move(time_signatures)}, key_signatures{std::move(key_signatures)},
+        tempos{std::move(tempos)}, markers{std::move(markers)} {}
+};
+
+// a cache of data derived from a score, which const methods may replace from several threads
+// at once. Copies take a snapshot of it
+template<typename M>
+class SharedCache {
+public:
+    SharedCache() = default;
+
+    SharedCache(const SharedCache& other) : ptr{other.load()} {}
+
+    SharedCache& operator=(const SharedCache& other) {
+        store(other.load());
+        return *this;
+    }
+
+    [[nodiscard]] shared<const M> load() const { return ptr.load(std::memory_order_acquire); }
+
+    void store(shared<const M> value) const { ptr.store(std::move(value), std::memory_order_release); }
+
+private:
+    mutable std::atomic<shared<const M>> ptr;
+};
+}   // namespace details
+
+template<TType T>
+class TempoMap;
+
+template<TType T>
+class BeatGrid;
+
 template<TType T>
 struct Score {
     typedef T                ttype;
@@ -23,25 +77,50 @@ struct Score {
     shared<pyvec<Tempo<T>>>         tempos;
     shared<pyvec<TextMeta<T>>>      markers;
 
-    Score() : ticks_per_quarter{0} {
-        tracks          = std::make_shared<vec<shared<Track<T>>>>();
-        time_signatures = std::make_shared<pyvec<TimeSignature<T>>>();
-        key_signatures  = std::make_shared<pyvec<KeySignature<T>>>();
-        tempos          = std::make_shared<pyvec<Tempo<T>>>();
-        markers         = std::make_shared<pyvec<TextMeta<T>>>();
+    // bit masks of the event lists, used by the copy-on-write methods below
+    enum : u8 {
+        TIME_SIGNATURES = 1 << 0,
+        KEY_SIGNATURES  = 1 << 1,
+        TEMPOS          = 1 << 2,
+        MARKERS         = 1 << 3,
+        ALL             = TIME_SIGNATURES | KEY_SIGNATURES | TEMPOS | MARKERS,
+    };
+
+    // lists that have been handed out (e.g. to python) or shared on purpose by copy(), they could
+    // be modified at any time, and are never detached
+    u8 exposed = 0;
+    // lists known to be sorted by time, it's only trusted for the lists not exposed.
+    // Like in Track, code that modifies the public lists directly must clear their bits,
+    // since start, end, clip and segment trust it without checking in release builds
+    u8 time_sorted = 0;
+    // the map built by tempo_map(), checked against the tempos and tpq before it's reused
+    details::SharedCache<TempoMap<T>> tempo_map_cache;
+    // the grid built by beat_grid(), checked against what it's built from before it's reused
+    details::SharedCache<BeatGrid<T>> beat_grid_cache;
+
+    Score() : ticks_per_quarter{0}, tracks{std::make_shared<vec<shared<Track<T>>>>()} {
+        alloc_lists(std::make_shared<details::ScoreLists<T>>());
     }
 
-    Score(const Score&) = default;
+    // a copy shares the lists copy-on-write, the same as cow_copy, so that neither of the two
+    // scores can modify the lists of the other one
+    Score(const Score& other) : Score(other.cow_copy()) {}
+
+    Score(Score&& other) noexcept { move_other(std::move(other)); }
 
-    Score(Score&& other) noexcept {
-        // move constructor
+    void move_other(Score&& other) {
         ticks_per_quarter = other.ticks_per_quarter;
         tracks            = std::move(other.tracks);
         time_signatures   = std::move(other.time_signatures);
         key_signatures    = std::move(other.key_signatures);
         tempos            = std::move(other.tempos);
         // lyrics            = std::move(other.lyrics);
-        markers = std::move(other.markers);
+        markers           = std::move(other.markers);
+        exposed           = other.exposed;
+        time_sorted       = other.time_sorted;
+        tempo_map_cache   = other.tempo_map_cache;
+        beat_grid_cache   = other.beat_grid_cache;
+        other.exposed     = 0;
     }
 
     Score(
@@ -53,12 +132,13 @@ struct Score {
         // pyvec<TextMeta<T>>&&          lyrics,
         pyvec<TextMeta<T>>&& markers
     ) : ticks_per_quarter{tpq}, tracks{std::move(tracks)} {
-        this->time_signatures
-            = std::make_shared<pyvec<TimeSignature<T>>>(std::move(time_signatures));
-        this->key_signatures = std::make_shared<pyvec<KeySignature<T>>>(std::move(key_signatures));
-        this->tempos         = std::make_shared<pyvec<Tempo<T>>>(std::move(tempos));
-        // this->lyrics         = std::make_shared<pyvec<TextMeta<T>>>(std::move(lyrics));
-        this->markers = std::make_shared<pyvec<TextMeta<T>>>(std::move(markers));
+        alloc_lists(std::make_shared<details::ScoreLists<T>>(
+            std::move(time_signatures),
+            std::move(key_signatures),
+            std::move(tempos),
+            // std::move(lyrics),
+            std::move(markers)
+        ));
     }
 
 
@@ -77,7 +157,32 @@ struct Score {
         // lyrics{std::move(lyrics)},
         markers{std::move(markers)} {}
 
-    Score& operator=(const Score&) = default;
+    Score& operator=(const Score& other) {
+        if (this != &other) move_other(other.cow_copy());
+        return *this;
+    }
+
+    Score& operator=(Score&& other) noexcept {
+        move_other(std::move(other));
+        return *this;
+    }
+
+    // point the event lists into one allocated block, using the aliasing constructor of
+    // shared_ptr, so that they cost one allocation instead of four. See Track::alloc_lists
+    void alloc_lists(const shared<details::ScoreLists<T>>& block) {
+        time_signatures = {block, &block->time_signatures};
+        key_signatures  = {block, &block->key_signatures};
+        tempos          = {block, &block->tempos};
+        markers         = {block, &block->markers};
+    }
+
+    // number of references to the control block of the list held by the score itself
+    template<typename L>
+    [[nodiscard]] long own_refs(const shared<L>& list) const {
+        return details::same_owner(list, time_signatures)
+               + details::same_owner(list, key_signatures) + details::same_owner(list, tempos)
+               + details::same_owner(list, markers);
+    }
 
     bool operator==(const Score& other) const {
 
@@ -105,7 +210,52 @@ struct Score {
 
     bool operator!=(const Score& other) const { return !(*this == other); }
 
-    [[nodiscard]] Score copy() const { return {*this}; }
+    // shallow copy, which holds the same lists (and tracks) as this score, so the changes made
+    // through either are seen by both. The lists are exposed on both sides, since either could
+    // change them without the other noticing. Unlike the copy constructor, which makes a
+    // copy-on-write copy
+    [[nodiscard]] Score copy() {
+        expose();
+        Score ans{ticks_per_quarter, tracks, time_signatures, key_signatures, tempos, markers};
+        ans.exposed         = ALL;
+        ans.tempo_map_cache = tempo_map_cache;
+        ans.beat_grid_cache = beat_grid_cache;
+        return ans;
+    }
+
+    // copy-on-write copy, which behaves like deepcopy but shares the event lists (including the
+    // ones in tracks) until they are mutated. Exposed lists are copied eagerly.
+    // It only reads this score, so it's safe to copy one score from several threads
+    [[nodiscard]] Score cow_copy() const;
+
+    // make sure the given lists are not shared with others before mutating them. A list is
+    // copied if anyone else holds it (use_count), the exposed lists are left as they are
+    void detach(u8 kinds = ALL);
+
+    // detach the given lists and mark them as exposed, call it before handing them out
+    void expose(u8 kinds = ALL);
+
+    // the lists still in the block allocated by alloc_lists, see Track::pooled
+    [[nodiscard]] u8 pooled() const;
+
+    // whether the block of the pooled lists is also held by others, e.g. copy-on-write copies
+    [[nodiscard]] bool block_shared(u8 pooled) const;
+
+    // give each list its own allocation, see Track::unpool
+    void unpool();
+
+    // return true if all the given lists are known to be sorted by time
+    [[nodiscard]] bool is_time_sorted(const u8 kinds) const {
+        const bool ans = (time_sorted & ~exposed & kinds) == kinds;
+        assert(
+            !ans
+            || ((!(kinds & TIME_SIGNATURES) || details::is_sorted_by_time(*time_signatures))
+                && (!(kinds & KEY_SIGNATURES) || details::is_sorted_by_time(*key_signatures))
+                && (!(kinds & TEMPOS) || details::is_sorted_by_time(*tempos))
+                && (!(kinds & MARKERS) || details::is_sorted_by_time(*markers)))
+        );
+        return ans;
+    }
 
     [[nodiscard]] Score deepcopy() const {
         auto new_tracks = std::make_shared<vec<shared<Track<T>>>>();
@@ -113,7 +263,7 @@ struct Score {
         for (const auto& track : *tracks) {
             new_tracks->push_back(std::make_shared<Track<T>>(std::move(track->deepcopy())));
         }
-        return {
+        Score ans{
             ticks_per_quarter,
             std::move(new_tracks),
             std::move(time_signatures->deepcopy()),
@@ -122,6 +272,8 @@ struct Score {
             // std::move(lyrics->deepcopy()),
             std::move(markers->deepcopy())
         };
+        ans.time_sorted = time_sorted & ~exposed;
+        return ans;
     }
 
     explicit Score(const i32 tpq) : Score() { ticks_per_quarter = tpq; }
@@ -141,46 +293,109 @@ struct Score {
     // return the number of notes in the score
     [[nodiscard]] size_t note_num() const;
 
+    // the tempo map of the score, which is built once and reused until the tempos or
+    // ticks_per_quarter change. The check costs a pass over the tempos, but no sort or allocation.
+    // Several threads may call it on the same score, as long as none of them modifies it
+    [[nodiscard]] shared<const TempoMap<T>> tempo_map() const;
+
+    // the bar and beat grid until end, cached like tempo_map() until end, the time signatures,
+    // ticks_per_quarter (for Tick) or the tempos (for Second) change
+    [[nodiscard]] shared<const BeatGrid<T>> beat_grid(unit end) const;
+
     // return the number of tracks in the score
     [[nodiscard]] size_t track_num() const;
 
     // return true if the score is empty
     [[nodiscard]] bool empty() const;
 
+    // estimated heap memory held by the score, including all the tracks
+    [[nodiscard]] MemoryUsage memory_usage() const;
+
+    // release the unused capacity of the lists, lists exposed or shared with others are skipped
+    void shrink_to_fit();
+
     // return a string representation of the score, same as summary
     [[nodiscard]] std::string to_string() const;
 
     // summary info of the score
     [[nodiscard]] std::string summary() const;
 
+    // The operations below take an ExecPolicy, which decides whether the tracks are processed
+    // in parallel, see parallel.h
+
     // non-inplace sort, return a new score
-    [[nodiscard]] Score sort(bool reverse = false) const;
+    [[nodiscard]] Score sort(bool reverse = false, ExecPolicy policy = ExecPolicy::SEQUENTIAL) const;
 
     // inplace sort, and return self reference
-    void sort_inplace(bool reverse = false);
+    void sort_inplace(bool reverse = false, ExecPolicy policy = ExecPolicy::SEQUENTIAL);
 
     // Clip all the events in the score, non-inplace, return a new Score
     // For events with duration, clip_end is used to determine whether to clip based on end time.
-    [[nodiscard]] Score clip(unit start, unit end, bool clip_end = false) const;
-    void                clip_inplace(unit start, unit end, bool clip_end = false);
+    [[nodiscard]] Score clip(
+        unit start, unit end, bool clip_end = false, ExecPolicy policy = ExecPolicy::SEQUENTIAL
+    ) const;
+    void clip_inplace(
+        unit start, unit end, bool clip_end = false, ExecPolicy policy = ExecPolicy::SEQUENTIAL
+    );
 
     // shift the time of all the events in the score, non-inplace, return a new Score
-    [[nodiscard]] Score shift_time(unit offset) const;
+    [[nodiscard]] Score shift_time(unit offset, ExecPolicy policy = ExecPolicy::SEQUENTIAL) const;
 
     // shift the time of all the events in the score, inplace, return self reference
-    void shift_time_inplace(unit offset);
+    void shift_time_inplace(unit offset, ExecPolicy policy = ExecPolicy::SEQUENTIAL);
 
     // shift the pitch of all notes in the score, non-inplace, return a new Score
-    [[nodiscard]] Score shift_pitch(i8 offset) const;
+    // with saturate, pitches are clamped into [0, 127] instead of throwing std::range_error
+    [[nodiscard]] Score shift_pitch(
+        i8 offset, bool saturate = false, ExecPolicy policy = ExecPolicy::SEQUENTIAL
+    ) const;
 
     // shift the pitch of all notes in the score, inplace, return self reference
-    void shift_pitch_inplace(i8 offset);
+    void shift_pitch_inplace(
+        i8 offset, bool saturate = false, ExecPolicy policy = ExecPolicy::SEQUENTIAL
+    );
 
     // shift the velocity of all notes in the score, non-inplace, return a new Score
-    [[nodiscard]] Score shift_velocity(i8 offset) const;
+    [[nodiscard]] Score shift_velocity(
+        i8 offset, bool saturate = false, ExecPolicy policy = ExecPolicy::SEQUENTIAL
+    ) const;
 
     // shift the velocity of all notes in the score, inplace, return self reference
-    void shift_velocity_inplace(i8 offset);
+    void shift_velocity_inplace(
+        i8 offset, bool saturate = false, ExecPolicy policy = ExecPolicy::SEQUENTIAL
+    );
+
+    // shift time, pitch and velocity together, visiting each note only once
+    [[nodiscard]] Score shift(
+        unit       time,
+        i8         pitch,
+        i8         velocity,
+        bool       saturate = false,
+        ExecPolicy policy   = ExecPolicy::SEQUENTIAL
+    ) const;
+
+    void shift_inplace(
+        unit       time,
+        i8         pitch,
+        i8         velocity,
+        bool       saturate = false,
+        ExecPolicy policy   = ExecPolicy::SEQUENTIAL
+    );
+
+    // apply the sustain pedals of each track to its notes
+    [[nodiscard]] Score apply_sustain() const;
+
+    void apply_sustain_inplace();
+
+    // see Track::dedup_notes_inplace, the stats are summed over the tracks
+    OverlapStats dedup_notes_inplace();
+
+    [[nodiscard]] Score dedup_notes() const;
+
+    // see Track::resolve_overlaps_inplace, the stats are summed over the tracks
+    OverlapStats resolve_overlaps_inplace(OverlapPolicy policy = OverlapPolicy::KEEP_FIRST);
+
+    [[nodiscard]] Score resolve_overlaps(OverlapPolicy policy = OverlapPolicy::KEEP_FIRST) const;
 };
 
 /*
@@ -0,0 +1,43 @@
+#pragma once
+
+#ifndef LIBSYMUSIC_SEGMENT_H
+#define LIBSYMUSIC_SEGMENT_H
+
+#include "symusic/mtype.h"
+#include "symusic/score.h"
+
+namespace symusic::ops {
+
+// the unit of the window and stride of segment
+enum class SegmentUnit : u8 {
+    BAR,      // bars of the BeatGrid of the score
+    TIME,     // the time unit of the score itself, i.e. ticks, quarters or seconds
+    SECOND,   // seconds, following the tempos
+};
+
+/*
+ *  Cut a score into windows of the given length, starting every stride from time 0 until the
+ *  end of the score, e.g. windows of 8 bars with a stride of 4 bars. Each window is the same as
+ *  score.clip(start, end) (events starting in [start, end) are kept), and the tempo, time
+ *  signature and key signature in effect at the start are kept as a sentinel there, the same
+ *  as Score::clip does.
+ *  Each event list is sorted once (or not at all if it's known to be sorted), and walked once
+ *  with two cursors for all the windows, so the cost is the size of the output instead of the
+ *  number of windows times the size of the score.
+ *  - truncate_notes: notes and pedals ending after the end of a window are shortened to end there
+ *  - shift:          shift each window to start at time 0
+ *  In bars, window and stride should be whole numbers, and the bars are the ones of BeatGrid.
+ */
+template<TType T>
+vec<Score<T>> segment(
+    const Score<T>& score,
+    f64             window,
+    f64             stride,
+    SegmentUnit     unit           = SegmentUnit::TIME,
+    bool            truncate_notes = false,
+    bool            shift          = true
+);
+
+}   // namespace symusic::ops
+
+#endif   // LIBSYMUSIC_SEGMENT_H
@@ -0,0 +1,83 @@
+#pragma once
+
+#ifndef LIBSYMUSIC_SORT_KEY_H
+#define LIBSYMUSIC_SORT_KEY_H
+
+#include <array>
+#include <string>
+#include <string_view>
+#include "symusic/mtype.h"
+#include "symusic/event.h"
+#include "symusic/track.h"
+#include "symusic/field.h"
+
+namespace symusic {
+
+/*
+ *  SortKey sorts events (or tracks) by a tuple of named fields, e.g. {"time", "-pitch"}, where
+ *  a leading '-' means descending. Each field is mapped to an unsigned integer of the same order
+ *  and of its own width (8 bits for pitch, 32 bits for time, ...), and the fields are packed into
+ *  as few 64-bit words as possible, so comparing two items costs one or two integer compares
+ *  instead of a tuple (or a python call) comparison.
+ *  argsort is stable, and reverse sorts in descending order while keeping equal items in their
+ *  original order, the same as python's sorted(reverse=True). So are sort_rebuild and the
+ *  sort of track lists, which go through argsort, but sort_inplace on event lists sorts the
+ *  element pointers with pyvec::sort, which doesn't promise any order of equal items.
+ *  Large inputs are sorted with an LSD radix sort over the packed keys, skipping the bytes that
+ *  are equal in all the keys (e.g. the high bytes of time), so it usually takes only a few passes.
+ */
+template<typename E>
+class SortKey {
+public:
+    typedef std::conditional_t<std::is_same_v<E, Track<typename E::ttype>>, vec<shared<E>>, pyvec<E>>
+        container;
+
+    // packed keys longer than this are rejected
+    static constexpr size_t max_words = 4;
+
+    // argsort switches from pdqsort to LSD radix sort at this many items
+    static constexpr size_t radix_threshold = 1024;
+
+    explicit SortKey(const vec<std::string>& keys);
+
+    // number of 64-bit words of a packed key
+    [[nodiscard]] size_t words() const { return word_num; }
+
+    // the packed key of an item, unused words are zero
+    [[nodiscard]] std::array<u64, max_words> pack(const E& item) const;
+
+    // indices that sort the items
+    [[nodiscard]] vec<u32> argsort(const container& items, bool reverse = false) const;
+
+    // sort the items in place, stable for track lists only, see above
+    void sort_inplace(container& items, bool reverse = false) const;
+
+    // sort by argsort, and rebuild the list with the elements copied in order, which also makes
+    // them contiguous in memory. Only for lists whose elements are not referenced from elsewhere
+    void sort_rebuild(pyvec<E>& items, bool reverse = false) const
+        requires(!std::is_same_v<container, vec<shared<E>>>);
+
+    [[nodiscard]] bool is_sorted(const container& items, bool reverse = false) const;
+
+private:
+    struct Part {
+        u8   field;
+        u8   word;
+        u8   shift;
+        bool descending;
+    };
+
+    vec<Part> parts;
+    size_t    word_num = 0;
+
+    // packed keys of all the items, word by word, i.e. keys[i * word_num + w]
+    [[nodiscard]] vec<u64> pack_all(const container& items, bool reverse) const;
+};
+
+// the SortKey of the same order as default_key()
+template<TimeEvent E>
+const SortKey<E>& default_sort_key();
+
+}   // namespace symusic
+
+#endif   // LIBSYMUSIC_SORT_KEY_H
@@ -0,0 +1,108 @@
+#pragma once
+
+#ifndef LIBSYMUSIC_TEMPO_MAP_H
+#define LIBSYMUSIC_TEMPO_MAP_H
+
+#include <span>
+#include "symusic/mtype.h"
+#include "symusic/event.h"
+#include "symusic/score.h"
+
+namespace symusic {
+
+/*
+ *  TempoMap converts times between ticks, quarters and seconds following the tempos of a score.
+ *  The tempos are sorted and integrated once when the map is built: at each tempo change, the
+ *  time in quarters and in seconds is kept, and any time is mapped by a binary search over them,
+ *  or by a cursor when the times are sorted, so converting n times costs O(n) for sorted times.
+ *  Sorted batches are converted segment by segment: a binary search finds where each segment
+ *  ends, and the times in between are mapped by the same affine transform.
+ *  Time 0 is 0 second, the tempo before the first one is 120 qpm (500000 mspq), and the latest
+ *  one at the same time wins. Times before 0 follow the tempo in effect at 0.
+ *  Ticks to quarters doesn't depend on the tempos, only on ticks_per_quarter.
+ *  Score::tempo_map() caches the map of a score until its tempos or ticks_per_quarter change.
+ */
+template<TType T>
+class TempoMap {
+public:
+    typedef T                ttype;
+    typedef typename T::unit unit;
+
+    TempoMap(const pyvec<Tempo<T>>& tempos, i32 ticks_per_quarter);
+
+    explicit TempoMap(const Score<T>& score) :
+        TempoMap(*score.tempos, score.ticks_per_quarter) {}
+
+    [[nodiscard]] i32 ticks_per_quarter() const { return tpq; }
+
+    // number of tempo changes, including the one at 0
+    [[nodiscard]] size_t size() const { return quarters.size(); }
+
+    // heap memory held by the map, including the object itself, in bytes
+    [[nodiscard]] size_t memory_usage() const {
+        return sizeof(TempoMap) + source.capacity() * sizeof(Tempo<T>)
+               + (quarters.capacity() + seconds.capacity() + spq.capacity()) * sizeof(f64);
+    }
+
+    // true if the map is built from exactly these tempos and ticks_per_quarter
+    [[nodiscard]] bool matches(const pyvec<Tempo<T>>& tempos, i32 ticks_per_quarter) const;
+
+    // convert a time from From to To
+    template<TType From, TType To>
+    [[nodiscard]] typename To::unit convert(typename From::unit time) const {
+        size_t hint = 0;
+        return convert<From, To>(time, hint);
+    }
+
+    // the same, starting the search from the tempo change hint, which is updated to the one used
+    template<TType From, TType To>
+    [[nodiscard]] typename To::unit convert(typename From::unit time, size_t& hint) const;
+
+    // convert each time into out, which should be of the same size
+    template<TType From, TType To>
+    void convert(std::span<const typename From::unit> times, std::span<typename To::unit> out) const;
+
+    template<TType From, TType To>
+    [[nodiscard]] vec<typename To::unit> convert(std::span<const typename From::unit> times) const;
+
+private:
+    i32           tpq;
+    vec<Tempo<T>> source;   // the tempos it's built from, in their original order
+    // at each tempo change: the time in quarters and seconds, and seconds per quarter after it
+    vec<f64> quarters;
+    vec<f64> seconds;
+    vec<f64> spq;
+
+    // the constants of the affine mapping between two tempo changes
+    struct Segment {
+        f64 quarters;   // the tempo change, in quarters and in seconds
+        f64 seconds;
+        f64 spq;
+        f64 tpq;
+    };
+
+    [[nodiscard]] Segment segment(const size_t k) const {
+        return {quarters[k], seconds[k], spq[k], static_cast<f64>(tpq)};
+    }
+
+    // the last tempo change at or before x in pivots (quarters or seconds), searched from hint
+    [[nodiscard]] static size_t locate(const vec<f64>& pivots, f64 x, size_t& hint);
+
+    // the time in the pivots it's located in: seconds for Second, quarters otherwise
+    template<TType From>
+    [[nodiscard]] f64 pivot_of(typename From::unit time) const;
+
+    // convert a time with the tempo of its segment
+    template<TType From, TType To>
+    [[nodiscard]] static typename To::unit convert_in(typename From::unit time, const Segment& seg);
+
+    // convert sorted times: they are split into runs of the same segment once, and each run is
+    // mapped by a branch free loop over contiguous memory, which the compiler can vectorize
+    template<TType From, TType To>
+    void convert_sorted(std::span<const typename From::unit> times, std::span<typename To::unit> out)
+        const;
+};
+
+}   // namespace symusic
+
+#endif   // LIBSYMUSIC_TEMPO_MAP_H
@@ -0,0 +1,80 @@
+#pragma once
+
+#ifndef LIBSYMUSIC_TIME_WARP_H
+#define LIBSYMUSIC_TIME_WARP_H
+
+#include "symusic/mtype.h"
+#include "symusic/event.h"
+#include "symusic/track.h"
+#include "symusic/score.h"
+
+namespace symusic {
+
+/*
+ *  TimeWarp is the piecewise linear time map used by adjust_time: original_times[i] is mapped
+ *  to new_times[i], and the times in between are interpolated. Events starting before the first
+ *  anchor or ending after the last one are removed, the same as pretty_midi.
+ *  The slope of each segment is computed once when the warp is built, and the segment of each
+ *  event is found by galloping from the segment of the previous event, so a list sorted by time
+ *  is mapped in a single merge-like walk over the events and the anchors, O(n + m) for n events
+ *  and m anchors, while unsorted lists still cost at most O(log m) per event.
+ *  Since the map is monotone, lists sorted by time stay sorted.
+ *  One warp could be applied to any number of tracks and scores, e.g. the alignment of a
+ *  performance to its score applied to all the takes.
+ */
+template<TType T>
+class TimeWarp {
+public:
+    typedef T                ttype;
+    typedef typename T::unit unit;
+
+    // throws std::invalid_argument unless the times are sorted, of the same size, and at least 2
+    TimeWarp(vec<unit> original_times, vec<unit> new_times);
+
+    [[nodiscard]] const vec<unit>& original_times() const { return src; }
+
+    [[nodiscard]] const vec<unit>& new_times() const { return dst; }
+
+    // number of anchors
+    [[nodiscard]] size_t size() const { return src.size(); }
+
+    // map a single time, throws std::out_of_range if it is out of the anchors
+    [[nodiscard]] unit operator()(unit time) const;
+
+    template<TimeEvent E>
+    void apply_inplace(pyvec<E>& events) const;
+
+    void apply_inplace(Track<T>& track) const;
+
+    // the tracks are processed in parallel if the policy allows it, see parallel.h
+    void apply_inplace(Score<T>& score, ExecPolicy policy = ExecPolicy::SEQUENTIAL) const;
+
+    // apply the warp to all the tracks (or scores)
+    void apply_inplace(const vec<shared<Track<T>>>& tracks) const;
+
+    void apply_inplace(const vec<shared<Score<T>>>& scores) const;
+
+    [[nodiscard]] Track<T> apply(const Track<T>& track) const;
+
+    [[nodiscard]] Score<T> apply(
+        const Score<T>& score, ExecPolicy policy = ExecPolicy::SEQUENTIAL
+    ) const;
+
+private:
+    vec<unit> src;
+    vec<unit> dst;
+    // slopes[k] is the slope of the k-th segment, (src[k - 1], src[k]], slopes[0] is unused
+    vec<f64> slopes;
+
+    // the first k >= 1 with src[k] >= time, searched from the segment hint.
+    // time must be in [src.front(), src.back()]
+    [[nodiscard]] size_t locate(unit time, size_t hint) const;
+
+    [[nodiscard]] unit map(const unit time, const size_t k) const {
+        return dst[k - 1] + static_cast<unit>(slopes[k] * static_cast<f64>(time - src[k - 1]));
+    }
+};
+
+}   // namespace symusic
+
+#endif   // LIBSYMUSIC_TIME_WARP_H
@@ -6,13 +6,98 @@
 #ifndef LIBSYMUSIC_TRACK_H
 #define LIBSYMUSIC_TRACK_H
 
+#include <algorithm>
+#include <cassert>
 #include <span>
 #include "symusic/mtype.h"
 #include "symusic/io/iodef.h"
 #include "symusic/event.h"
+#include "symusic/memory.h"
 
 
 namespace symusic {
+
+namespace details {
+// whether two shared_ptrs share the same control block, e.g. lists allocated in one block
+template<typename A, typename B>
+bool same_owner(const shared<A>& a, const shared<B>& b) {
+    return !a.owner_before(b) && !b.owner_before(a);
+}
+
+// replace a list with a private deep copy if it is still held by someone else,
+// own is the number of references to its control block held by the owner itself
+template<typename T>
+void detach_list(shared<pyvec<T>>& list, const long own = 1) {
+    if (list.use_count() > own) list = std::make_shared<pyvec<T>>(std::move(list->deepcopy()));
+}
+
+// whether the events are sorted by time, used to check the time_sorted flags in debug builds
+template<typename T>
+bool is_sorted_by_time(const pyvec<T>& events) {
+    return std::is_sorted(events.begin(), events.end(), [](const T& a, const T& b) {
+        return a.time < b.time;
+    });
+}
+
+// all the event lists of a track, allocated in a single block along with the control block
+template<TType T>
+struct TrackLists {
+    pyvec<Note<T>>          notes;
+    pyvec<ControlChange<T>> controls;
+    pyvec<PitchBend<T>>     pitch_bends;
+    pyvec<Pedal<T>>         pedals;
+    pyvec<TextMeta<T>>      lyrics;
+
+    TrackLists() = default;
+
+    TrackLists(
+        pyvec<Note<T>>&&          notes,
+        pyvec<ControlChange<T>>&& controls,
+        pyvec<PitchBend<T>>&&     pitch_bends,
+        pyvec<Pedal<T>>&&         pedals,
+        pyvec<TextMeta<T>>&&      lyrics
+    ) :
+        notes{std::move(notes)}, controls{std::move(controls)},
+        pitch_bends{std::move(pitch_bends)}, pedals{std::move(pedals)}, lyrics{std::move(lyrics)} {}
+};
+
+// rebuild a list into a tight buffer, if it is only held by the caller
+template<typename T>
+void shrink_list(shared<pyvec<T>>& list, const long own = 1) {
+    if (list.use_count() == own) list = std::make_shared<pyvec<T>>(std::move(list->collect()));
+}
+
+// move a list out of its block into an allocation of its own, or copy it if the block is
+// also held by others, who still read the list in it
+template<typename T>
+void leave_block(shared<pyvec<T>>& list, const bool shared_block) {
+    if (shared_block) {
+        list = std::make_shared<pyvec<T>>(std::move(list->deepcopy()));
+    } else {
+        list = std::make_shared<pyvec<T>>(std::move(*list));
+    }
+}
+}   // namespace details
+
+// how resolve_overlaps handles a note starting before the previous note of the same pitch ends
+enum class OverlapPolicy : u8 {
+    KEEP_FIRST,          // remove the later note
+    KEEP_LONGEST,        // remove the shorter one of the two, the later one is removed on ties
+    TRUNCATE_PREVIOUS,   // end the earlier note at the onset of the later one
+};
+
+// what dedup_notes and resolve_overlaps changed
+struct OverlapStats {
+    size_t removed   = 0;
+    size_t truncated = 0;
+
+    OverlapStats& operator+=(const OverlapStats& o) {
+        removed += o.removed;
+        truncated += o.truncated;
+        return *this;
+    }
+};
+
 template<TType T>
 struct Track {
     typedef T                ttype;
@@ -27,25 +112,40 @@ struct Track {
     shared<pyvec<Pedal<T>>>         pedals;
     shared<pyvec<TextMeta<T>>>      lyrics;
 
+    // bit masks of the event lists, used by the copy-on-write methods below
+    enum : u8 {
+        NOTES       = 1 << 0,
+        CONTROLS    = 1 << 1,
+        PITCH_BENDS = 1 << 2,
+        PEDALS      = 1 << 3,
+        LYRICS      = 1 << 4,
+        ALL         = NOTES | CONTROLS | PITCH_BENDS | PEDALS | LYRICS,
+    };
+
+    // lists that have been handed out (e.g. to python) or shared on purpose by copy(), they could
+    // be modified at any time, and are never detached
+    u8 exposed = 0;
+    // lists known to be sorted by time, it's only trusted for the lists not exposed.
+    // The methods keep it up to date, but the lists above are public: code that modifies them
+    // directly (e.g. push_back) must clear the bits of the modified lists, or expose them.
+    // start, end, clip and segment trust it without checking in release builds (is_time_sorted
+    // asserts it in debug builds), and clip with clip_end also assumes that the notes and
+    // pedals of a sorted list have no negative duration. The MIDI writer checks it anyway
+    u8 time_sorted = 0;
+
     POINTER_METHODS(Track)
 
     Track() : name{""}, program{0}, is_drum{false} {
-        notes       = std::make_shared<pyvec<Note<T>>>();
-        controls    = std::make_shared<pyvec<ControlChange<T>>>();
-        pitch_bends = std::make_shared<pyvec<PitchBend<T>>>();
-        pedals      = std::make_shared<pyvec<Pedal<T>>>();
-        lyrics      = std::make_shared<pyvec<TextMeta<T>>>();
+        alloc_lists(std::make_shared<details::TrackLists<T>>());
     }
 
-    Track(const Track&) = default;
+    // a copy shares the lists copy-on-write, the same as cow_copy, so that neither of the two
+    // tracks can modify the lists of the other one
+    Track(const Track& other) : Track(other.cow_copy()) {}
 
     Track(std::string name, const u8 program, const bool is_drum) :
         name{std::move(name)}, program{program}, is_drum{is_drum} {
-        notes       = std::make_shared<pyvec<Note<T>>>();
-        controls    = std::make_shared<pyvec<ControlChange<T>>>();
-        pitch_bends = std::make_shared<pyvec<PitchBend<T>>>();
-        pedals      = std::make_shared<pyvec<Pedal<T>>>();
-        lyrics      = std::make_shared<pyvec<TextMeta<T>>>();
+        alloc_lists(std::make_shared<details::TrackLists<T>>());
     }
 
     void move_other(Track&& other) {
@@ -57,6 +157,9 @@ struct Track {
         pitch_bends = std::move(other.pitch_bends);
         pedals      = std::move(other.pedals);
         lyrics      = std::move(other.lyrics);
+        exposed     = other.exposed;
+        time_sorted = other.time_sorted;
+        other.exposed = 0;
     }
 
     Track(Track&& other) noexcept { move_other(std::move(other)); }
@@ -74,11 +177,13 @@ struct Track {
         this->name        = std::move(name);
         this->program     = program;
         this->is_drum     = is_drum;
-        this->notes       = std::make_shared<pyvec<Note<T>>>(std::move(notes));
-        this->controls    = std::make_shared<pyvec<ControlChange<T>>>(std::move(controls));
-        this->pitch_bends = std::make_shared<pyvec<PitchBend<T>>>(std::move(pitch_bends));
-        this->pedals      = std::make_shared<pyvec<Pedal<T>>>(std::move(pedals));
-        this->lyrics      = std::make_shared<pyvec<TextMeta<T>>>(std::move(lyrics));
+        alloc_lists(std::make_shared<details::TrackLists<T>>(
+            std::move(notes),
+            std::move(controls),
+            std::move(pitch_bends),
+            std::move(pedals),
+            std::move(lyrics)
+        ));
     }
 
 
@@ -102,13 +207,79 @@ struct Track {
         lyrics{std::move(lyrics)} {}
         // clang-format on
 
+    // point all the lists into one allocated block, using the aliasing constructor of shared_ptr,
+    // so that a track costs one allocation instead of five. Replace a single list only after
+    // unpool(), or the old one stays in the block. The block is freed when no list
+    // in it is referenced anymore.
+    void alloc_lists(const shared<details::TrackLists<T>>& block) {
+        notes       = {block, &block->notes};
+        controls    = {block, &block->controls};
+        pitch_bends = {block, &block->pitch_bends};
+        pedals      = {block, &block->pedals};
+        lyrics      = {block, &block->lyrics};
+    }
+
+    // number of references to the control block of the list held by the track itself
+    template<typename L>
+    [[nodiscard]] long own_refs(const shared<L>& list) const {
+        return details::same_owner(list, notes) + details::same_owner(list, controls)
+               + details::same_owner(list, pitch_bends) + details::same_owner(list, pedals)
+               + details::same_owner(list, lyrics);
+    }
+
     auto default_key() const { return std::make_tuple(is_drum, program, name, notes->size()); }
 
-    // shallow copy
-    [[nodiscard]] Track copy() const { return {*this}; }
+    // shallow copy, which holds the same lists as this track, so the changes made through either
+    // are seen by both. The lists are exposed on both sides, since either could change them
+    // without the other noticing. Unlike the copy constructor, which makes a copy-on-write copy
+    [[nodiscard]] Track copy() {
+        expose();
+        Track ans{name, program, is_drum, notes, controls, pitch_bends, pedals, lyrics};
+        ans.exposed = ALL;
+        return ans;
+    }
+
+    // copy-on-write copy, which behaves like deepcopy but shares the event lists
+    // until one of the two tracks mutates them. Exposed lists are copied eagerly.
+    // It only reads this track, so it's safe to copy one track from several threads
+    [[nodiscard]] Track cow_copy() const;
+
+    // make sure the given lists are not shared with others before mutating them. A list is
+    // copied if anyone else holds it (use_count), the exposed lists are left as they are
+    void detach(u8 kinds = ALL);
+
+    // unpool, detach the given lists and mark them as exposed, call it before handing them out.
+    // So an exposed list never sits in the block allocated by alloc_lists
+    void expose(u8 kinds = ALL);
+
+    // the lists still in the block allocated by alloc_lists. They are detached and shrunk
+    // together, so that no list is left behind in a block kept alive by the others
+    [[nodiscard]] u8 pooled() const;
+
+    // whether the block of the pooled lists is also held by others, e.g. copy-on-write copies
+    [[nodiscard]] bool block_shared(u8 pooled) const;
+
+    // give each list its own allocation, moving it out of the block if no one else holds the
+    // block and copying it otherwise. Call it before replacing a single list
+    void unpool();
+
+    // return true if all the given lists are known to be sorted by time
+    [[nodiscard]] bool is_time_sorted(const u8 kinds) const {
+        const bool ans = (time_sorted & ~exposed & kinds) == kinds;
+        // the callers skip sorting on it, so catch the lists modified without clearing the flag
+        assert(
+            !ans
+            || ((!(kinds & NOTES) || details::is_sorted_by_time(*notes))
+                && (!(kinds & CONTROLS) || details::is_sorted_by_time(*controls))
+                && (!(kinds & PITCH_BENDS) || details::is_sorted_by_time(*pitch_bends))
+                && (!(kinds & PEDALS) || details::is_sorted_by_time(*pedals))
+                && (!(kinds & LYRICS) || details::is_sorted_by_time(*lyrics)))
+        );
+        return ans;
+    }
 
     [[nodiscard]] Track deepcopy() const {
-        return {
+        Track ans{
             name,
             program,
             is_drum,
@@ -118,9 +289,15 @@ struct Track {
             std::move(pedals->deepcopy()),
             std::move(lyrics->deepcopy())
         };
+        ans.time_sorted = time_sorted & ~exposed;
+        return ans;
+    }
+
+    Track& operator=(const Track& other) {
+        if (this != &other) move_other(other.cow_copy());
+        return *this;
     }
 
-    Track& operator=(const Track&) = default;
     Track& operator=(Track&& other) noexcept {
         move_other(std::move(other));
         return *this;
@@ -160,6 +337,12 @@ struct Track {
     // return true if the track is empty
     [[nodiscard]] bool empty() const;
 
+    // estimated heap memory held by the track
+    [[nodiscard]] MemoryUsage memory_usage() const;
+
+    // release the unused capacity of the lists, lists exposed or shared with others are skipped
+    void shrink_to_fit();
+
     // return a string representation of the track, same as summary
     [[nodiscard]] std::string to_string() const;
 
@@ -185,16 +368,42 @@ struct Track {
     void shift_time_inplace(unit offset);
 
     // shift the pitch of all notes in the track, non-inplace, return a new Track
-    [[nodiscard]] Track shift_pitch(i8 offset) const;
+    // throws std::range_error if any pitch goes out of [0, 127], unless saturate is set,
+    // in which case the pitches are clamped into the range
+    [[nodiscard]] Track shift_pitch(i8 offset, bool saturate = false) const;
 
     // shift the pitch of all notes in the track, inplace, return self reference
-    void shift_pitch_inplace(i8 offset);
+    void shift_pitch_inplace(i8 offset, bool saturate = false);
 
     // shift the velocity of all notes in the track, non-inplace, return a new Track
-    [[nodiscard]] Track shift_velocity(i8 offset) const;
+    [[nodiscard]] Track shift_velocity(i8 offset, bool saturate = false) const;
 
     // shift the velocity of all notes in the track, inplace, return self reference
-    void shift_velocity_inplace(i8 offset);
+    void shift_velocity_inplace(i8 offset, bool saturate = false);
+
+    // shift time, pitch and velocity together, visiting each note only once
+    [[nodiscard]] Track shift(unit time, i8 pitch, i8 velocity, bool saturate = false) const;
+
+    void shift_inplace(unit time, i8 pitch, i8 velocity, bool saturate = false);
+
+    // extend the notes released under the sustain pedals to the pedal release, see
+    // ops::apply_sustain_inplace. The pedals are kept
+    [[nodiscard]] Track apply_sustain() const;
+
+    void apply_sustain_inplace();
+
+    // remove the notes with the same pitch, time and duration as an earlier one in the list,
+    // return the number of removed notes
+    OverlapStats dedup_notes_inplace();
+
+    [[nodiscard]] Track dedup_notes() const;
+
+    // resolve the overlapping notes of the same pitch by the policy, in one pass per pitch over
+    // the notes sorted by time. With TRUNCATE_PREVIOUS, a note truncated to zero duration (the
+    // two notes start together) is removed. The order of the other notes is kept
+    OverlapStats resolve_overlaps_inplace(OverlapPolicy policy = OverlapPolicy::KEEP_FIRST);
+
+    [[nodiscard]] Track resolve_overlaps(OverlapPolicy policy = OverlapPolicy::KEEP_FIRST) const;
 };
 
 /*
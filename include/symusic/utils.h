@@ -6,10 +6,42 @@
 #ifndef LIBSYMUSIC_UTILS_H
 #define LIBSYMUSIC_UTILS_H
 
+#include <span>
 #include <string>
+#include <string_view>
+#include "unordered_dense.h"
+#include "symusic/mtype.h"
 
 namespace symusic::details {
-std::string strip_non_utf_8(const std::string & str);
-}
+// replace invalid utf-8 sequences, pure ascii or already valid text is copied directly
+std::string strip_non_utf_8(std::string_view str);
+
+/*
+ *  TextDecoder decodes the text payloads in a midi file into valid utf-8 strings.
+ *  Lyrics in karaoke files repeat the same syllables again and again, so the decoded
+ *  payloads are interned, and each distinct payload is only decoded once.
+ */
+class TextDecoder {
+public:
+    // return the decoded text, which is valid until the next call
+    const std::string& operator()(std::span<const u8> bytes);
+
+private:
+    // payloads longer than this are decoded every time instead of being interned
+    static constexpr size_t max_interned = 64;
+
+    struct Hash {
+        using is_transparent = void;
+        using is_avalanching = void;
+
+        [[nodiscard]] u64 operator()(const std::string_view str) const noexcept {
+            return ankerl::unordered_dense::hash<std::string_view>{}(str);
+        }
+    };
+
+    ankerl::unordered_dense::map<std::string, std::string, Hash, std::equal_to<>> interned;
+    std::string                                                                  scratch;
+};
+}   // namespace symusic::details
 
 #endif //LIBSYMUSIC_UTILS_H
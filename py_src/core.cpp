@@ -3,6 +3,7 @@
 //
 #include <string>
 #include <random>
+#include <limits>
 #include <nanobind/nanobind.h>
 #include <nanobind/stl/optional.h>
 #include <nanobind/stl/string.h>
@@ -81,7 +82,7 @@ shared<vec<shared<T>>> deepcopy(const shared<vec<shared<T>>>& self) {
     auto ans = std::make_shared<vec<shared<T>>>();
     ans->reserve(self->size());
     for (const auto& item : *self) {
-        ans->push_back(std::make_shared<T>(std::move(item->deepcopy())));
+        ans->push_back(std::make_shared<T>(std::move(item->cow_copy())));
     }
     return ans;
 }
@@ -100,6 +101,144 @@ std::pair<u8, u8> get_pitch_range(const std::pair<i64, i64>& range) {
     return {static_cast<u8>(range.first), static_cast<u8>(range.second)};
 }
 
+ops::QuantizeMode get_quantize_mode(const std::string& mode) {
+    if (mode == "onset") return ops::QuantizeMode::ONSET;
+    if (mode == "offset") return ops::QuantizeMode::OFFSET;
+    if (mode == "both") return ops::QuantizeMode::BOTH;
+    throw std::invalid_argument(
+        "Quantize mode \"" + mode + "\" is invalid, expected one of onset, offset and both"
+    );
+}
+
+OverlapPolicy get_overlap_policy(const std::string& policy) {
+    if (policy == "keep_first") return OverlapPolicy::KEEP_FIRST;
+    if (policy == "keep_longest") return OverlapPolicy::KEEP_LONGEST;
+    if (policy == "truncate_previous") return OverlapPolicy::TRUNCATE_PREVIOUS;
+    throw std::invalid_argument(
+        "Overlap policy \"" + policy
+        + "\" is invalid, expected one of keep_first, keep_longest and truncate_previous"
+    );
+}
+
+inline ExecPolicy get_exec_policy(const bool parallel) {
+    return parallel ? ExecPolicy::PARALLEL : ExecPolicy::SEQUENTIAL;
+}
+
+ops::SegmentUnit get_segment_unit(const std::string& unit) {
+    if (unit == "bar") return ops::SegmentUnit::BAR;
+    if (unit == "time") return ops::SegmentUnit::TIME;
+    if (unit == "second") return ops::SegmentUnit::SECOND;
+    throw std::invalid_argument(
+        "Segment unit \"" + unit + "\" is invalid, expected one of bar, time and second"
+    );
+}
+
+// indices of the tracks chosen by a list of indices, a predicate expression or a callable
+template<TType T>
+vec<size_t> select_tracks(const vec<shared<Track<T>>>& tracks, const nb::object& selector) {
+    vec<size_t> ans;
+    if (nb::isinstance<nb::str>(selector)) {
+        const auto mask = Predicate<Track<T>>(nb::cast<std::string>(selector)).mask(tracks);
+        for (size_t i = 0; i < mask.size(); ++i) {
+            if (mask[i]) ans.push_back(i);
+        }
+    } else if (nb::isinstance<nb::callable>(selector)) {
+        const auto func = nb::cast<nb::callable>(selector);
+        for (size_t i = 0; i < tracks.size(); ++i) {
+            if (nb::cast<bool>(func(tracks[i]))) ans.push_back(i);
+        }
+    } else {
+        ans = nb::cast<vec<size_t>>(selector);
+    }
+    return ans;
+}
+
+// 0 for tick, 1 for quarter and 2 for second, given a time unit or its name
+inline int ttype_index(const nb::object& ttype) {
+    if (nb::isinstance<Tick>(ttype)) return 0;
+    if (nb::isinstance<Quarter>(ttype)) return 1;
+    if (nb::isinstance<Second>(ttype)) return 2;
+    if (nb::isinstance<nb::str>(ttype)) {
+        const auto ttype_str = nb::cast<std::string>(ttype.attr("lower")());
+        if (ttype_str == "tick") return 0;
+        if (ttype_str == "quarter") return 1;
+        if (ttype_str == "second") return 2;
+    }
+    throw std::invalid_argument("ttype must be Tick, Quarter, Second or string");
+}
+
+template<TType T>
+typename T::unit cast_time(const nb::object& t) {
+    typedef typename T::unit unit;
+    if (t.is_none()) return static_cast<unit>(0);
+    return nb::cast<unit>(t);
+}
+
+template<TType To, TType From>
+nb::object convert_score_inner(
+    const shared<Score<From>>& self,
+    const nb::object&          min_dur,
+    const nb::object&          start,
+    const nb::object&          end,
+    const bool                 parallel
+) {
+    typedef typename From::unit unit;
+    const auto policy = get_exec_policy(parallel);
+    if (start.is_none() && end.is_none()) {
+        return nb::cast(
+            std::make_shared<Score<To>>(convert<To>(*self, cast_time<To>(min_dur), policy)),
+            nb::rv_policy::copy
+        );
+    }
+    const unit lo = start.is_none() ? std::numeric_limits<unit>::lowest() : nb::cast<unit>(start);
+    const unit hi = end.is_none() ? std::numeric_limits<unit>::max() : nb::cast<unit>(end);
+    return nb::cast(
+        std::make_shared<Score<To>>(convert<To>(*self, lo, hi, cast_time<To>(min_dur), policy)),
+        nb::rv_policy::copy
+    );
+}
+
+template<typename T>
+nb::object convert_score(
+    const shared<Score<T>>& self,
+    const nb::object&       ttype,
+    const nb::object&       min_dur,
+    const nb::object&       start,
+    const nb::object&       end,
+    const bool              parallel
+) {
+    if (ttype.is_none()) throw std::invalid_argument("ttype must be specified");
+    switch (ttype_index(ttype)) {
+        case 0: return convert_score_inner<Tick>(self, min_dur, start, end, parallel);
+        case 1: return convert_score_inner<Quarter>(self, min_dur, start, end, parallel);
+        default: return convert_score_inner<Second>(self, min_dur, start, end, parallel);
+    }
+}
+
+template<TType To, TType From>
+nb::object convert_track_inner(
+    const shared<Track<From>>& self, const TempoMap<From>& tempo_map, const nb::object& min_dur
+) {
+    return nb::cast(
+        std::make_shared<Track<To>>(convert<To>(*self, tempo_map, cast_time<To>(min_dur))),
+        nb::rv_policy::copy
+    );
+}
+
+template<typename T>
+nb::object convert_track(
+    const shared<Track<T>>& self,
+    const nb::object&       ttype,
+    const TempoMap<T>&      tempo_map,
+    const nb::object&       min_dur
+) {
+    if (ttype.is_none()) throw std::invalid_argument("ttype must be specified");
+    switch (ttype_index(ttype)) {
+        case 0: return convert_track_inner<Tick>(self, tempo_map, min_dur);
+        case 1: return convert_track_inner<Quarter>(self, tempo_map, min_dur);
+        default: return convert_track_inner<Second>(self, tempo_map, min_dur);
+    }
+}
 
 template<TType T>
 auto bind_track(nb::module_& m, const std::string& name_) {
@@ -109,9 +248,9 @@ auto bind_track(nb::module_& m, const std::string& name_) {
     using track_t   = Track<T>;
     using vec_t     = shared<vec<self_t>>;
 
-    auto copy_func = [](const self_t& self) { return std::make_shared<track_t>(*self); };
+    auto copy_func = [](const self_t& self) { return std::make_shared<track_t>(self->copy()); };
     auto deepcopy_func
-        = [](const self_t& self) { return std::make_shared<track_t>(std::move(self->deepcopy())); };
+        = [](const self_t& self) { return std::make_shared<track_t>(std::move(self->cow_copy())); };
 
     // clang-format off
     auto track = nb::class_<shared<Track<T>>>(m, name.c_str())
@@ -119,7 +258,7 @@ auto bind_track(nb::module_& m, const std::string& name_) {
         .def("__init__", &pyinit<Track<T>, std::string, u8, const bool>,
             nb::arg("name"), nb::arg("program")=0, nb::arg("is_drum")=false)
         .def("__init__", [](self_t *self, const self_t& other) {
-            new (self) std::shared_ptr<track_t>(std::move(std::make_shared<track_t>(std::move(other->deepcopy()))));
+            new (self) std::shared_ptr<track_t>(std::move(std::make_shared<track_t>(std::move(other->cow_copy()))));
         }, "Copy constructor", nb::arg("other"))
         .def("copy", [&](const self_t &self, const bool deep) {
             if (deep) return deepcopy_func(self);
@@ -143,11 +282,11 @@ auto bind_track(nb::module_& m, const std::string& name_) {
         })
         .def_prop_ro("ttype", [](const self_t&) { return T(); })
         .def("__use_count", [](const self_t& self) { return self.use_count(); })
-        .def_prop_rw(RW_COPY(shared<pyvec<Note<T>>>, "notes", notes))
-        .def_prop_rw(RW_COPY(shared<pyvec<ControlChange<T>>>, "controls", controls))
-        .def_prop_rw(RW_COPY(shared<pyvec<Pedal<T>>>, "pedals", pedals))
-        .def_prop_rw(RW_COPY(shared<pyvec<PitchBend<T>>>, "pitch_bends", pitch_bends))
-        .def_prop_rw(RW_COPY(shared<pyvec<TextMeta<T>>>, "lyrics", lyrics))
+        .def_prop_rw(RW_COW(shared<pyvec<Note<T>>>, "notes", notes, track_t::NOTES))
+        .def_prop_rw(RW_COW(shared<pyvec<ControlChange<T>>>, "controls", controls, track_t::CONTROLS))
+        .def_prop_rw(RW_COW(shared<pyvec<Pedal<T>>>, "pedals", pedals, track_t::PEDALS))
+        .def_prop_rw(RW_COW(shared<pyvec<PitchBend<T>>>, "pitch_bends", pitch_bends, track_t::PITCH_BENDS))
+        .def_prop_rw(RW_COW(shared<pyvec<TextMeta<T>>>, "lyrics", lyrics, track_t::LYRICS))
         .def_prop_rw(RW_COPY(bool, "is_drum", is_drum))
         .def_prop_rw(RW_COPY(u8, "program", program))
         .def_prop_rw(RW_COPY(std::string, "name", name))
@@ -159,36 +298,80 @@ auto bind_track(nb::module_& m, const std::string& name_) {
         .def("start", [](const self_t& self) { return self->start(); })
         .def("note_num", [](const self_t& self) { return self->note_num(); })
         .def("empty", [](const self_t& self) { return self->empty(); })
+        .def("to", [](const self_t& self, const nb::object& ttype, const shared<const TempoMap<T>>& tempo_map, const nb::object& min_dur) {
+            return convert_track<T>(self, ttype, *tempo_map, min_dur);
+        }, nb::arg("ttype"), nb::arg("tempo_map"), nb::arg("min_dur") = nb::none(),
+            "Convert to another time unit following the tempo map of its score, e.g. score.tempo_map()")
         .def("clip", [](self_t& self, const unit start, const unit end, const bool clip_end, const bool inplace) {
-            self_t ans = inplace ? self : std::make_shared<track_t>(std::move(self->deepcopy()));
-            ans->clip_inplace(start, end, clip_end);
-            return ans;
+            if (inplace) {
+                self->clip_inplace(start, end, clip_end);
+                return self;
+            }   return std::make_shared<track_t>(std::move(self->clip(start, end, clip_end)));
         }, nb::arg("start"), nb::arg("end"), nb::arg("clip_end") = false, nb::arg("inplace") = false)
         .def("sort", [](self_t& self, const bool reverse, const bool inplace) {
-            self_t ans = inplace ? self : std::make_shared<track_t>(std::move(self->deepcopy()));
+            self_t ans = inplace ? self : std::make_shared<track_t>(std::move(self->cow_copy()));
             ans->sort_inplace(reverse);
             return ans;
         }, nb::arg("reverse") = false, nb::arg("inplace") = true)
         .def("adjust_time", [](self_t& self, const vec<unit>& original_times, const vec<unit>& new_times, const bool inplace) {
-            self_t ans = inplace ? self : std::make_shared<track_t>(std::move(self->deepcopy()));
+            self_t ans = inplace ? self : std::make_shared<track_t>(std::move(self->cow_copy()));
             ops::adjust_time_inplace(*ans, original_times, new_times);
             return ans;
         }, nb::arg("original_times"), nb::arg("new_times"), nb::arg("inplace") = false)
         .def("shift_time", [](self_t& self, const unit offset, const bool inplace) {
-            self_t ans = inplace ? self : std::make_shared<track_t>(std::move(self->deepcopy()));
+            self_t ans = inplace ? self : std::make_shared<track_t>(std::move(self->cow_copy()));
             ans->shift_time_inplace(offset);
             return ans;
         }, nb::arg("offset"), nb::arg("inplace") = false)
-        .def("shift_pitch", [](self_t& self, const i8 offset, const bool inplace) {
-            self_t ans = inplace ? self : std::make_shared<track_t>(std::move(self->deepcopy()));
-            ans->shift_pitch_inplace(offset);
+        .def("shift_pitch", [](self_t& self, const i8 offset, const bool saturate, const bool inplace) {
+            self_t ans = inplace ? self : std::make_shared<track_t>(std::move(self->cow_copy()));
+            ans->shift_pitch_inplace(offset, saturate);
             return ans;
-        }, nb::arg("offset"), nb::arg("inplace") = false)
-        .def("shift_velocity", [](self_t& self, const i8 offset, const bool inplace) {
-            self_t ans = inplace ? self : std::make_shared<track_t>(std::move(self->deepcopy()));
-            ans->shift_velocity_inplace(offset);
+        }, nb::arg("offset"), nb::arg("saturate") = false, nb::arg("inplace") = false)
+        .def("shift_velocity", [](self_t& self, const i8 offset, const bool saturate, const bool inplace) {
+            self_t ans = inplace ? self : std::make_shared<track_t>(std::move(self->cow_copy()));
+            ans->shift_velocity_inplace(offset, saturate);
             return ans;
-        }, nb::arg("offset"), nb::arg("inplace") = false)
+        }, nb::arg("offset"), nb::arg("saturate") = false, nb::arg("inplace") = false)
+        .def("shift", [](self_t& self, const unit time, const i8 pitch, const i8 velocity, const bool saturate, const bool inplace) {
+            self_t ans = inplace ? self : std::make_shared<track_t>(std::move(self->cow_copy()));
+            ans->shift_inplace(time, pitch, velocity, saturate);
+            return ans;
+        }, nb::arg("time") = 0, nb::arg("pitch") = 0, nb::arg("velocity") = 0, nb::arg("saturate") = false, nb::arg("inplace") = false,
+            "Shift time, pitch and velocity of the track in a single pass over the notes")
+        .def("quantize", [](self_t& self, const f64 grid, const std::string& mode, const unit min_dur, const f64 swing, const bool inplace) {
+            self_t ans = inplace ? self : std::make_shared<track_t>(std::move(self->cow_copy()));
+            ops::quantize_inplace(*ans, grid, get_quantize_mode(mode), min_dur, swing);
+            return ans;
+        }, nb::arg("grid"), nb::arg("mode") = "both", nb::arg("min_dur") = 0, nb::arg("swing") = 0., nb::arg("inplace") = false,
+            "Snap the events to a grid of the given step, with odd grid points delayed by swing * grid")
+        .def("apply_sustain", [](self_t& self, const bool inplace) {
+            self_t ans = inplace ? self : std::make_shared<track_t>(std::move(self->cow_copy()));
+            ans->apply_sustain_inplace();
+            return ans;
+        }, nb::arg("inplace") = false, "Extend the notes released under the sustain pedals to the pedal release")
+        .def("dedup_notes", [](self_t& self, const bool inplace) {
+            self_t ans = inplace ? self : std::make_shared<track_t>(std::move(self->cow_copy()));
+            const auto stats = ans->dedup_notes_inplace();
+            return nb::make_tuple(ans, overlap_stats_dict(stats));
+        }, nb::arg("inplace") = false,
+            "Remove the notes with the same pitch, time and duration as an earlier one, return (track, stats)")
+        .def("resolve_overlaps", [](self_t& self, const std::string& policy, const bool inplace) {
+            self_t ans = inplace ? self : std::make_shared<track_t>(std::move(self->cow_copy()));
+            const auto stats = ans->resolve_overlaps_inplace(get_overlap_policy(policy));
+            return nb::make_tuple(ans, overlap_stats_dict(stats));
+        }, nb::arg("policy") = "keep_first", nb::arg("inplace") = false,
+            "Resolve the overlapping notes of the same pitch, return (track, stats)")
+        .def("compact", [](const self_t& self, const size_t block_size) {
+            return std::make_shared<CompactTrack<T>>(*self, block_size);
+        }, nb::arg("block_size") = 128)
+        .def("memory_usage", [](const self_t& self) { return memory_usage_dict(self->memory_usage()); },
+            "Estimated heap memory held by the track in bytes, broken down by kind")
+        .def("shrink_to_fit", [](const self_t& self) { self->shrink_to_fit(); return self; },
+            "Release the unused capacity of the event lists")
+        .def("interval_index", [](const self_t& self) {
+            return std::make_shared<IntervalIndex<T>>(*self);
+        }, "Build an IntervalIndex of the notes for overlap queries")
     ;
 
     if constexpr (std::is_same_v<T, Tick>) {
@@ -221,18 +404,27 @@ auto bind_track(nb::module_& m, const std::string& name_) {
         .def_prop_ro("ttype", [](const vec_t&) { return T(); })
         .def("filter", [](const vec_t& self, const nb::object & func, const bool inplace) {
             auto ans = inplace ? self : std::make_shared<vec<self_t>>(self->begin(), self->end());
+            if (nb::isinstance<nb::str>(func)) {
+                Predicate<track_t>(nb::cast<std::string>(func)).filter_inplace(*ans);
+                return ans;
+            }
             auto it = std::remove_if(ans->begin(), ans->end(), [&](const self_t& t) {
                 return !nb::cast<bool>(nb::cast<nb::callable>(func)(t));
             });
             ans->erase(it, ans->end());
             return ans;
         }, nb::arg("function"), nb::arg("inplace") = true)
+        .def("mask", [](const vec_t& self, const std::string& expr) {
+            return mask_to_numpy(Predicate<track_t>(expr).mask(*self));
+        }, nb::arg("expr"), "Boolean numpy array of whether each track satisfies the predicate expression")
         .def("sort", [](vec_t& self, const nb::object& key, const bool reverse,  const bool inplace) {
             auto ans = inplace ? self : std::make_shared<vec<self_t>>(self->begin(), self->end());
             if(key.is_none()) {
                 auto cmp = [](const self_t& a, const self_t& b) { return a->default_key() < b->default_key(); };
                 if (reverse) gfx::timsort(ans->rbegin(), ans->rend(), cmp);
                 else gfx::timsort(ans->begin(), ans->end(), cmp);
+            } else if(const auto fields = sort_fields(key)) {
+                SortKey<track_t>(*fields).sort_inplace(*ans, reverse);
             } else {
                 auto key_ = nb::cast<nb::callable>(key);
                 auto cmp = [&](const self_t& a, const self_t& b) { return key_(a) < key_(b); };
@@ -240,11 +432,22 @@ auto bind_track(nb::module_& m, const std::string& name_) {
                 else gfx::timsort(ans->begin(), ans->end(), cmp);
             }   return ans;
         }, nb::arg("key") = nb::none(), nb::arg("reverse") = false, nb::arg("inplace") = true)
+        .def("argsort", [](const vec_t& self, const nb::object& key, const bool reverse) {
+            if(key.is_none()) return vec_to_numpy(default_argsort(*self, reverse));
+            const auto fields = sort_fields(key);
+            if(!fields) {
+                throw std::invalid_argument("symusic::argsort: key should be a field name or a tuple of field names");
+            }
+            return vec_to_numpy(SortKey<track_t>(*fields).argsort(*self, reverse));
+        }, nb::arg("key") = nb::none(), nb::arg("reverse") = false,
+            "Stable indices that sort the tracks, by the default key or by field names like (\"-is_drum\", \"program\")")
         .def("is_sorted", [](const vec_t& self, const nb::object& key, const bool reverse) {
             if(key.is_none()) {
                 auto cmp = [](const self_t& a, const self_t& b) { return a->default_key() < b->default_key(); };
                 if (reverse) return std::is_sorted(self->rbegin(), self->rend(), cmp);
                 else return std::is_sorted(self->begin(), self->end(), cmp);
+            } else if(const auto fields = sort_fields(key)) {
+                return SortKey<track_t>(*fields).is_sorted(*self, reverse);
             } else {
                 auto key_ = nb::cast<nb::callable>(key);
                 auto cmp = [&](const self_t& a, const self_t& b) { return key_(a) < key_(b); };
@@ -254,9 +457,22 @@ auto bind_track(nb::module_& m, const std::string& name_) {
         }, nb::arg("key") = nb::none(), nb::arg("reverse") = false)
         .def("adjust_time", [](vec_t& self, const vec<unit>& original_times, const vec<unit>& new_times, const bool inplace) {
             auto ans = inplace ? self : deepcopy(self);
-            for (auto& t : *ans) ops::adjust_time_inplace(*t, original_times, new_times);
+            TimeWarp<T>(original_times, new_times).apply_inplace(*ans);
             return ans;
         }, nb::arg("original_times"), nb::arg("new_times"), nb::arg("inplace") = false)
+        .def("merge_tracks", [](vec_t& self, const nb::object& tracks, const bool inplace) {
+            auto ans = inplace ? self : std::make_shared<vec<self_t>>(self->begin(), self->end());
+            ops::merge_tracks_inplace(*ans, select_tracks(*ans, tracks));
+            return ans;
+        }, nb::arg("tracks"), nb::arg("inplace") = false,
+            "Merge the tracks chosen by a list of indices, a predicate expression or a callable into one, "
+            "placed at the first of them")
+        .def("split_track", [](vec_t& self, const size_t index, const std::string& by, const vec<f64>& boundaries, const bool inplace) {
+            auto ans = inplace ? self : std::make_shared<vec<self_t>>(self->begin(), self->end());
+            ops::split_track_inplace(*ans, index, by, boundaries);
+            return ans;
+        }, nb::arg("index"), nb::arg("by"), nb::arg("boundaries"), nb::arg("inplace") = false,
+            "Split the notes of a track into the ranges [boundaries[i], boundaries[i + 1]) of a note field")
         .def("copy",          [&](const vec_t& self, const bool deep) {
             return deep?deepcopy(self):std::make_shared<vec<self_t>>(self->begin(), self->end());
         }, nb::arg("deep") = true, nb::rv_policy::copy)
@@ -287,36 +503,288 @@ auto bind_track(nb::module_& m, const std::string& name_) {
 }
 
 template<TType T>
-typename T::unit cast_time(const nb::object& t) {
-    typedef typename T::unit unit;
-    if (t.is_none()) return static_cast<unit>(0);
-    return nb::cast<unit>(t);
+auto bind_compact_track(nb::module_& m, const std::string& name_) {
+    const auto name = "CompactTrack" + name_;
+    using self_t    = shared<CompactTrack<T>>;
+    using notes_t   = shared<pyvec<Note<T>>>;
+
+    auto to_notes = [](vec<Note<T>>&& notes) -> notes_t {
+        return std::make_shared<pyvec<Note<T>>>(std::move(notes));
+    };
+
+    // clang-format off
+    return nb::class_<self_t>(m, name.c_str())
+        .def("__init__", [](self_t* self, const shared<Track<T>>& track, const size_t block_size) {
+            new (self) self_t(std::make_shared<CompactTrack<T>>(*track, block_size));
+        }, nb::arg("track"), nb::arg("block_size") = 128)
+        .def("__repr__", [](const self_t& self) {
+            return fmt::format(
+                "CompactTrack(ttype={}, program={}, is_drum={}, name={}, notes={}, blocks={}, nbytes={})",
+                T(), self->program, self->is_drum, self->name, self->note_num(),
+                self->notes.block_num(), self->nbytes()
+            );
+        })
+        .def("__len__", [](const self_t& self) { return self->note_num(); })
+        .def_prop_ro("ttype", [](const self_t&) { return T(); })
+        .def_prop_ro("name", [](const self_t& self) { return self->name; })
+        .def_prop_ro("program", [](const self_t& self) { return self->program; })
+        .def_prop_ro("is_drum", [](const self_t& self) { return self->is_drum; })
+        .def_prop_ro("block_size", [](const self_t& self) { return self->notes.block_size(); })
+        .def_prop_ro("block_num", [](const self_t& self) { return self->notes.block_num(); })
+        .def("note_num", [](const self_t& self) { return self->note_num(); })
+        .def("nbytes", [](const self_t& self) { return self->nbytes(); })
+        .def("notes", [to_notes](const self_t& self, const std::optional<size_t> block) {
+            if (block.has_value()) return to_notes(self->notes.decode_block(*block));
+            return to_notes(self->notes.decode());
+        }, nb::arg("block") = nb::none())
+        .def("notes_range", [to_notes](const self_t& self, const size_t begin, const size_t end) {
+            return to_notes(self->notes.decode_range(begin, end));
+        }, nb::arg("begin"), nb::arg("end"))
+        .def("note", [](const self_t& self, const size_t idx) {
+            return std::make_shared<Note<T>>(self->notes.at(idx));
+        }, nb::arg("idx"))
+        .def("to_track", [](const self_t& self) {
+            return std::make_shared<Track<T>>(std::move(self->to_track()));
+        })
+        .def("__eq__", [](const self_t& self, const self_t& other) { return self == other || *self == *other; })
+        .def("__eq__", [](const self_t&, nb::handle) { return false; })
+    ;
+    // clang-format on
 }
 
-template<TType To, TType From>
-nb::object convert_score_inner(const shared<Score<From>>& self, const nb::object& min_dur) {
-    return nb::cast(
-        std::make_shared<Score<To>>(std::move(convert<To>(*self, cast_time<To>(min_dur)))),
-        nb::rv_policy::copy
-    );
+template<TType T>
+auto bind_interval_index(nb::module_& m, const std::string& name_) {
+    const auto name = "IntervalIndex" + name_;
+    using unit      = typename T::unit;
+    using self_t    = shared<IntervalIndex<T>>;
+
+    auto batch_to_tuple = [](typename IntervalIndex<T>::Batch&& batch) {
+        return nb::make_tuple(
+            vec_to_numpy(std::move(batch.offsets)), vec_to_numpy(std::move(batch.indices))
+        );
+    };
+
+    // clang-format off
+    return nb::class_<self_t>(m, name.c_str())
+        .def("__init__", [](self_t* self, const shared<Track<T>>& track) {
+            new (self) self_t(std::make_shared<IntervalIndex<T>>(*track));
+        }, nb::arg("track"))
+        .def("__init__", [](self_t* self, const shared<pyvec<Note<T>>>& notes) {
+            new (self) self_t(std::make_shared<IntervalIndex<T>>(*notes));
+        }, nb::arg("notes"))
+        .def("__repr__", [](const self_t& self) {
+            return fmt::format("IntervalIndex(ttype={}, notes={})", T(), self->size());
+        })
+        .def("__len__", [](const self_t& self) { return self->size(); })
+        .def_prop_ro("ttype", [](const self_t&) { return T(); })
+        .def("at", [](const self_t& self, const unit t) {
+            return vec_to_numpy(self->at(t));
+        }, nb::arg("time"), "Indices of the notes sounding at the given time")
+        .def("overlap", [](const self_t& self, const unit begin, const unit end) {
+            return vec_to_numpy(self->overlap(begin, end));
+        }, nb::arg("begin"), nb::arg("end"), "Indices of the notes overlapping [begin, end)")
+        .def("at_batch", [batch_to_tuple](const self_t& self, const NDARR(unit, 1)& times) {
+            return batch_to_tuple(self->at_batch(std::span(times.data(), times.size())));
+        }, nb::arg("times"), "Batched version of at, returns (offsets, indices) in CSR format")
+        .def("overlap_batch", [batch_to_tuple](const self_t& self, const NDARR(unit, 1)& begins, const NDARR(unit, 1)& ends) {
+            return batch_to_tuple(self->overlap_batch(
+                std::span(begins.data(), begins.size()), std::span(ends.data(), ends.size())
+            ));
+        }, nb::arg("begins"), nb::arg("ends"), "Batched version of overlap, returns (offsets, indices) in CSR format")
+    ;
+    // clang-format on
 }
 
-template<typename T>
-nb::object convert_score(
-    const shared<Score<T>>& self, const nb::object& ttype, const nb::object& min_dur
-) {
-    if (ttype.is_none()) throw std::invalid_argument("ttype must be specified");
-    if (nb::isinstance<Tick>(ttype)) return convert_score_inner<Tick>(self, min_dur);
-    if (nb::isinstance<Quarter>(ttype)) return convert_score_inner<Quarter>(self, min_dur);
-    if (nb::isinstance<Second>(ttype)) return convert_score_inner<Second>(self, min_dur);
-    if (nb::isinstance<nb::str>(ttype)) {
-        // convert ttype to lower case
-        const auto ttype_str = nb::cast<std::string>(ttype.attr("lower")());
-        if (ttype_str == "tick") return convert_score_inner<Tick>(self, min_dur);
-        if (ttype_str == "quarter") return convert_score_inner<Quarter>(self, min_dur);
-        if (ttype_str == "second") return convert_score_inner<Second>(self, min_dur);
-    }
-    throw std::invalid_argument("ttype must be Tick, Quarter, Second or string");
+template<TType T>
+auto bind_time_warp(nb::module_& m, const std::string& name_) {
+    const auto name = "TimeWarp" + name_;
+    using unit      = typename T::unit;
+    using self_t    = shared<TimeWarp<T>>;
+    using track_t   = shared<Track<T>>;
+    using score_t   = shared<Score<T>>;
+
+    // clang-format off
+    return nb::class_<self_t>(m, name.c_str())
+        .def("__init__", [](self_t* self, const vec<unit>& original_times, const vec<unit>& new_times) {
+            new (self) self_t(std::make_shared<TimeWarp<T>>(original_times, new_times));
+        }, nb::arg("original_times"), nb::arg("new_times"))
+        .def("__repr__", [](const self_t& self) {
+            return fmt::format("TimeWarp(ttype={}, anchors={})", T(), self->size());
+        })
+        .def("__len__", [](const self_t& self) { return self->size(); })
+        .def_prop_ro("ttype", [](const self_t&) { return T(); })
+        .def_prop_ro("original_times", [](const self_t& self) { return self->original_times(); })
+        .def_prop_ro("new_times", [](const self_t& self) { return self->new_times(); })
+        .def("__call__", [](const self_t& self, const unit time) { return (*self)(time); },
+            nb::arg("time"), "Map a single time")
+        .def("apply", [](const self_t& self, const track_t& track, const bool inplace) {
+            if (inplace) {
+                self->apply_inplace(*track);
+                return track;
+            }   return std::make_shared<Track<T>>(self->apply(*track));
+        }, nb::arg("track"), nb::arg("inplace") = false)
+        .def("apply", [](const self_t& self, const score_t& score, const bool inplace) {
+            if (inplace) {
+                self->apply_inplace(*score);
+                return score;
+            }   return std::make_shared<Score<T>>(self->apply(*score));
+        }, nb::arg("score"), nb::arg("inplace") = false)
+        .def("apply", [](const self_t& self, const vec<score_t>& scores, const bool inplace) {
+            if (inplace) {
+                self->apply_inplace(scores);
+                return scores;
+            }
+            vec<score_t> ans;
+            ans.reserve(scores.size());
+            for (const auto& score : scores) ans.push_back(std::make_shared<Score<T>>(self->apply(*score)));
+            return ans;
+        }, nb::arg("scores"), nb::arg("inplace") = false, "Apply the warp to each score of the list")
+        .def("apply", [](const self_t& self, const vec<track_t>& tracks, const bool inplace) {
+            if (inplace) {
+                self->apply_inplace(tracks);
+                return tracks;
+            }
+            vec<track_t> ans;
+            ans.reserve(tracks.size());
+            for (const auto& track : tracks) ans.push_back(std::make_shared<Track<T>>(self->apply(*track)));
+            return ans;
+        }, nb::arg("tracks"), nb::arg("inplace") = false, "Apply the warp to each track of the list")
+    ;
+    // clang-format on
+}
+
+template<TType T>
+auto bind_beat_grid(nb::module_& m, const std::string& name_) {
+    const auto name = "BeatGrid" + name_;
+    using unit      = typename T::unit;
+    using self_t    = shared<const BeatGrid<T>>;
+
+    // clang-format off
+    return nb::class_<self_t>(m, name.c_str())
+        .def("__init__", [](self_t* self, const shared<Score<T>>& score, const std::optional<unit> end) {
+            new (self) self_t(score->beat_grid(end.value_or(score->end())));
+        }, nb::arg("score"), nb::arg("end") = nb::none())
+        .def("__repr__", [](const self_t& self) {
+            return fmt::format(
+                "BeatGrid(ttype={}, bars={}, beats={})", T(), self->downbeats().size(), self->beats().size()
+            );
+        })
+        .def_prop_ro("ttype", [](const self_t&) { return T(); })
+        .def("beats", [](const self_t& self) { return vec_to_numpy(vec<unit>(self->beats())); },
+            "Times of the beats until the end")
+        .def("downbeats", [](const self_t& self) { return vec_to_numpy(vec<unit>(self->downbeats())); },
+            "Times of the first beats of the bars until the end")
+        .def("downbeat", [](const self_t& self, const i64 bar) { return self->downbeat(bar); },
+            nb::arg("bar"), "Start of any bar, extended with the time signature in effect out of the grid")
+        .def("locate", [](const self_t& self, const unit time) {
+            const auto [bar, beat, position] = self->locate(time);
+            return nb::make_tuple(bar, beat, position);
+        }, nb::arg("time"), "(bar, beat, position in the beat) of the given time")
+        .def("locate_batch", [](const self_t& self, const NDARR(unit, 1)& times) {
+            auto batch = self->locate(std::span<const unit>(times.data(), times.size()));
+            return nb::make_tuple(
+                vec_to_numpy(std::move(batch.bars)),
+                vec_to_numpy(std::move(batch.beats)),
+                vec_to_numpy(std::move(batch.positions))
+            );
+        }, nb::arg("times"), "Batched version of locate, returns (bars, beats, positions) arrays")
+    ;
+    // clang-format on
+}
+
+template<TType T, TType From>
+nb::object tempo_map_convert(const TempoMap<T>& map, const nb::object& times, const int dst) {
+    using unit       = typename From::unit;
+    const auto array = nb::cast<NDARR(unit, 1)>(times);
+    const std::span<const unit> span(array.data(), array.size());
+    if (dst == 0) return nb::cast(vec_to_numpy(map.template convert<From, Tick>(span)));
+    if (dst == 1) return nb::cast(vec_to_numpy(map.template convert<From, Quarter>(span)));
+    return nb::cast(vec_to_numpy(map.template convert<From, Second>(span)));
+}
+
+template<TType T>
+auto bind_tempo_map(nb::module_& m, const std::string& name_) {
+    const auto name = "TempoMap" + name_;
+    using self_t    = shared<const TempoMap<T>>;
+
+    // clang-format off
+    return nb::class_<self_t>(m, name.c_str())
+        .def("__init__", [](self_t* self, const shared<Score<T>>& score) {
+            new (self) self_t(score->tempo_map());
+        }, nb::arg("score"))
+        .def("__repr__", [](const self_t& self) {
+            return fmt::format("TempoMap(ttype={}, tpq={}, tempos={})", T(), self->ticks_per_quarter(), self->size());
+        })
+        .def("__len__", [](const self_t& self) { return self->size(); })
+        .def_prop_ro("ttype", [](const self_t&) { return T(); })
+        .def_prop_ro("ticks_per_quarter", [](const self_t& self) { return self->ticks_per_quarter(); })
+        .def("convert", [](const self_t& self, const nb::object& times, const nb::object& src, const nb::object& dst) {
+            const int to = ttype_index(dst);
+            switch (ttype_index(src)) {
+                case 0: return tempo_map_convert<T, Tick>(*self, times, to);
+                case 1: return tempo_map_convert<T, Quarter>(*self, times, to);
+                default: return tempo_map_convert<T, Second>(*self, times, to);
+            }
+        }, nb::arg("times"), nb::arg("src"), nb::arg("dst"),
+            "Convert an array of times from the time unit src to dst, e.g. convert(ticks, \"tick\", \"second\")")
+    ;
+    // clang-format on
+}
+
+template<TType T>
+auto bind_pipeline(nb::module_& m, const std::string& name_) {
+    const auto name = "Pipeline" + name_;
+    using unit      = typename T::unit;
+    using self_t    = shared<Pipeline<T>>;
+
+    // clang-format off
+    return nb::class_<self_t>(m, name.c_str())
+        .def("__init__", [](self_t* self) {
+            new (self) self_t(std::make_shared<Pipeline<T>>());
+        })
+        .def("__repr__", [](const self_t& self) {
+            return fmt::format("Pipeline(ttype={}, steps={})", T(), self->size());
+        })
+        .def("__len__", [](const self_t& self) { return self->size(); })
+        .def_prop_ro("ttype", [](const self_t&) { return T(); })
+        .def("clip", [](const self_t& self, const unit start, const unit end, const bool clip_end) {
+            self->clip(start, end, clip_end); return self;
+        }, nb::arg("start"), nb::arg("end"), nb::arg("clip_end") = false)
+        .def("shift_time", [](const self_t& self, const unit offset) {
+            self->shift_time(offset); return self;
+        }, nb::arg("offset"))
+        .def("shift_pitch", [](const self_t& self, const i8 offset, const bool saturate) {
+            self->shift_pitch(offset, saturate); return self;
+        }, nb::arg("offset"), nb::arg("saturate") = false)
+        .def("shift_velocity", [](const self_t& self, const i8 offset, const bool saturate) {
+            self->shift_velocity(offset, saturate); return self;
+        }, nb::arg("offset"), nb::arg("saturate") = false)
+        .def("filter_pitch", [](const self_t& self, const i8 min_pitch, const i8 max_pitch) {
+            self->filter_pitch(min_pitch, max_pitch); return self;
+        }, nb::arg("min_pitch") = 0, nb::arg("max_pitch") = 127)
+        .def("filter_velocity", [](const self_t& self, const i8 min_velocity, const i8 max_velocity) {
+            self->filter_velocity(min_velocity, max_velocity); return self;
+        }, nb::arg("min_velocity") = 0, nb::arg("max_velocity") = 127)
+        .def("filter_duration", [](const self_t& self, const unit min_duration, const unit max_duration) {
+            self->filter_duration(min_duration, max_duration); return self;
+        }, nb::arg("min_duration"), nb::arg("max_duration") = std::numeric_limits<unit>::max())
+        .def("sort", [](const self_t& self, const bool reverse) {
+            self->sort(reverse); return self;
+        }, nb::arg("reverse") = false)
+        .def("apply", [](const self_t& self, const shared<Track<T>>& track) {
+            return std::make_shared<Track<T>>(self->apply(*track));
+        }, nb::arg("track"), "Run all the steps on a copy of the track in one pass")
+        .def("apply", [](const self_t& self, const shared<Score<T>>& score) {
+            return std::make_shared<Score<T>>(self->apply(*score));
+        }, nb::arg("score"), "Run all the steps on a copy of the score in one pass")
+        .def("__call__", [](const self_t& self, const shared<Track<T>>& track) {
+            return std::make_shared<Track<T>>(self->apply(*track));
+        }, nb::arg("track"))
+        .def("__call__", [](const self_t& self, const shared<Score<T>>& score) {
+            return std::make_shared<Score<T>>(self->apply(*score));
+        }, nb::arg("score"))
+    ;
+    // clang-format on
 }
 
 template<TType T, typename PATH>
@@ -426,16 +894,16 @@ auto bind_score(nb::module_& m, const std::string& name_) {
     using unit      = typename T::unit;
     using self_t    = shared<Score<T>>;
 
-    auto copy_func     = [](const self_t& self) { return std::make_shared<Score<T>>(*self); };
+    auto copy_func     = [](const self_t& self) { return std::make_shared<Score<T>>(self->copy()); };
     auto deepcopy_func = [](const self_t& self) {
-        return std::make_shared<Score<T>>(std::move(self->deepcopy()));
+        return std::make_shared<Score<T>>(std::move(self->cow_copy()));
     };
 
     // clang-format off
     auto score = nb::class_<self_t>(m, name.c_str())
         .def("__init__", &pyinit<Score<T>, i32>, nb::arg("tpq"))
         .def("__init__", [](self_t* self, const self_t& other) {
-            new (self) self_t(std::move(std::make_shared<Score<T>>(std::move(other->deepcopy()))));
+            new (self) self_t(std::move(std::make_shared<Score<T>>(std::move(other->cow_copy()))));
         }, "Copy constructor", nb::arg("other"))
         .def("copy", [&](const self_t &self, const bool deep) {
             if (deep) return deepcopy_func(self);
@@ -491,59 +959,143 @@ auto bind_score(nb::module_& m, const std::string& name_) {
         .def_prop_rw(RW_COPY(i32, "ticks_per_quarter", ticks_per_quarter))
         .def_prop_rw(RW_COPY(i32, "tpq", ticks_per_quarter))
         .def_prop_rw(RW_COPY(shared<vec<shared<Track<T>>>>, "tracks", tracks))
-        .def_prop_rw(RW_COPY(shared<pyvec<TimeSignature<T>>>, "time_signatures", time_signatures))
-        .def_prop_rw(RW_COPY(shared<pyvec<KeySignature<T>>>, "key_signatures", key_signatures))
-        .def_prop_rw(RW_COPY(shared<pyvec<Tempo<T>>>, "tempos", tempos))
+        .def_prop_rw(RW_COW(shared<pyvec<TimeSignature<T>>>, "time_signatures", time_signatures, Score<T>::TIME_SIGNATURES))
+        .def_prop_rw(RW_COW(shared<pyvec<KeySignature<T>>>, "key_signatures", key_signatures, Score<T>::KEY_SIGNATURES))
+        .def_prop_rw(RW_COW(shared<pyvec<Tempo<T>>>, "tempos", tempos, Score<T>::TEMPOS))
         // .def_prop_rw(RW_COPY(shared<pyvec<TextMeta<T>>>, "lyrics", lyrics))
-        .def_prop_rw(RW_COPY(shared<pyvec<TextMeta<T>>>, "markers", markers))
+        .def_prop_rw(RW_COW(shared<pyvec<TextMeta<T>>>, "markers", markers, Score<T>::MARKERS))
         .def_prop_ro("ttype", [](const self_t&) { return T(); })
         .def("__use_count", [](const self_t& self) { return self.use_count(); })
         // member functions
-        .def("to", &convert_score<T>, nb::arg("ttype"), nb::arg("min_dur") = nb::none(), "Convert to another time unit")
-        .def("resample", [](const self_t& self, const i32 tpq, const std::optional<unit> min_dur) {
-            const unit min_dur_ = min_dur.has_value() ? *min_dur : 0;
-            return std::make_shared<Score<Tick>>(std::move(resample(*self, tpq, min_dur_)));
-        }, nb::arg("tpq"), nb::arg("min_dur") = nb::none(), nb::rv_policy::copy, "Resample to another ticks per quarter")
-        .def("sort", [](self_t& self, const bool reverse, const bool inplace) {
+        .def("to", &convert_score<T>, nb::arg("ttype"), nb::arg("min_dur") = nb::none(),
+            nb::arg("start") = nb::none(), nb::arg("end") = nb::none(), nb::arg("parallel") = false,
+            "Convert to another time unit, only the events in [start, end) of the current unit if given")
+        .def("resample", [](const self_t& self, const i32 tpq, const std::optional<unit> min_dur, const bool inplace, const bool parallel) {
+            const auto min_dur_ = static_cast<Tick::unit>(min_dur.has_value() ? *min_dur : 0);
+            if (inplace) {
+                if constexpr (std::is_same_v<T, Tick>) {
+                    resample_inplace(*self, tpq, min_dur_, get_exec_policy(parallel));
+                    return self;
+                } else {
+                    throw std::invalid_argument("symusic::resample: inplace is only supported for Tick scores");
+                }
+            }
+            return std::make_shared<Score<Tick>>(std::move(resample(*self, tpq, min_dur_, get_exec_policy(parallel))));
+        }, nb::arg("tpq"), nb::arg("min_dur") = nb::none(), nb::arg("inplace") = false, nb::arg("parallel") = false,
+            nb::rv_policy::copy, "Resample to another ticks per quarter")
+        .def("sort", [](self_t& self, const bool reverse, const bool inplace, const bool parallel) {
             if (inplace) {
-                self->sort_inplace(reverse);
+                self->sort_inplace(reverse, get_exec_policy(parallel));
                 return self;
-            }   return std::make_shared<Score<T>>(std::move(self->sort(reverse)));
-        }, nb::arg("reverse") = false, nb::arg("inplace") = true)
-        .def("clip", [](self_t& self, const unit start, const unit end, const bool clip_end, const bool inplace) {
+            }   return std::make_shared<Score<T>>(std::move(self->sort(reverse, get_exec_policy(parallel))));
+        }, nb::arg("reverse") = false, nb::arg("inplace") = true, nb::arg("parallel") = false)
+        .def("clip", [](self_t& self, const unit start, const unit end, const bool clip_end, const bool inplace, const bool parallel) {
             if (inplace) {
-                self->clip_inplace(start, end, clip_end);
+                self->clip_inplace(start, end, clip_end, get_exec_policy(parallel));
                 return self;
-            }   return std::make_shared<Score<T>>(std::move(self->clip(start, end, clip_end)));
-        }, nb::arg("start"), nb::arg("end"), nb::arg("clip_end") = false, nb::arg("inplace") = false)
-        .def("shift_time", [](self_t& self, const unit offset, const bool inplace) {
+            }   return std::make_shared<Score<T>>(std::move(self->clip(start, end, clip_end, get_exec_policy(parallel))));
+        }, nb::arg("start"), nb::arg("end"), nb::arg("clip_end") = false, nb::arg("inplace") = false, nb::arg("parallel") = false)
+        .def("shift_time", [](self_t& self, const unit offset, const bool inplace, const bool parallel) {
             if (inplace) {
-                self->shift_time_inplace(offset);
+                self->shift_time_inplace(offset, get_exec_policy(parallel));
                 return self;
-            }   return std::make_shared<Score<T>>(std::move(self->shift_time(offset)));
-        }, nb::arg("offset"), nb::arg("inplace") = false)
-        .def("shift_pitch", [](self_t& self, const i8 offset, const bool inplace) {
+            }   return std::make_shared<Score<T>>(std::move(self->shift_time(offset, get_exec_policy(parallel))));
+        }, nb::arg("offset"), nb::arg("inplace") = false, nb::arg("parallel") = false)
+        .def("shift_pitch", [](self_t& self, const i8 offset, const bool saturate, const bool inplace, const bool parallel) {
             if (inplace) {
-                self->shift_pitch_inplace(offset);
+                self->shift_pitch_inplace(offset, saturate, get_exec_policy(parallel));
                 return self;
-            }   return std::make_shared<Score<T>>(std::move(self->shift_pitch(offset)));
-        }, nb::arg("offset"), nb::arg("inplace") = false)
-        .def("shift_velocity", [](self_t& self, const i8 offset, const bool inplace) {
+            }   return std::make_shared<Score<T>>(std::move(self->shift_pitch(offset, saturate, get_exec_policy(parallel))));
+        }, nb::arg("offset"), nb::arg("saturate") = false, nb::arg("inplace") = false, nb::arg("parallel") = false)
+        .def("shift_velocity", [](self_t& self, const i8 offset, const bool saturate, const bool inplace, const bool parallel) {
             if (inplace) {
-                self->shift_velocity_inplace(offset);
+                self->shift_velocity_inplace(offset, saturate, get_exec_policy(parallel));
                 return self;
-            }   return std::make_shared<Score<T>>(std::move(self->shift_velocity(offset)));
-        }, nb::arg("offset"), nb::arg("inplace") = false)
+            }   return std::make_shared<Score<T>>(std::move(self->shift_velocity(offset, saturate, get_exec_policy(parallel))));
+        }, nb::arg("offset"), nb::arg("saturate") = false, nb::arg("inplace") = false, nb::arg("parallel") = false)
+        .def("shift", [](self_t& self, const unit time, const i8 pitch, const i8 velocity, const bool saturate, const bool inplace, const bool parallel) {
+            if (inplace) {
+                self->shift_inplace(time, pitch, velocity, saturate, get_exec_policy(parallel));
+                return self;
+            }   return std::make_shared<Score<T>>(std::move(self->shift(time, pitch, velocity, saturate, get_exec_policy(parallel))));
+        }, nb::arg("time") = 0, nb::arg("pitch") = 0, nb::arg("velocity") = 0, nb::arg("saturate") = false, nb::arg("inplace") = false,
+            nb::arg("parallel") = false, "Shift time, pitch and velocity of the score in a single pass over the notes")
+        .def("quantize", [](self_t& self, const f64 division, const std::string& mode, const unit min_dur, const f64 swing, const bool inplace) {
+            if (inplace) {
+                ops::quantize_inplace(*self, division, get_quantize_mode(mode), min_dur, swing);
+                return self;
+            }   return std::make_shared<Score<T>>(std::move(ops::quantize(*self, division, get_quantize_mode(mode), min_dur, swing)));
+        }, nb::arg("division"), nb::arg("mode") = "both", nb::arg("min_dur") = 0, nb::arg("swing") = 0., nb::arg("inplace") = false,
+            "Snap the events to a grid of division steps per quarter, with odd grid points delayed by swing * grid")
+        .def("apply_sustain", [](self_t& self, const bool inplace) {
+            if (inplace) {
+                self->apply_sustain_inplace();
+                return self;
+            }   return std::make_shared<Score<T>>(std::move(self->apply_sustain()));
+        }, nb::arg("inplace") = false, "Extend the notes released under the sustain pedals to the pedal release")
+        .def("dedup_notes", [](self_t& self, const bool inplace) {
+            self_t ans = inplace ? self : std::make_shared<Score<T>>(std::move(self->cow_copy()));
+            const auto stats = ans->dedup_notes_inplace();
+            return nb::make_tuple(ans, overlap_stats_dict(stats));
+        }, nb::arg("inplace") = false,
+            "Remove the duplicated notes of each track, return (score, stats)")
+        .def("resolve_overlaps", [](self_t& self, const std::string& policy, const bool inplace) {
+            self_t ans = inplace ? self : std::make_shared<Score<T>>(std::move(self->cow_copy()));
+            const auto stats = ans->resolve_overlaps_inplace(get_overlap_policy(policy));
+            return nb::make_tuple(ans, overlap_stats_dict(stats));
+        }, nb::arg("policy") = "keep_first", nb::arg("inplace") = false,
+            "Resolve the overlapping notes of the same pitch in each track, return (score, stats)")
+        .def("merge_tracks", [](self_t& self, const nb::object& tracks, const bool inplace) {
+            self_t ans = inplace ? self : std::make_shared<Score<T>>(std::move(self->cow_copy()));
+            ops::merge_tracks_inplace(*ans->tracks, select_tracks(*ans->tracks, tracks));
+            return ans;
+        }, nb::arg("tracks"), nb::arg("inplace") = false,
+            "Merge the tracks chosen by a list of indices, a predicate expression or a callable into one, "
+            "placed at the first of them")
+        .def("split_track", [](self_t& self, const size_t index, const std::string& by, const vec<f64>& boundaries, const bool inplace) {
+            self_t ans = inplace ? self : std::make_shared<Score<T>>(std::move(self->cow_copy()));
+            ops::split_track_inplace(*ans->tracks, index, by, boundaries);
+            return ans;
+        }, nb::arg("index"), nb::arg("by"), nb::arg("boundaries"), nb::arg("inplace") = false,
+            "Split the notes of a track into the ranges [boundaries[i], boundaries[i + 1]) of a note field")
+        .def_static("concat", [](const vec<self_t>& scores, const unit gap) {
+            return std::make_shared<Score<T>>(ops::concat<T>(scores, gap));
+        }, nb::arg("scores"), nb::arg("gap") = 0,
+            "Concatenate the scores one after another, merging the tracks by (program, is_drum)")
+        .def("splice", [](const self_t& self, const unit at, const self_t& other) {
+            return std::make_shared<Score<T>>(ops::splice(*self, at, *other));
+        }, nb::arg("at"), nb::arg("other"), "Insert other at the given time, delaying the events after it")
+        .def("segment", [](const self_t& self, const f64 window, const std::optional<f64> stride, const std::string& unit, const bool truncate_notes, const bool shift) {
+            auto parts = ops::segment(*self, window, stride.value_or(window), get_segment_unit(unit), truncate_notes, shift);
+            vec<self_t> ans;
+            ans.reserve(parts.size());
+            for (auto& part : parts) ans.push_back(std::make_shared<Score<T>>(std::move(part)));
+            return ans;
+        }, nb::arg("window"), nb::arg("stride") = nb::none(), nb::arg("unit") = "time",
+            nb::arg("truncate_notes") = false, nb::arg("shift") = true,
+            "Cut the score into windows of the given length every stride (window by default), "
+            "in bars, the time unit of the score or seconds")
+        .def("beat_grid", [](const self_t& self, const std::optional<unit> end) {
+            return self->beat_grid(end.value_or(self->end()));
+        }, nb::arg("end") = nb::none(),
+            "The bar and beat grid of the score until end (the end of the score by default), cached until "
+            "end, the time signatures or what they are mapped with change")
+        .def("tempo_map", [](const self_t& self) { return self->tempo_map(); },
+            "The tempo map of the score, cached until the tempos or ticks_per_quarter change")
         .def("start", [](const self_t& self) { return self->start(); })
         .def("end", [](const self_t& self) { return self->end(); })
         .def("note_num", [](const self_t& self) { return self->note_num(); })
         .def("empty", [](const self_t& self) { return self->empty(); })
-        .def("adjust_time", [](self_t& self, const vec<unit>& original_times, const vec<unit>& new_times, const bool inplace) {
+        .def("memory_usage", [](const self_t& self) { return memory_usage_dict(self->memory_usage()); },
+            "Estimated heap memory held by the score in bytes, broken down by kind")
+        .def("shrink_to_fit", [](const self_t& self) { self->shrink_to_fit(); return self; },
+            "Release the unused capacity of the event lists")
+        .def("adjust_time", [](self_t& self, const vec<unit>& original_times, const vec<unit>& new_times, const bool inplace, const bool parallel) {
             if (inplace) {
-                ops::adjust_time_inplace(*self, original_times, new_times);
+                ops::adjust_time_inplace(*self, original_times, new_times, get_exec_policy(parallel));
                 return self;
-            }   return std::make_shared<Score<T>>(std::move(ops::adjust_time(*self, original_times, new_times)));
-        }, nb::arg("original_times"), nb::arg("new_times"), nb::arg("inplace") = false)
+            }   return std::make_shared<Score<T>>(std::move(ops::adjust_time(*self, original_times, new_times, get_exec_policy(parallel))));
+        }, nb::arg("original_times"), nb::arg("new_times"), nb::arg("inplace") = false, nb::arg("parallel") = false)
     ;
     // clang-format on
     if constexpr (std::is_same_v<T, Tick>) {
@@ -649,7 +1201,8 @@ NB_MODULE(core, m) {
         BIND_EVENT,
         bind_note, bind_keysig, bind_timesig, bind_tempo,
         bind_controlchange, bind_pedal, bind_pitchbend, bind_textmeta,
-        bind_track, bind_score
+        bind_track, bind_compact_track, bind_interval_index, bind_score, bind_pipeline, bind_time_warp,
+        bind_beat_grid, bind_tempo_map
     )
     #undef BIND_EVENT
     // clang-format on
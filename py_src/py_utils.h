@@ -5,6 +5,8 @@
 #ifndef PY_UTILS_H
 #define PY_UTILS_H
 
+#include <numeric>
+#include <optional>
 #include "symusic.h"
 #include "bind_vector_copy.h"
 #include "nanobind/nanobind.h"
@@ -22,6 +24,21 @@ namespace nb = nanobind;
     PYNAME, [](const self_t& self) { return self->NAME; }, \
         [](self_t& self, const type& value) { self->NAME = value; }
 
+// property of a copy-on-write event list in Track or Score, the list handed out to python is
+// detached from other copies first, and never shared by copies afterwards. A list set from python
+// replaces one of the pooled lists, so they are moved out of their block first
+#define RW_COW(type, PYNAME, NAME, KIND)                                              \
+    PYNAME,                                                                           \
+        [](const self_t& self) {                                                      \
+            self->expose(KIND);                                                       \
+            return self->NAME;                                                        \
+        },                                                                            \
+        [](self_t& self, const type& value) {                                         \
+            self->unpool();                                                           \
+            self->NAME = value;                                                       \
+            self->exposed |= (KIND);                                                  \
+        }
+
 template<typename T, typename... Args>
 void pyinit(std::shared_ptr<T>* self, Args&&... args) {
     new (self) std::shared_ptr<T>(std::move(std::make_shared<T>(std::forward<Args>(args)...)));
@@ -47,6 +64,79 @@ void from_bytes(shared<T>& self, const nb::bytes& bytes) {
     new (&self) shared<T>(std::move(ans));
 }
 
+// move a vector into a 1d numpy array without copying the data
+template<typename T>
+nb::ndarray<nb::numpy, T> vec_to_numpy(vec<T>&& data) {
+    auto*       temp = new vec<T>(std::move(data));
+    nb::capsule deleter(temp, [](void* p) noexcept { delete static_cast<vec<T>*>(p); });
+    return nb::ndarray<nb::numpy, T>(temp->data(), {temp->size()}, deleter);
+}
+
+// field names for native sorting, if key is a str or a tuple / list of str, e.g. ("time", "-pitch")
+inline std::optional<vec<std::string>> sort_fields(const nb::object& key) {
+    if (nb::isinstance<nb::str>(key)) return vec<std::string>{nb::cast<std::string>(key)};
+    if (!nb::isinstance<nb::tuple>(key) && !nb::isinstance<nb::list>(key)) return std::nullopt;
+    vec<std::string> ans;
+    for (const auto item : key) {
+        if (!nb::isinstance<nb::str>(item)) return std::nullopt;
+        ans.push_back(nb::cast<std::string>(item));
+    }
+    return ans;
+}
+
+// indices that sort the items by their default keys, stable
+template<typename C>
+vec<u32> default_argsort(const C& items, const bool reverse) {
+    vec<u32> ans(items.size());
+    std::iota(ans.begin(), ans.end(), 0);
+    auto key = [&items](const u32 i) {
+        if constexpr (requires(const typename C::value_type& x) { x->default_key(); }) {
+            return items[i]->default_key();
+        } else {
+            return items[i].default_key();
+        }
+    };
+    if (reverse) {
+        std::stable_sort(ans.begin(), ans.end(), [&](u32 a, u32 b) { return key(b) < key(a); });
+    } else {
+        std::stable_sort(ans.begin(), ans.end(), [&](u32 a, u32 b) { return key(a) < key(b); });
+    }
+    return ans;
+}
+
+// move a byte mask into a 1d numpy bool array without copying the data
+inline nb::ndarray<nb::numpy, bool> mask_to_numpy(vec<u8>&& mask) {
+    static_assert(sizeof(bool) == sizeof(u8));
+    auto*       temp = new vec<u8>(std::move(mask));
+    nb::capsule deleter(temp, [](void* p) noexcept { delete static_cast<vec<u8>*>(p); });
+    return nb::ndarray<nb::numpy, bool>(
+        reinterpret_cast<bool*>(temp->data()), {temp->size()}, deleter
+    );
+}
+
+inline nb::dict memory_usage_dict(const MemoryUsage& usage) {
+    nb::dict ans{};
+    ans["notes"]           = usage.notes;
+    ans["controls"]        = usage.controls;
+    ans["pitch_bends"]     = usage.pitch_bends;
+    ans["pedals"]          = usage.pedals;
+    ans["lyrics"]          = usage.lyrics;
+    ans["time_signatures"] = usage.time_signatures;
+    ans["key_signatures"]  = usage.key_signatures;
+    ans["tempos"]          = usage.tempos;
+    ans["markers"]         = usage.markers;
+    ans["other"]           = usage.other;
+    ans["total"]           = usage.total();
+    return ans;
+}
+
+inline nb::dict overlap_stats_dict(const OverlapStats& stats) {
+    nb::dict ans{};
+    ans["removed"]   = stats.removed;
+    ans["truncated"] = stats.truncated;
+    return ans;
+}
+
 template<TimeEvent T>
 void vec_from_bytes(shared<pyvec<T>>& self, const nb::bytes& bytes) {
     const auto      data = std::string_view(bytes.c_str(), bytes.size());
@@ -216,37 +306,66 @@ auto bind_time_stamp(nb::module_& m, const std::string& name) {
         .def("__getstate__", &vec_to_bytes<T>)
         .def("__setstate__", &vec_from_bytes<T>)
         .def("__repr__", [](const vec_t& self) { return fmt::format("{::s}", *self); })
+        .def("memory_usage", [](const vec_t& self) { return memory_usage(self); },
+            "Estimated heap memory held by the list in bytes")
         .def("sort", [](vec_t& v, const nb::object & key, const bool reverse, const bool inplace) -> vec_t {
                 vec_t ans = inplace? v : std::make_shared<pyvec<T>>(std::move(v->copy()));
                 if(key.is_none()) {
                     ans->sort([](const auto& e) { return e.default_key(); }, reverse);
+                } else if(const auto fields = sort_fields(key)) {
+                    SortKey<T>(*fields).sort_inplace(*ans, reverse);
                 } else {
                     ans->sort_shared(nb::cast<nb::callable>(key), reverse);
                 }
                 return ans;
             },  nb::rv_policy::copy,
-            nb::arg("key") = nb::none(), nb::arg("reverse") = false, nb::arg("inplace") = true
+            nb::arg("key") = nb::none(), nb::arg("reverse") = false, nb::arg("inplace") = true,
+            "Sort by the default key, field names like (\"time\", \"-pitch\") or a callable. The order of "
+            "equal events is not kept, use argsort for a stable order"
         )
         .def("filter", [](vec_t &v, nb::object &func, const bool inplace) -> vec_t {
                 vec_t ans = inplace? v : std::make_shared<pyvec<T>>(std::move(v->copy()));
                 if(func.is_none()) {
                     throw std::invalid_argument("symusic::filter: You need to provide a function, not None!");
                 }
+                // a string is compiled as a predicate expression, and evaluated natively
+                if(nb::isinstance<nb::str>(func)) {
+                    Predicate<T>(nb::cast<std::string>(func)).filter_inplace(*ans);
+                    return ans;
+                }
                 ans->filter_shared([func](const shared<T>& e) -> bool {
                     return nb::cast<bool>(func(e));
                 });
                 return ans;
             }, nb::rv_policy::copy,
-            nb::arg("function") = nb::none(), nb::arg("inplace") = true
+            nb::arg("function") = nb::none(), nb::arg("inplace") = true,
+            "Filter by a function, or by an expression like \"pitch in [21, 108) and velocity > 10\""
+        )
+        .def("mask", [](const vec_t& v, const std::string& expr) {
+                return mask_to_numpy(Predicate<T>(expr).mask(*v));
+            }, nb::arg("expr"),
+            "Boolean numpy array of whether each event satisfies the predicate expression"
         )
         .def("is_sorted", [](const vec_t& v, nb::object & key, bool reverse) -> bool {
                 if(key.is_none()) {
                     return v->is_sorted([](const auto& e) { return e.default_key(); }, reverse);
+                } else if(const auto fields = sort_fields(key)) {
+                    return SortKey<T>(*fields).is_sorted(*v, reverse);
                 } else {
                     return v->is_sorted_shared( nb::cast<nb::callable>(key), reverse);
                 }
             }, nb::arg("key") = nb::none(), nb::arg("reverse") = false
         )
+        .def("argsort", [](const vec_t& v, const nb::object& key, const bool reverse) {
+                if(key.is_none()) return vec_to_numpy(default_argsort(*v, reverse));
+                const auto fields = sort_fields(key);
+                if(!fields) {
+                    throw std::invalid_argument("symusic::argsort: key should be a field name or a tuple of field names");
+                }
+                return vec_to_numpy(SortKey<T>(*fields).argsort(*v, reverse));
+            }, nb::arg("key") = nb::none(), nb::arg("reverse") = false,
+            "Stable indices that sort the list, by the default key or by field names like (\"time\", \"-pitch\")"
+        )
         .def("adjust_time", [](vec_t& v, const vec<unit>& original_times, const vec<unit>& new_times, const bool inplace) -> vec_t {
                 vec_t ans = inplace? v : std::make_shared<pyvec<T>>(std::move(v->deepcopy()));
                 ops::adjust_time_inplace(*ans, original_times, new_times);
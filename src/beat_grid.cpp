@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "MetaMacro.h"
+#include "symusic/beat_grid.h"
+
+namespace symusic {
+
+namespace details {
+// time signatures within eps quarters of a bar line are on it, against rounding errors of seconds
+constexpr f64 grid_eps = 1e-6;
+
+// beats per bar and the beat length in quarters of a time signature
+template<TType T>
+std::pair<i32, f64> beat_of(const TimeSignature<T>& ts) {
+    return {std::max<i32>(ts.numerator, 1), 4. / std::max<i32>(ts.denominator, 1)};
+}
+
+inline i64 floor_div(const i64 a, const i64 b) {
+    const i64 q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+}   // namespace details
+
+template<TType T>
+BeatGrid<T>::BeatGrid(const Score<T>& score, const unit end) :
+    grid_end{end}, tpq{score.ticks_per_quarter},
+    signature_source(score.time_signatures->cbegin(), score.time_signatures->cend()) {
+    if constexpr (std::is_same_v<T, Second>) {
+        tempo_source.assign(score.tempos->cbegin(), score.tempos->cend());
+        vec<Tempo<T>> tempos(score.tempos->cbegin(), score.tempos->cend());
+        std::stable_sort(tempos.begin(), tempos.end(), [](const auto& a, const auto& b) {
+            return a.time < b.time;
+        });
+        auto rate_of = [](const i32 mspq) { return 1e6 / std::max(mspq, 1); };
+        pivot_times.push_back(0);
+        pivot_quarters.push_back(0);
+        rates.push_back(rate_of(500000));
+        for (const auto& tempo : tempos) {
+            const auto time = static_cast<f64>(tempo.time);
+            // the tempo in effect at 0 is also used before 0
+            if (time <= pivot_times.back()) {
+                rates.back() = rate_of(tempo.mspq);
+                continue;
+            }
+            pivot_quarters.push_back(pivot_quarters.back() + (time - pivot_times.back()) * rates.back());
+            pivot_times.push_back(time);
+            rates.push_back(rate_of(tempo.mspq));
+        }
+    } else {
+        if (std::is_same_v<T, Tick> && score.ticks_per_quarter <= 0) {
+            throw std::invalid_argument(
+                "symusic::BeatGrid: ticks_per_quarter should be positive, got "
+                + std::to_string(score.ticks_per_quarter)
+            );
+        }
+        pivot_times.push_back(0);
+        pivot_quarters.push_back(0);
+        rates.push_back(std::is_same_v<T, Tick> ? 1. / score.ticks_per_quarter : 1.);
+    }
+
+    vec<std::pair<f64, TimeSignature<T>>> signatures;
+    signatures.reserve(score.time_signatures->size());
+    for (const auto& ts : *score.time_signatures) signatures.emplace_back(to_quarters(ts.time), ts);
+    std::stable_sort(signatures.begin(), signatures.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
+
+    constexpr f64 eps    = details::grid_eps;
+    size_t        next   = 0;   // the next time signature to apply
+    i32           beats  = 4;
+    f64           length = 1;
+    // apply the time signatures up to quarters, the last one wins
+    auto apply = [&](const f64 quarters) {
+        for (; next < signatures.size() && signatures[next].first <= quarters + eps; ++next) {
+            std::tie(beats, length) = details::beat_of(signatures[next].second);
+        }
+    };
+    apply(0);
+    head_beats  = beats;
+    head_length = length;
+
+    const f64 end_quarters = to_quarters(end);
+    const f64 last         = std::max(end_quarters, signatures.empty() ? 0 : signatures.back().first);
+    f64       start        = 0;
+    for (;;) {
+        const auto bar = static_cast<i32>(bar_firsts.size());
+        bar_firsts.push_back(static_cast<u32>(beat_quarters.size()));
+        beat_quarters.push_back(start);
+        beat_bars.push_back(bar);
+        if (start > last + eps) break;   // the closing downbeat
+        // a time signature in the middle of the bar cuts it short
+        const f64 cut = next < signatures.size() ? signatures[next].first
+                                                 : std::numeric_limits<f64>::infinity();
+        for (i32 j = 1; j < beats && start + j * length < cut - eps; ++j) {
+            beat_quarters.push_back(start + j * length);
+            beat_bars.push_back(bar);
+        }
+        start = std::min(start + beats * length, cut);
+        apply(start);
+    }
+    tail_beats  = beats;
+    tail_length = length;
+
+    for (const f64 quarters : beat_quarters) {
+        if (quarters > end_quarters + eps) break;
+        beat_times.push_back(from_quarters(quarters));
+    }
+    for (const u32 first : bar_firsts) {
+        if (beat_quarters[first] > end_quarters + eps) break;
+        downbeat_times.push_back(from_quarters(beat_quarters[first]));
+    }
+}
+
+template<TType T>
+bool BeatGrid<T>::matches(const Score<T>& score, const unit end) const {
+    if (end != grid_end) return false;
+    if (std::is_same_v<T, Tick> && score.ticks_per_quarter != tpq) return false;
+    const auto same_signature = [](const TimeSignature<T>& a, const TimeSignature<T>& b) {
+        return a.time == b.time && a.numerator == b.numerator && a.denominator == b.denominator;
+    };
+    if (!std::equal(
+            score.time_signatures->cbegin(),
+            score.time_signatures->cend(),
+            signature_source.cbegin(),
+            signature_source.cend(),
+            same_signature
+        )) {
+        return false;
+    }
+    if constexpr (std::is_same_v<T, Second>) {
+        return std::equal(
+            score.tempos->cbegin(),
+            score.tempos->cend(),
+            tempo_source.cbegin(),
+            tempo_source.cend(),
+            [](const Tempo<T>& a, const Tempo<T>& b) { return a.time == b.time && a.mspq == b.mspq; }
+        );
+    }
+    return true;
+}
+
+template<TType T>
+size_t BeatGrid<T>::memory_usage() const {
+    return sizeof(BeatGrid) + signature_source.capacity() * sizeof(TimeSignature<T>)
+           + tempo_source.capacity() * sizeof(Tempo<T>)
+           + (pivot_times.capacity() + pivot_quarters.capacity() + rates.capacity()
+              + beat_quarters.capacity())
+                 * sizeof(f64)
+           + beat_bars.capacity() * sizeof(i32) + bar_firsts.capacity() * sizeof(u32)
+           + (beat_times.capacity() + downbeat_times.capacity()) * sizeof(unit);
+}
+
+template<TType T>
+f64 BeatGrid<T>::to_quarters(const unit time) const {
+    const auto   t = static_cast<f64>(time);
+    const size_t i = std::upper_bound(pivot_times.begin(), pivot_times.end(), t) - pivot_times.begin();
+    const size_t k = i == 0 ? 0 : i - 1;
+    return pivot_quarters[k] + (t - pivot_times[k]) * rates[k];
+}
+
+template<TType T>
+typename T::unit BeatGrid<T>::from_quarters(const f64 quarters) const {
+    const size_t i = std::upper_bound(pivot_quarters.begin(), pivot_quarters.end(), quarters)
+                     - pivot_quarters.begin();
+    const size_t k    = i == 0 ? 0 : i - 1;
+    const f64    time = pivot_times[k] + (quarters - pivot_quarters[k]) / rates[k];
+    if constexpr (std::is_integral_v<unit>) {
+        return static_cast<unit>(std::llround(time));
+    } else {
+        return static_cast<unit>(time);
+    }
+}
+
+template<TType T>
+typename T::unit BeatGrid<T>::downbeat(const i64 bar) const {
+    const auto num = static_cast<i64>(bar_firsts.size());
+    if (bar < 0) return from_quarters(static_cast<f64>(bar) * head_beats * head_length);
+    if (bar < num) return from_quarters(beat_quarters[bar_firsts[bar]]);
+    return from_quarters(
+        beat_quarters.back() + static_cast<f64>(bar - num + 1) * tail_beats * tail_length
+    );
+}
+
+template<TType T>
+typename BeatGrid<T>::Position BeatGrid<T>::locate_quarters(const f64 quarters, size_t& hint) const {
+    // out of the grid, count the beats of the time signature in effect there
+    auto extend = [](const f64 beats, const i32 per_bar, const i64 first_bar) {
+        const auto k   = static_cast<i64>(std::floor(beats));
+        const i64  bar = details::floor_div(k, per_bar);
+        return Position{
+            static_cast<i32>(first_bar + bar),
+            static_cast<i32>(k - bar * per_bar),
+            beats - static_cast<f64>(k),
+        };
+    };
+    // a time just before a beat, e.g. the beat itself rounded in seconds, is on the beat
+    const f64 tolerance = details::grid_eps * std::max(1., std::abs(quarters));
+    if (quarters < -tolerance) return extend(quarters / head_length, head_beats, 0);
+    const f64 last = beat_quarters.back();
+    if (quarters >= last - tolerance) {
+        return extend(std::max(quarters - last, 0.) / tail_length, tail_beats, beat_bars.back());
+    }
+    const auto begin = beat_quarters.begin();
+    const auto from  = beat_quarters[hint] <= quarters ? begin + static_cast<ptrdiff_t>(hint) : begin;
+    // quarters could be just below beat_quarters[0] = 0 here
+    const auto found = std::upper_bound(from, beat_quarters.end(), quarters) - begin;
+    hint             = found > 0 ? found - 1 : 0;
+    if (beat_quarters[hint + 1] - quarters <= tolerance) ++hint;
+    const f64 len = beat_quarters[hint + 1] - beat_quarters[hint];
+    const i32 bar = beat_bars[hint];
+    return {
+        bar,
+        static_cast<i32>(hint - bar_firsts[bar]),
+        std::clamp((quarters - beat_quarters[hint]) / len, 0., std::nextafter(1., 0.)),
+    };
+}
+
+template<TType T>
+typename BeatGrid<T>::Position BeatGrid<T>::locate(const unit time) const {
+    size_t hint = 0;
+    return locate_quarters(to_quarters(time), hint);
+}
+
+template<TType T>
+typename BeatGrid<T>::Batch BeatGrid<T>::locate(const std::span<const unit> times) const {
+    Batch ans;
+    ans.bars.reserve(times.size());
+    ans.beats.reserve(times.size());
+    ans.positions.reserve(times.size());
+    size_t hint = 0;
+    for (const unit time : times) {
+        const auto [bar, beat, position] = locate_quarters(to_quarters(time), hint);
+        ans.bars.push_back(bar);
+        ans.beats.push_back(beat);
+        ans.positions.push_back(position);
+    }
+    return ans;
+}
+
+#define INSTANTIATE_BEAT_GRID(__COUNT, T) template class BeatGrid<T>;
+
+REPEAT_ON(INSTANTIATE_BEAT_GRID, Tick, Quarter, Second)
+
+#undef INSTANTIATE_BEAT_GRID
+
+}   // namespace symusic
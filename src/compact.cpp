@@ -0,0 +1,273 @@
+#include <bit>
+#include <limits>
+#include <stdexcept>
+
+#include "MetaMacro.h"
+#include "symusic/compact.h"
+
+namespace symusic {
+
+namespace details {
+
+// map a time value to an unsigned integer with the same order, so deltas are small and exact
+inline u32 to_ordinal(const i32 x) { return std::bit_cast<u32>(x) ^ 0x80000000u; }
+
+inline u32 to_ordinal(const f32 x) {
+    const u32 bits = std::bit_cast<u32>(x);
+    return (bits & 0x80000000u) ? ~bits : bits ^ 0x80000000u;
+}
+
+template<typename unit>
+unit from_ordinal(u32 x);
+
+template<>
+inline i32 from_ordinal<i32>(const u32 x) {
+    return std::bit_cast<i32>(x ^ 0x80000000u);
+}
+
+template<>
+inline f32 from_ordinal<f32>(const u32 x) {
+    return std::bit_cast<f32>((x & 0x80000000u) ? x ^ 0x80000000u : ~x);
+}
+
+inline u64 zigzag(const i64 x) { return (static_cast<u64>(x) << 1) ^ static_cast<u64>(x >> 63); }
+
+inline i64 unzigzag(const u64 x) { return static_cast<i64>(x >> 1) ^ -static_cast<i64>(x & 1); }
+
+inline void write_varint(vec<u8>& out, u64 x) {
+    while (x >= 0x80) {
+        out.push_back(static_cast<u8>(x) | 0x80);
+        x >>= 7;
+    }
+    out.push_back(static_cast<u8>(x));
+}
+
+inline u64 read_varint(const u8*& p) {
+    u64 ans   = 0;
+    int shift = 0;
+    while (*p & 0x80) {
+        ans |= static_cast<u64>(*p++ & 0x7F) << shift;
+        shift += 7;
+    }
+    return ans | static_cast<u64>(*p++) << shift;
+}
+
+template<typename unit>
+void write_duration(vec<u8>& out, const unit duration) {
+    if constexpr (std::is_integral_v<unit>) {
+        write_varint(out, zigzag(duration));
+    } else {
+        const u32 bits = std::bit_cast<u32>(duration);
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<u8>(bits >> (8 * i)));
+    }
+}
+
+template<typename unit>
+unit read_duration(const u8*& p) {
+    if constexpr (std::is_integral_v<unit>) {
+        return static_cast<unit>(unzigzag(read_varint(p)));
+    } else {
+        u32 bits = 0;
+        for (int i = 0; i < 4; ++i) bits |= static_cast<u32>(*p++) << (8 * i);
+        return std::bit_cast<unit>(bits);
+    }
+}
+
+}   // namespace details
+
+template<TType T>
+CompactNotes<T>::CompactNotes(const vec<Note<T>>& notes, const size_t block_size) :
+    blk_size(block_size) {
+    encode(notes);
+}
+
+template<TType T>
+CompactNotes<T>::CompactNotes(const pyvec<Note<T>>& notes, const size_t block_size) :
+    blk_size(block_size) {
+    encode(notes.collect());
+}
+
+template<TType T>
+void CompactNotes<T>::encode(const std::span<const Note<T>> notes) {
+    if (blk_size == 0) {
+        throw std::invalid_argument("symusic::CompactNotes: block_size must be positive");
+    }
+    num = notes.size();
+    blocks.clear();
+    data.clear();
+    blocks.reserve((num + blk_size - 1) / blk_size);
+    // a rough guess: 2 bytes for onset, 2 bytes for duration and 2 bytes for pitch & velocity
+    data.reserve(num * 6);
+
+    for (size_t begin = 0; begin < num; begin += blk_size) {
+        const auto block = notes.subspan(begin, std::min(blk_size, num - begin));
+        if (data.size() > std::numeric_limits<u32>::max()) {
+            throw std::overflow_error("symusic::CompactNotes: too many notes in one store");
+        }
+        Block cur{block.front().time, static_cast<u32>(data.size()), 0, true};
+        // onsets and durations
+        u32 prev = details::to_ordinal(cur.base);
+        for (const auto& note : block) {
+            const u32 ord = details::to_ordinal(note.time);
+            details::write_varint(
+                data, details::zigzag(static_cast<i64>(ord) - static_cast<i64>(prev))
+            );
+            details::write_duration(data, note.duration);
+            prev = ord;
+        }
+        // pitch & velocity
+        cur.pv_offset = static_cast<u32>(data.size());
+        for (const auto& note : block) { cur.packed &= (note.pitch >= 0) & (note.velocity >= 0); }
+        if (cur.packed) {
+            u32 acc = 0, bits = 0;
+            for (const auto& note : block) {
+                acc |= (static_cast<u32>(note.pitch) | static_cast<u32>(note.velocity) << 7) << bits;
+                bits += 14;
+                while (bits >= 8) {
+                    data.push_back(static_cast<u8>(acc));
+                    acc >>= 8;
+                    bits -= 8;
+                }
+            }
+            if (bits > 0) data.push_back(static_cast<u8>(acc));
+        } else {
+            for (const auto& note : block) {
+                data.push_back(static_cast<u8>(note.pitch));
+                data.push_back(static_cast<u8>(note.velocity));
+            }
+        }
+        blocks.push_back(cur);
+    }
+    data.shrink_to_fit();
+}
+
+template<TType T>
+size_t CompactNotes<T>::nbytes() const {
+    return data.capacity() * sizeof(u8) + blocks.capacity() * sizeof(Block);
+}
+
+template<TType T>
+void CompactNotes<T>::decode_block(const size_t b, vec<Note<T>>& out) const {
+    if (b >= blocks.size()) {
+        throw std::out_of_range(
+            "symusic::CompactNotes: block index " + std::to_string(b) + " out of range"
+        );
+    }
+    const Block& block = blocks[b];
+    const size_t n     = std::min(blk_size, num - b * blk_size);
+    const size_t first = out.size();
+    out.reserve(first + n);
+
+    const u8* p    = data.data() + block.offset;
+    u32       prev = details::to_ordinal(block.base);
+    for (size_t i = 0; i < n; ++i) {
+        prev += static_cast<u32>(details::unzigzag(details::read_varint(p)));
+        const unit time     = details::from_ordinal<unit>(prev);
+        const unit duration = details::read_duration<unit>(p);
+        out.emplace_back(time, duration, 0, 0);
+    }
+
+    p = data.data() + block.pv_offset;
+    if (block.packed) {
+        u32 acc = 0, bits = 0;
+        for (size_t i = first; i < first + n; ++i) {
+            while (bits < 14) {
+                acc |= static_cast<u32>(*p++) << bits;
+                bits += 8;
+            }
+            out[i].pitch    = static_cast<i8>(acc & 0x7F);
+            out[i].velocity = static_cast<i8>((acc >> 7) & 0x7F);
+            acc >>= 14;
+            bits -= 14;
+        }
+    } else {
+        for (size_t i = first; i < first + n; ++i) {
+            out[i].pitch    = static_cast<i8>(*p++);
+            out[i].velocity = static_cast<i8>(*p++);
+        }
+    }
+}
+
+template<TType T>
+vec<Note<T>> CompactNotes<T>::decode_block(const size_t b) const {
+    vec<Note<T>> ans;
+    decode_block(b, ans);
+    return ans;
+}
+
+template<TType T>
+vec<Note<T>> CompactNotes<T>::decode_range(const size_t begin, size_t end) const {
+    end = std::min(end, num);
+    if (begin >= end) return {};
+    const size_t first_block = begin / blk_size;
+    const size_t last_block  = (end - 1) / blk_size;
+
+    vec<Note<T>> ans;
+    ans.reserve((last_block - first_block + 1) * blk_size);
+    for (size_t b = first_block; b <= last_block; ++b) decode_block(b, ans);
+    // drop the notes out of the range in the first and the last block
+    const size_t skip = begin - first_block * blk_size;
+    ans.erase(ans.begin() + static_cast<ptrdiff_t>(skip + end - begin), ans.end());
+    ans.erase(ans.begin(), ans.begin() + static_cast<ptrdiff_t>(skip));
+    return ans;
+}
+
+template<TType T>
+vec<Note<T>> CompactNotes<T>::decode() const {
+    vec<Note<T>> ans;
+    ans.reserve(num);
+    for (size_t b = 0; b < blocks.size(); ++b) decode_block(b, ans);
+    return ans;
+}
+
+template<TType T>
+Note<T> CompactNotes<T>::at(const size_t i) const {
+    if (i >= num) {
+        throw std::out_of_range(
+            "symusic::CompactNotes: note index " + std::to_string(i) + " out of range"
+        );
+    }
+    return decode_block(i / blk_size)[i % blk_size];
+}
+
+template<TType T>
+CompactTrack<T>::CompactTrack(const Track<T>& track, const size_t block_size) :
+    name{track.name}, program{track.program}, is_drum{track.is_drum},
+    notes{*track.notes, block_size}, controls{track.controls->collect()},
+    pitch_bends{track.pitch_bends->collect()}, pedals{track.pedals->collect()},
+    lyrics{track.lyrics->collect()} {}
+
+template<TType T>
+size_t CompactTrack<T>::nbytes() const {
+    size_t ans = notes.nbytes() + name.capacity();
+    ans += controls.capacity() * sizeof(ControlChange<T>);
+    ans += pitch_bends.capacity() * sizeof(PitchBend<T>);
+    ans += pedals.capacity() * sizeof(Pedal<T>);
+    ans += lyrics.capacity() * sizeof(TextMeta<T>);
+    for (const auto& lyric : lyrics) ans += lyric.text.capacity();
+    return ans;
+}
+
+template<TType T>
+Track<T> CompactTrack<T>::to_track() const {
+    return {
+        name,
+        program,
+        is_drum,
+        pyvec<Note<T>>(notes.decode()),
+        pyvec<ControlChange<T>>(vec<ControlChange<T>>(controls)),
+        pyvec<PitchBend<T>>(vec<PitchBend<T>>(pitch_bends)),
+        pyvec<Pedal<T>>(vec<Pedal<T>>(pedals)),
+        pyvec<TextMeta<T>>(vec<TextMeta<T>>(lyrics))
+    };
+}
+
+#define INSTANTIATE_COMPACT(__COUNT, T) \
+    template class CompactNotes<T>;     \
+    template struct CompactTrack<T>;
+
+REPEAT_ON(INSTANTIATE_COMPACT, Tick, Quarter, Second)
+
+#undef INSTANTIATE_COMPACT
+
+}   // namespace symusic
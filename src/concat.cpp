@@ -0,0 +1,290 @@
+#include <limits>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+
+#include "MetaMacro.h"
+#include "symusic/concat.h"
+#include "symusic/conversion.h"
+
+namespace symusic::ops {
+
+namespace details {
+
+// a part of a score placed into the result
+template<TType T>
+struct Piece {
+    typedef typename T::unit unit;
+
+    const Score<T>* score;
+    unit            lo;       // the events with lo <= time < hi are taken
+    unit            hi;
+    unit            anchor;   // where the piece starts, in the time of its score
+    unit            offset;   // added to the times
+};
+
+template<typename unit>
+constexpr unit time_lowest = std::numeric_limits<unit>::lowest();
+
+template<typename unit>
+constexpr unit time_max = std::numeric_limits<unit>::max();
+
+// an output list, and whether it is still sorted by time
+template<TimeEvent E>
+struct Sink {
+    typedef typename E::unit unit;
+
+    vec<E> events;
+    bool   sorted = true;
+
+    void push(const E& event, const unit time) {
+        if (!events.empty() && time < events.back().time) sorted = false;
+        events.push_back(event);
+        events.back().time = time;
+    }
+
+    template<TType T>
+    void append(const pyvec<E>& list, const Piece<T>& piece) {
+        for (const auto& event : list) {
+            if (event.time < piece.lo || event.time >= piece.hi) continue;
+            push(event, event.time + piece.offset);
+        }
+    }
+};
+
+template<TType T>
+struct TrackSink {
+    std::string            name;
+    u8                     program = 0;
+    bool                   is_drum = false;
+    size_t                 sizes[5]{};
+    Sink<Note<T>>          notes;
+    Sink<ControlChange<T>> controls;
+    Sink<PitchBend<T>>     pitch_bends;
+    Sink<Pedal<T>>         pedals;
+    Sink<TextMeta<T>>      lyrics;
+
+    void count(const Track<T>& track) {
+        sizes[0] += track.notes->size();
+        sizes[1] += track.controls->size();
+        sizes[2] += track.pitch_bends->size();
+        sizes[3] += track.pedals->size();
+        sizes[4] += track.lyrics->size();
+    }
+
+    void reserve() {
+        notes.events.reserve(sizes[0]);
+        controls.events.reserve(sizes[1]);
+        pitch_bends.events.reserve(sizes[2]);
+        pedals.events.reserve(sizes[3]);
+        lyrics.events.reserve(sizes[4]);
+    }
+
+    void append(const Track<T>& track, const Piece<T>& piece) {
+        notes.append(*track.notes, piece);
+        controls.append(*track.controls, piece);
+        pitch_bends.append(*track.pitch_bends, piece);
+        pedals.append(*track.pedals, piece);
+        lyrics.append(*track.lyrics, piece);
+    }
+
+    shared<Track<T>> build() {
+        auto ans = std::make_shared<Track<T>>(
+            std::move(name),
+            program,
+            is_drum,
+            pyvec<Note<T>>(std::move(notes.events)),
+            pyvec<ControlChange<T>>(std::move(controls.events)),
+            pyvec<PitchBend<T>>(std::move(pitch_bends.events)),
+            pyvec<Pedal<T>>(std::move(pedals.events)),
+            pyvec<TextMeta<T>>(std::move(lyrics.events))
+        );
+        ans->time_sorted = (notes.sorted ? Track<T>::NOTES : 0)
+                           | (controls.sorted ? Track<T>::CONTROLS : 0)
+                           | (pitch_bends.sorted ? Track<T>::PITCH_BENDS : 0)
+                           | (pedals.sorted ? Track<T>::PEDALS : 0)
+                           | (lyrics.sorted ? Track<T>::LYRICS : 0);
+        return ans;
+    }
+};
+
+template<TType T>
+bool same_value(const Tempo<T>& a, const Tempo<T>& b) {
+    return a.mspq == b.mspq;
+}
+
+template<TType T>
+bool same_value(const TimeSignature<T>& a, const TimeSignature<T>& b) {
+    return a.numerator == b.numerator && a.denominator == b.denominator;
+}
+
+template<TType T>
+bool same_value(const KeySignature<T>& a, const KeySignature<T>& b) {
+    return a.key == b.key && a.tonality == b.tonality;
+}
+
+// the last event at or before time, nullptr if there is none
+template<TimeEvent E>
+const E* in_effect(const pyvec<E>& events, const typename E::unit time) {
+    const E* ans = nullptr;
+    for (const auto& event : events) {
+        if (event.time <= time && (ans == nullptr || event.time >= ans->time)) ans = &event;
+    }
+    return ans;
+}
+
+// append a tempo (or signature) map of a piece. Unless it's the first piece, the events at the
+// start of the piece are replaced by the one in effect there, which is only inserted if it
+// differs from the one in effect in the output. fallback is the one in effect when there is none
+template<TType T, TimeEvent E>
+void append_map(
+    Sink<E>&                sink,
+    const pyvec<E>&         list,
+    const Piece<T>&         piece,
+    const std::optional<E>& fallback,
+    const bool              first
+) {
+    if (first) return sink.append(list, piece);
+    const E* fallback_ptr = fallback ? &*fallback : nullptr;
+    const E* cur          = in_effect(list, piece.anchor);
+    const E* value        = cur != nullptr ? cur : fallback_ptr;
+    const E* output       = sink.events.empty() ? fallback_ptr : &sink.events.back();
+    if (value != nullptr && (output == nullptr || !same_value(*value, *output))) {
+        sink.push(*value, piece.anchor + piece.offset);
+    }
+    for (const auto& event : list) {
+        if (event.time < piece.lo || event.time >= piece.hi || event.time == piece.anchor) continue;
+        sink.push(event, event.time + piece.offset);
+    }
+}
+
+template<TType T>
+Score<T> assemble(const vec<Piece<T>>& pieces, const i32 tpq) {
+    // the k-th track of each (program, is_drum) in each piece goes to the same output track
+    vec<TrackSink<T>>                              sinks;
+    std::map<std::tuple<u8, bool, size_t>, size_t> slots;
+    vec<vec<size_t>>                               slot_of(pieces.size());
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        std::map<std::pair<u8, bool>, size_t> seen;
+        for (const auto& track : *pieces[i].score->tracks) {
+            const size_t k     = seen[{track->program, track->is_drum}]++;
+            auto [it, created] = slots.try_emplace({track->program, track->is_drum, k}, sinks.size());
+            if (created) {
+                auto& sink   = sinks.emplace_back();
+                sink.name    = track->name;
+                sink.program = track->program;
+                sink.is_drum = track->is_drum;
+            }
+            sinks[it->second].count(*track);
+            slot_of[i].push_back(it->second);
+        }
+    }
+    for (auto& sink : sinks) sink.reserve();
+
+    Sink<TimeSignature<T>> time_signatures;
+    Sink<KeySignature<T>>  key_signatures;
+    Sink<Tempo<T>>         tempos;
+    Sink<TextMeta<T>>      markers;
+    size_t                 sizes[4]{};
+    for (const auto& piece : pieces) {
+        sizes[0] += piece.score->time_signatures->size();
+        sizes[1] += piece.score->key_signatures->size();
+        sizes[2] += piece.score->tempos->size();
+        sizes[3] += piece.score->markers->size();
+    }
+    // one inserted at the start of each piece at most
+    time_signatures.events.reserve(sizes[0] + pieces.size());
+    key_signatures.events.reserve(sizes[1] + pieces.size());
+    tempos.events.reserve(sizes[2] + pieces.size());
+    markers.events.reserve(sizes[3]);
+
+    const std::optional<TimeSignature<T>> default_time_signature{TimeSignature<T>(0, 4, 4)};
+    const std::optional<Tempo<T>>         default_tempo{Tempo<T>::from_qpm(0, 120)};
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        const auto& piece = pieces[i];
+        const auto& score = *piece.score;
+        for (size_t j = 0; j < score.tracks->size(); ++j) {
+            sinks[slot_of[i][j]].append(*(*score.tracks)[j], piece);
+        }
+        append_map(time_signatures, *score.time_signatures, piece, default_time_signature, i == 0);
+        append_map(key_signatures, *score.key_signatures, piece, std::optional<KeySignature<T>>{}, i == 0);
+        append_map(tempos, *score.tempos, piece, default_tempo, i == 0);
+        markers.append(*score.markers, piece);
+    }
+
+    auto tracks = std::make_shared<vec<shared<Track<T>>>>();
+    tracks->reserve(sinks.size());
+    for (auto& sink : sinks) tracks->push_back(sink.build());
+    Score<T> ans{
+        tpq,
+        std::move(tracks),
+        pyvec<TimeSignature<T>>(std::move(time_signatures.events)),
+        pyvec<KeySignature<T>>(std::move(key_signatures.events)),
+        pyvec<Tempo<T>>(std::move(tempos.events)),
+        pyvec<TextMeta<T>>(std::move(markers.events))
+    };
+    ans.time_sorted = (time_signatures.sorted ? Score<T>::TIME_SIGNATURES : 0)
+                      | (key_signatures.sorted ? Score<T>::KEY_SIGNATURES : 0)
+                      | (tempos.sorted ? Score<T>::TEMPOS : 0)
+                      | (markers.sorted ? Score<T>::MARKERS : 0);
+    return ans;
+}
+
+}   // namespace details
+
+template<TType T>
+Score<T> concat(const std::span<const shared<Score<T>>> scores, const typename T::unit gap) {
+    using unit = typename T::unit;
+    if (scores.empty()) throw std::invalid_argument("symusic::concat: no score to concatenate");
+    const i32 tpq = scores.front()->ticks_per_quarter;
+
+    vec<Score<T>> resampled;
+    resampled.reserve(scores.size());   // keep the pointers to them valid
+    vec<details::Piece<T>> pieces;
+    pieces.reserve(scores.size());
+    unit offset = 0;
+    for (const auto& item : scores) {
+        const Score<T>* score = item.get();
+        if constexpr (std::is_same_v<T, Tick>) {
+            if (score->ticks_per_quarter != tpq) {
+                score = &resampled.emplace_back(resample(*score, tpq));
+            }
+        }
+        pieces.push_back({score, details::time_lowest<unit>, details::time_max<unit>, 0, offset});
+        offset += score->end() + gap;
+    }
+    return details::assemble(pieces, tpq);
+}
+
+template<TType T>
+Score<T> splice(const Score<T>& score, const typename T::unit at, const Score<T>& other) {
+    using unit                        = typename T::unit;
+    const Score<T>*         inserted  = &other;
+    std::optional<Score<T>> resampled;
+    if constexpr (std::is_same_v<T, Tick>) {
+        if (other.ticks_per_quarter != score.ticks_per_quarter) {
+            resampled = resample(other, score.ticks_per_quarter);
+            inserted  = &*resampled;
+        }
+    }
+    const unit lowest = details::time_lowest<unit>;
+    const unit max    = details::time_max<unit>;
+    const unit length = inserted->end();
+    const vec<details::Piece<T>> pieces{
+        {&score, lowest, at, 0, 0},
+        {inserted, lowest, max, 0, at},
+        {&score, at, max, at, length},
+    };
+    return details::assemble(pieces, score.ticks_per_quarter);
+}
+
+#define INSTANTIATE_CONCAT(__COUNT, T)                                                             \
+    template Score<T> concat(std::span<const shared<Score<T>>> scores, typename T::unit gap);     \
+    template Score<T> splice(const Score<T>& score, typename T::unit at, const Score<T>& other);
+
+REPEAT_ON(INSTANTIATE_CONCAT, Tick, Quarter, Second)
+
+#undef INSTANTIATE_CONCAT
+
+}   // namespace symusic::ops
@@ -3,17 +3,44 @@
 // This file is now much too confusing to read.
 // Refactor it later.
 //
+#include <algorithm>
 #include <cmath>
+#include <numeric>
+#include <span>
+#include <utility>
 #include "symusic/conversion.h"
 #include "symusic/ops.h"
+#include "symusic/tempo_map.h"
 
 namespace symusic {
 
 namespace details {
 
+template<TType To, TType From, typename Converter>
+Track<To> convertTrack(
+    const Track<From>& track, const Converter& converter, const typename To::unit min_dur
+) {
+    Track<To> new_t(
+        track.name,
+        track.program,
+        track.is_drum,
+        converter.duration_vec(*track.notes, min_dur),
+        converter.time_vec(*track.controls),
+        converter.time_vec(*track.pitch_bends),
+        converter.duration_vec(*track.pedals, min_dur),
+        converter.time_vec(*track.lyrics)
+    );
+    // time conversion is monotonic, so the order of events is kept
+    new_t.time_sorted = track.time_sorted & ~track.exposed;
+    return new_t;
+}
+
 template<TType To, TType From, typename Converter>
 Score<To> convertInner(
-    const Score<From>& score, const Converter& converter, const typename To::unit min_dur
+    const Score<From>&      score,
+    const Converter&        converter,
+    const typename To::unit min_dur,
+    const ExecPolicy        policy
 ) {
     Score<To> new_s(score.ticks_per_quarter);
     // new_s.lyrics   = std::make_shared<pyvec<TextMeta<To>>>(
@@ -31,27 +58,15 @@ Score<To> convertInner(
     new_s.key_signatures = std::make_shared<pyvec<KeySignature<To>>>(
         std::move(converter.time_vec(*score.key_signatures))
     );
+    new_s.time_sorted = score.time_sorted & ~score.exposed;
 
-    new_s.tracks->reserve(score.tracks->size());
-    for (const shared<Track<From>>& track : *score.tracks) {
-        auto new_t   = std::make_shared<Track<To>>(track->name, track->program, track->is_drum);
-        new_t->notes = std::make_shared<pyvec<Note<To>>>(
-            std::move(converter.duration_vec(*track->notes, min_dur))
-        );
-        new_t->pedals = std::make_shared<pyvec<Pedal<To>>>(
-            std::move(converter.duration_vec(*track->pedals, min_dur))
-        );
-        new_t->pitch_bends = std::make_shared<pyvec<PitchBend<To>>>(
-            std::move(converter.time_vec(*track->pitch_bends))
-        );
-        new_t->controls = std::make_shared<pyvec<ControlChange<To>>>(
-            std::move(converter.time_vec(*track->controls))
+    // the converters are not modified by the conversion, so the tracks could share one
+    new_s.tracks->resize(score.tracks->size());
+    for_each_track(*score.tracks, policy, [&](const size_t i) {
+        (*new_s.tracks)[i] = std::make_shared<Track<To>>(
+            convertTrack<To, From>(*(*score.tracks)[i], converter, min_dur)
         );
-        new_t->lyrics = std::make_shared<pyvec<TextMeta<To>>>(
-            std::move(converter.time_vec(*track->lyrics))
-        );
-        new_s.tracks->push_back(std::move(new_t));
-    }
+    });
     return new_s;
 }
 
@@ -91,6 +106,7 @@ struct Tick2Tick : SimpleConverter<Tick2Tick, Tick, Tick> {
     typedef Tick To;
 
     explicit        Tick2Tick(const Score<From>& score) {}
+    explicit        Tick2Tick(const TempoMap<From>& tempo_map) {}
     static To::unit time(const From::unit t) { return t; }
 };
 
@@ -99,6 +115,7 @@ struct Quarter2Quarter : SimpleConverter<Quarter2Quarter, Quarter, Quarter> {
     typedef Quarter To;
 
     explicit        Quarter2Quarter(const Score<From>& score) {}
+    explicit        Quarter2Quarter(const TempoMap<From>& tempo_map) {}
     static To::unit time(const From::unit t) { return t; }
 };
 
@@ -107,6 +124,7 @@ struct Second2Second : SimpleConverter<Second2Second, Second, Second> {
     typedef Second To;
 
     explicit        Second2Second(const Score<From>& score) {}
+    explicit        Second2Second(const TempoMap<From>& tempo_map) {}
     static To::unit time(const From::unit t) { return t; }
 };
 
@@ -117,6 +135,8 @@ struct Tick2Quarter : SimpleConverter<Tick2Quarter, Quarter, Tick> {
 
     explicit Tick2Quarter(const Score<From>& score) :
         tpq(static_cast<f32>(score.ticks_per_quarter)) {}
+    explicit Tick2Quarter(const TempoMap<From>& tempo_map) :
+        tpq(static_cast<f32>(tempo_map.ticks_per_quarter())) {}
     [[nodiscard]] To::unit time(const From::unit t) const { return static_cast<To::unit>(t) / tpq; }
 };
 
@@ -127,210 +147,106 @@ struct Quarter2Tick : SimpleConverter<Quarter2Tick, Tick, Quarter> {
 
     explicit Quarter2Tick(const Score<From>& score) :
         tpq(static_cast<f32>(score.ticks_per_quarter)) {}
+    explicit Quarter2Tick(const TempoMap<From>& tempo_map) :
+        tpq(static_cast<f32>(tempo_map.ticks_per_quarter())) {}
     [[nodiscard]] To::unit time(const From::unit t) const {
         return static_cast<To::unit>(std::round(t * tpq));
     }
 };
 
-template<typename Converter, TType To, TType From>
-struct SecondConverter {
-    f64                      tpq;
-    vec<typename To::unit>   to_times;
-    vec<typename From::unit> from_times;
-    vec<f64>                 factors{};
-
-    explicit SecondConverter(const Score<From>& score) :
-        tpq(static_cast<f64>(score.ticks_per_quarter)), to_times(), from_times(){
-        vec<Tempo<From>> tempos;
-        if (score.tempos->empty()) {
-            // 120 qpm
-            tempos = {{0, 500000}, {std::numeric_limits<typename From::unit>::max(), 500000}};
-        } else {
-            tempos.reserve(score.tempos->size() + 2);
-            tempos.assign(score.tempos->cbegin(), score.tempos->cend());
-            pdqsort_branchless(tempos.begin(), tempos.end(), [](const auto& a, const auto& b) {
-                return (a.time) < (b.time);
-            });
-            if (tempos.empty() || tempos[0].time != static_cast<typename From::unit>(0)) {
-                tempos.insert(tempos.begin(), Tempo<From>(0, 500000));
-            }
-            // add a guard at the end
-            tempos.emplace_back(
-                std::numeric_limits<typename From::unit>::max(), tempos.back().mspq
-            );
-        }
+// conversions between seconds and ticks or quarters, following the cached tempo map of the score
+template<TType To, TType From>
+struct TempoConverter {
+    shared<const TempoMap<From>> owner;   // the cached map of the score, if built from one
+    const TempoMap<From>*        map;
 
-        const auto self = static_cast<const Converter*>(this);
+    explicit TempoConverter(const Score<From>& score) :
+        owner(score.tempo_map()), map(owner.get()) {}
 
-        typename To::unit   pivot_to   = 0;
-        typename From::unit pivot_from = 0;
-        double              cur_factor = self->get_factor(tempos[0]);
-
-        to_times.reserve(tempos.size());
-        from_times.reserve(tempos.size());
-        factors.reserve(tempos.size());
-
-        to_times.emplace_back(pivot_to);
-        from_times.emplace_back(pivot_from);
-        factors.emplace_back(cur_factor);
-
-        for (auto i = 1; i < tempos.size(); ++i) {
-            pivot_to   = self->get_time(tempos[i].time, pivot_to, pivot_from, cur_factor);
-            pivot_from = tempos[i].time;
-            cur_factor = self->get_factor(tempos[i]);
-            to_times.emplace_back(pivot_to);
-            from_times.emplace_back(pivot_from);
-            factors.emplace_back(cur_factor);
-        }
-    }
+    explicit TempoConverter(const TempoMap<From>& tempo_map) : map(&tempo_map) {}
 
     template<template<class> class T>
     [[nodiscard]] pyvec<T<To>> time_vec(const pyvec<T<From>>& data) const {
-        const auto self = static_cast<const Converter*>(this);
+        // gather the times into contiguous memory, so that sorted events are converted by runs
+        // of the same tempo instead of one by one
+        vec<typename From::unit> times;
+        times.reserve(data.size());
+        for (const T<From>& event : data) { times.push_back(event.time); }
+        const auto converted = map->template convert<From, To>(std::span(std::as_const(times)));
+
         vec<T<To>> capsule;
         capsule.reserve(data.size());
-
-        auto cur_range  = std::make_pair(from_times[0], from_times[1]);
-        auto pivot_to   = to_times[0];
-        auto cur_factor = factors[0];
-
-        for (const T<From>& event : data) {
-            if ((event->time) < cur_range.first | (event->time) >= cur_range.second) {
-                auto i = std::upper_bound(from_times.begin(), from_times.end(), event->time)
-                         - from_times.begin() - 1;
-                cur_range  = std::make_pair(from_times[i], from_times[i + 1]);
-                pivot_to   = to_times[i];
-                cur_factor = factors[i];
-            }
-            capsule.emplace_back(
-                self->get_time(event->time, pivot_to, cur_range.first, cur_factor), *event
-            );
-        }
+        size_t i = 0;
+        for (const T<From>& event : data) { capsule.emplace_back(converted[i++], event); }
         return pyvec<T<To>>(std::move(capsule));
     }
 
     template<template<class> class T>
     [[nodiscard]] pyvec<T<To>> duration_vec(const pyvec<T<From>>& data, typename To::unit min_dur)
         const {
-        const auto self = static_cast<const Converter*>(this);
-        min_dur         = std::max(min_dur, static_cast<typename To::unit>(0));
+        min_dur = std::max(min_dur, static_cast<typename To::unit>(0));
+
+        vec<typename From::unit> starts, ends;
+        starts.reserve(data.size());
+        ends.reserve(data.size());
+        for (const T<From>& event : data) {
+            starts.push_back(event.time);
+            ends.push_back(event.end());
+        }
+        // ends are converted separately, they are usually sorted too when the starts are
+        const auto new_starts = map->template convert<From, To>(std::span(std::as_const(starts)));
+        const auto new_ends   = map->template convert<From, To>(std::span(std::as_const(ends)));
 
         vec<T<To>> capsule;
         capsule.reserve(data.size());
-
-        auto cur_range  = std::make_pair(from_times[0], from_times[1]);
-        auto pivot_to   = to_times[0];
-        auto cur_factor = factors[0];
+        size_t i = 0;
         for (const T<From>& event : data) {
-            if ((event->time) < cur_range.first | (event->time) >= cur_range.second) {
-                auto i = std::upper_bound(from_times.begin(), from_times.end(), event->time)
-                         - from_times.begin() - 1;
-                cur_range  = std::make_pair(from_times[i], from_times[i + 1]);
-                pivot_to   = to_times[i];
-                cur_factor = factors[i];
-            }
-            auto start = self->get_time(event->time, pivot_to, cur_range.first, cur_factor);
-            if (auto end = event->end(); end < cur_range.first | end >= cur_range.second) {
-                auto i = std::upper_bound(from_times.begin(), from_times.end(), end)
-                         - from_times.begin() - 1;
-                cur_range  = std::make_pair(from_times[i], from_times[i + 1]);
-                pivot_to   = to_times[i];
-                cur_factor = factors[i];
-            }
-            auto end      = self->get_time(event->end(), pivot_to, cur_range.first, cur_factor);
-            auto duration = std::max(min_dur, end - start);
-            capsule.emplace_back(start, duration, *event);
+            capsule.emplace_back(new_starts[i], std::max(min_dur, new_ends[i] - new_starts[i]), event);
+            ++i;
         }
         return pyvec<T<To>>(std::move(capsule));
     }
 };
 
-struct Tick2Second : SecondConverter<Tick2Second, Second, Tick> {
-    typedef Tick   From;
-    typedef Second To;
-
-    explicit Tick2Second(const Score<From>& score) : SecondConverter{score} {}
-
-    [[nodiscard]] f64 get_factor(const Tempo<From>& tempo) const {
-        return static_cast<f64>(tempo.mspq) / 1000000. / tpq;
-    }
-
-    [[nodiscard]] To::unit static get_time(
-        const From::unit t,
-        const To::unit   pivot_to,
-        const From::unit pivot_from,
-        const f64        cur_factor
-    ) {
-        return pivot_to + static_cast<To::unit>(cur_factor * (t - pivot_from));
-    }
-};
-
-struct Second2Tick : SecondConverter<Second2Tick, Tick, Second> {
-    typedef Second From;
-    typedef Tick   To;
-
-    explicit Second2Tick(const Score<From>& score) : SecondConverter{score} {}
-
-    [[nodiscard]] f64 get_factor(const Tempo<From>& tempo) const {
-        return 1000000. * tpq / static_cast<f64>(tempo.mspq);
-    }
-
-    [[nodiscard]] To::unit static get_time(
-        const From::unit t,
-        const To::unit   pivot_to,
-        const From::unit pivot_from,
-        const f64        cur_factor
-    ) {
-        return pivot_to + static_cast<To::unit>(std::round(cur_factor * (t - pivot_from)));
-    }
-};
-
-struct Quarter2Second : SecondConverter<Quarter2Second, Second, Quarter> {
-    typedef Quarter From;
-    typedef Second  To;
-
-    explicit Quarter2Second(const Score<From>& score) : SecondConverter{score} {}
-
-    [[nodiscard]] static f64 get_factor(const Tempo<From>& tempo) {
-        return static_cast<f64>(tempo.mspq) / 1000000.;
-    }
-
-    [[nodiscard]] To::unit static get_time(
-        const From::unit t,
-        const To::unit   pivot_to,
-        const From::unit pivot_from,
-        const f64        cur_factor
-    ) {
-        return pivot_to + static_cast<To::unit>(cur_factor * (t - pivot_from));
-    }
-};
-
-struct Second2Quarter : SecondConverter<Second2Quarter, Quarter, Second> {
-    typedef Second  From;
-    typedef Quarter To;
-
-    explicit Second2Quarter(const Score<From>& score) : SecondConverter{score} {}
-
-    [[nodiscard]] static f64 get_factor(const Tempo<From>& tempo) {
-        return 1000000. / static_cast<f64>(tempo.mspq);
-    }
-
-    [[nodiscard]] To::unit static get_time(
-        const From::unit t,
-        const To::unit   pivot_to,
-        const From::unit pivot_from,
-        const f64        cur_factor
-    ) {
-        return pivot_to + static_cast<To::unit>(cur_factor * (t - pivot_from));
-    }
-};
+using Tick2Second    = TempoConverter<Second, Tick>;
+using Second2Tick    = TempoConverter<Tick, Second>;
+using Quarter2Second = TempoConverter<Second, Quarter>;
+using Second2Quarter = TempoConverter<Quarter, Second>;
 
 }   // namespace details
 
 #define IMPLEMENT_CONVERT(To, From)                                                          \
     template<>                                                                               \
-    Score<To> convert<To, From>(const Score<From>& score, To::unit min_dur) {                \
-        return details::convertInner<To, From>(score, details::From##2##To(score), min_dur); \
+    Score<To> convert<To, From>(                                                             \
+        const Score<From>& score, To::unit min_dur, const ExecPolicy policy                  \
+    ) {                                                                                      \
+        return details::convertInner<To, From>(                                              \
+            score, details::From##2##To(score), min_dur, policy                              \
+        );                                                                                   \
+    }                                                                                        \
+    template<>                                                                               \
+    Track<To> convert<To, From>(                                                             \
+        const Track<From>& track, const TempoMap<From>& tempo_map, To::unit min_dur          \
+    ) {                                                                                      \
+        return details::convertTrack<To, From>(                                              \
+            track, details::From##2##To(tempo_map), min_dur                                  \
+        );                                                                                   \
+    }                                                                                        \
+    template<>                                                                               \
+    Score<To> convert<To, From>(                                                             \
+        const Score<From>& score,                                                            \
+        From::unit         start,                                                            \
+        From::unit         end,                                                              \
+        To::unit           min_dur,                                                          \
+        const ExecPolicy   policy                                                            \
+    ) {                                                                                      \
+        /* only the kept events are copied by clip, the tempos are taken from the score */   \
+        return details::convertInner<To, From>(                                              \
+            score.clip(start, end, false, policy),                                           \
+            details::From##2##To(score),                                                     \
+            min_dur,                                                                         \
+            policy                                                                           \
+        );                                                                                   \
     }
 
 //                To        From
@@ -351,88 +267,242 @@ IMPLEMENT_CONVERT(Quarter, Second)
 
 namespace details {
 
-template<class T, class Convert>
-shared<pyvec<T>> resample_time(const pyvec<T>& data, Convert convert) {
+// t * tpq / from, rounded half away from zero like std::round, computed exactly in integers:
+// the ratio is reduced once, and t * num always fits in i64 for i32 ticks and tpq.
+// Integral ratios (e.g. 96 to 480) are a single multiplication, and no division is needed.
+class TickScaler {
+public:
+    TickScaler(const i32 from, const i32 to) {
+        if (from <= 0) {
+            throw std::invalid_argument(
+                "symusic::resample: ticks_per_quarter of the score must be positive"
+            );
+        }
+        const i64 g = std::gcd(from, to);
+        num         = to / g;
+        den         = from / g;
+    }
+
+    [[nodiscard]] bool identity() const { return num == den; }
+
+    [[nodiscard]] Tick::unit operator()(const Tick::unit t) const {
+        const i64 x = scaled(t);
+        check_range(x);
+        return static_cast<Tick::unit>(x);
+    }
+
+    // throw the same as operator() would, without keeping the result
+    void check(const Tick::unit t) const { check_range(scaled(t)); }
+
+private:
+    i64 num, den;
+
+    [[nodiscard]] i64 scaled(const Tick::unit t) const {
+        i64 x = static_cast<i64>(t) * num;
+        if (den != 1) x = x >= 0 ? (x + den / 2) / den : -((-x + den / 2) / den);
+        return x;
+    }
+
+    static void check_range(const i64 x) {
+        if (x > std::numeric_limits<i32>::max() || x < std::numeric_limits<i32>::min()) {
+            throw std::overflow_error(
+                "symusic::resample: time after resample (" + std::to_string(x)
+                + ") is out of int32 range"
+            );
+        }
+    }
+};
+
+inline void check_resample(const i32 tpq, const i32 min_dur) {
+    if (tpq <= 0) {
+        throw std::invalid_argument("symusic::resample: ticks_per_quarter must be positive");
+    }
+    if (min_dur < 0) {
+        throw std::invalid_argument("symusic::resample: min_dur must be non-negative");
+    }
+}
+
+template<class T>
+shared<pyvec<T>> resample_time(const pyvec<T>& data, const TickScaler& scale) {
     vec<T> capsule;
     capsule.reserve(data.size());
-    for (const auto& item : data) { capsule.emplace_back(convert(item->time), item); }
+    for (const auto& item : data) { capsule.emplace_back(scale(item.time), item); }
     return std::make_shared<pyvec<T>>(std::move(capsule));
 }
 
-template<class T, class Convert>
+template<class T>
 shared<pyvec<T>> resample_dur(
-    const pyvec<T>& data, Convert convert, const typename T::unit min_dur
+    const pyvec<T>& data, const TickScaler& scale, const typename T::unit min_dur
 ) {
     vec<T> capsule;
     capsule.reserve(data.size());
 
     for (const auto& item : data) {
-        capsule.emplace_back(convert(item->time), std::max(convert(item->duration), min_dur), item);
+        capsule.emplace_back(scale(item.time), std::max(scale(item.duration), min_dur), item);
     }
     return std::make_shared<pyvec<T>>(std::move(capsule));
 }
 
-Score<Tick> resample_inner(const Score<Tick>& score, const i32 tpq, const i32 min_dur) {
-    if (tpq <= 0) {
-        throw std::invalid_argument("symusic::resample: ticks_per_quarter must be positive");
+template<class T>
+void resample_time_inplace(pyvec<T>& data, const TickScaler& scale) {
+    for (auto& item : data) item.time = scale(item.time);
+}
+
+template<class T>
+void resample_dur_inplace(pyvec<T>& data, const TickScaler& scale, const typename T::unit min_dur) {
+    for (auto& item : data) {
+        item.time     = scale(item.time);
+        item.duration = std::max(scale(item.duration), min_dur);
     }
-    if (min_dur < 0) {
-        throw std::invalid_argument("symusic::resample: min_dur must be non-negative");
+}
+
+// scale the smallest and the largest times (and durations) of data, so that an overflow is
+// thrown before anything is modified. Rounding is monotonic, so the others fit in between
+template<class T>
+void check_resample_range(const pyvec<T>& data, const TickScaler& scale) {
+    if (data.empty()) return;
+    const auto [lo, hi] = std::minmax_element(
+        data.begin(), data.end(), [](const T& a, const T& b) { return a.time < b.time; }
+    );
+    scale.check(lo->time);
+    scale.check(hi->time);
+    if constexpr (requires(const T& item) { item.duration; }) {
+        const auto [short_, long_] = std::minmax_element(
+            data.begin(), data.end(), [](const T& a, const T& b) { return a.duration < b.duration; }
+        );
+        scale.check(short_->duration);
+        scale.check(long_->duration);
     }
-    Score<Tick> ans(tpq);
-    const f64   scale_rate = static_cast<f64>(tpq) / static_cast<f64>(score.ticks_per_quarter);
+}
 
-    auto f64toi32 = [](const f64 x) {
-        if (x > static_cast<f64>(std::numeric_limits<i32>::max())) {
-            throw std::overflow_error(
-                "symusic::resample: time after resample (" + std::to_string(x)
-                + ") is out of int32 range"
-            );
-        }
-        return static_cast<i32>(std::round(x));
-    };
+template<class T>
+void clamp_dur_inplace(pyvec<T>& data, const typename T::unit min_dur) {
+    for (auto& item : data) item.duration = std::max(item.duration, min_dur);
+}
 
-    auto convert = [f64toi32, scale_rate](const Tick::unit t) -> Tick::unit {
-        return f64toi32(scale_rate * static_cast<f64>(t));
-    };
+Score<Tick> resample_inner(
+    const Score<Tick>& score, const i32 tpq, const i32 min_dur, const ExecPolicy policy
+) {
+    check_resample(tpq, min_dur);
+    const TickScaler scale(score.ticks_per_quarter, tpq);
+    Score<Tick>      ans(tpq);
 
     // REPEAT_ON(RESAMPLE_GENERAL, time_signatures, key_signatures, tempos, lyrics, markers)
-    ans.time_signatures = resample_time(*score.time_signatures, convert);
-    ans.key_signatures  = resample_time(*score.key_signatures, convert);
-    ans.tempos          = resample_time(*score.tempos, convert);
-    // ans.lyrics          = resample_time(*score.lyrics, convert);
-    ans.markers         = resample_time(*score.markers, convert);
-
-    const size_t track_num = score.tracks->size();
-    ans.tracks             = std::make_shared<vec<shared<Track<Tick>>>>();
-    ans.tracks->reserve(track_num);
-    for (const auto& old_track : *score.tracks) {
-        auto new_track = std::make_shared<Track<Tick>>(
+    ans.time_signatures = resample_time(*score.time_signatures, scale);
+    ans.key_signatures  = resample_time(*score.key_signatures, scale);
+    ans.tempos          = resample_time(*score.tempos, scale);
+    // ans.lyrics          = resample_time(*score.lyrics, scale);
+    ans.markers         = resample_time(*score.markers, scale);
+    // rounding is monotonic, so the order of events is kept
+    ans.time_sorted     = score.time_sorted & ~score.exposed;
+
+    ans.tracks = std::make_shared<vec<shared<Track<Tick>>>>(score.tracks->size());
+    for_each_track(*score.tracks, policy, [&](const size_t i) {
+        const auto& old_track = (*score.tracks)[i];
+        auto        new_track = std::make_shared<Track<Tick>>(
             old_track->name, old_track->program, old_track->is_drum
         );
-        new_track->notes       = resample_dur(*old_track->notes, convert, min_dur);
-        new_track->pedals      = resample_dur(*old_track->pedals, convert, min_dur);
-        new_track->pitch_bends = resample_time(*old_track->pitch_bends, convert);
-        new_track->controls    = resample_time(*old_track->controls, convert);
-        new_track->lyrics      = resample_time(*old_track->lyrics, convert);
-        ans.tracks->push_back(std::move(new_track));
-    }
+        new_track->notes       = resample_dur(*old_track->notes, scale, min_dur);
+        new_track->pedals      = resample_dur(*old_track->pedals, scale, min_dur);
+        new_track->pitch_bends = resample_time(*old_track->pitch_bends, scale);
+        new_track->controls    = resample_time(*old_track->controls, scale);
+        new_track->lyrics      = resample_time(*old_track->lyrics, scale);
+        new_track->time_sorted = old_track->time_sorted & ~old_track->exposed;
+        (*ans.tracks)[i]       = std::move(new_track);
+    });
+    return ans;
+}
+
+// convert to ticks of tpq directly, without the ticks of the score in between
+template<TType From>
+Score<Tick> resample_fused(
+    const Score<From>& score, const i32 tpq, const i32 min_dur, const ExecPolicy policy
+) {
+    check_resample(tpq, min_dur);
+    // the ticks_per_quarter of the map is only used for ticks
+    const TempoMap<From> tempo_map(*score.tempos, tpq);
+    Score<Tick>          ans = [&] {
+        if constexpr (std::is_same_v<From, Quarter>) {
+            return convertInner<Tick, From>(score, Quarter2Tick(tempo_map), min_dur, policy);
+        } else {
+            return convertInner<Tick, From>(score, Second2Tick(tempo_map), min_dur, policy);
+        }
+    }();
+    ans.ticks_per_quarter = tpq;
     return ans;
 }
 
 }   // namespace details
 
 template<>
-Score<Tick> resample(const Score<Quarter>& score, const i32 tpq, const i32 min_dur) {
-    return details::resample_inner(convert<Tick>(score), tpq, min_dur);
+Score<Tick> resample(
+    const Score<Quarter>& score, const i32 tpq, const i32 min_dur, const ExecPolicy policy
+) {
+    return details::resample_fused(score, tpq, min_dur, policy);
 }
 
 template<>
-Score<Tick> resample(const Score<Tick>& score, const i32 tpq, const i32 min_dur) {
-    return details::resample_inner(score, tpq, min_dur);
+Score<Tick> resample(
+    const Score<Tick>& score, const i32 tpq, const i32 min_dur, const ExecPolicy policy
+) {
+    return details::resample_inner(score, tpq, min_dur, policy);
 }
 template<>
-Score<Tick> resample(const Score<Second>& score, const i32 tpq, const i32 min_dur) {
-    return details::resample_inner(convert<Tick>(score), tpq, min_dur);
+Score<Tick> resample(
+    const Score<Second>& score, const i32 tpq, const i32 min_dur, const ExecPolicy policy
+) {
+    return details::resample_fused(score, tpq, min_dur, policy);
+}
+
+void resample_inplace(
+    Score<Tick>& score, const i32 tpq, const i32 min_dur, const ExecPolicy policy
+) {
+    details::check_resample(tpq, min_dur);
+    const details::TickScaler scale(score.ticks_per_quarter, tpq);
+    if (scale.identity() && min_dur == 0) {
+        score.ticks_per_quarter = tpq;
+        return;
+    }
+    if (!scale.identity()) {
+        // all the new times are checked first, so that an overflow leaves the score unchanged
+        details::for_each_track(*score.tracks, policy, [&](const size_t i) {
+            const Track<Tick>& track = *(*score.tracks)[i];
+            details::check_resample_range(*track.notes, scale);
+            details::check_resample_range(*track.pedals, scale);
+            details::check_resample_range(*track.pitch_bends, scale);
+            details::check_resample_range(*track.controls, scale);
+            details::check_resample_range(*track.lyrics, scale);
+        });
+        details::check_resample_range(*score.time_signatures, scale);
+        details::check_resample_range(*score.key_signatures, scale);
+        details::check_resample_range(*score.tempos, scale);
+        details::check_resample_range(*score.markers, scale);
+    }
+    // lists shared with copies of the score are copied once here, the others are not copied at all
+    score.detach();
+    details::for_each_track(*score.tracks, policy, [&](const size_t i) {
+        Track<Tick>& track = *(*score.tracks)[i];
+        track.detach();
+        if (scale.identity()) {
+            // only min_dur is left to apply
+            details::clamp_dur_inplace(*track.notes, min_dur);
+            details::clamp_dur_inplace(*track.pedals, min_dur);
+            return;
+        }
+        details::resample_dur_inplace(*track.notes, scale, min_dur);
+        details::resample_dur_inplace(*track.pedals, scale, min_dur);
+        details::resample_time_inplace(*track.pitch_bends, scale);
+        details::resample_time_inplace(*track.controls, scale);
+        details::resample_time_inplace(*track.lyrics, scale);
+    });
+    if (!scale.identity()) {
+        details::resample_time_inplace(*score.time_signatures, scale);
+        details::resample_time_inplace(*score.key_signatures, scale);
+        details::resample_time_inplace(*score.tempos, scale);
+        // details::resample_time_inplace(*score.lyrics, scale);
+        details::resample_time_inplace(*score.markers, scale);
+    }
+    // rounding is monotonic, so time_sorted is kept
+    score.ticks_per_quarter = tpq;
 }
 }   // namespace symusic
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#include "pdqsort.h"
+#include "MetaMacro.h"
+#include "symusic/interval.h"
+
+namespace symusic {
+
+template<TType T>
+IntervalIndex<T>::IntervalIndex(const pyvec<Note<T>>& notes) {
+    const size_t n = notes.size();
+    if (n > std::numeric_limits<u32>::max()) {
+        throw std::overflow_error("symusic::IntervalIndex: too many notes");
+    }
+    order.resize(n);
+    std::iota(order.begin(), order.end(), 0);
+    // break ties by index, so that the order of the results is deterministic
+    pdqsort_branchless(order.begin(), order.end(), [&notes](const u32 a, const u32 b) {
+        return std::tie(notes[a].time, a) < std::tie(notes[b].time, b);
+    });
+
+    starts.reserve(n);
+    ends.reserve(n);
+    for (const u32 i : order) {
+        starts.push_back(notes[i].time);
+        ends.push_back(notes[i].end());
+    }
+
+    leaf_num = std::bit_ceil(std::max<size_t>(n, 1));
+    max_end.assign(2 * leaf_num, std::numeric_limits<unit>::lowest());
+    // notes with non-positive duration occupy nothing, so their leaves are never collected
+    for (size_t i = 0; i < n; ++i) {
+        if (ends[i] > starts[i]) max_end[leaf_num + i] = ends[i];
+    }
+    for (size_t node = leaf_num - 1; node > 0; --node) {
+        max_end[node] = std::max(max_end[2 * node], max_end[2 * node + 1]);
+    }
+}
+
+template<TType T>
+void IntervalIndex<T>::collect(
+    const size_t node, const size_t lo, const size_t hi, const size_t limit, const unit bound,
+    vec<u32>& out
+) const {
+    if (lo >= limit || max_end[node] <= bound) return;
+    if (hi - lo == 1) {
+        out.push_back(order[lo]);
+        return;
+    }
+    const size_t mid = (lo + hi) / 2;
+    collect(2 * node, lo, mid, limit, bound, out);
+    collect(2 * node + 1, mid, hi, limit, bound, out);
+}
+
+template<TType T>
+void IntervalIndex<T>::collect(const size_t limit, const unit bound, vec<u32>& out) const {
+    if (limit == 0) return;
+    collect(1, 0, leaf_num, limit, bound, out);
+}
+
+template<TType T>
+vec<u32> IntervalIndex<T>::at(const unit t) const {
+    vec<u32> ans;
+    // notes starting at or before t, and ending after t
+    const auto limit = std::upper_bound(starts.begin(), starts.end(), t) - starts.begin();
+    collect(limit, t, ans);
+    return ans;
+}
+
+template<TType T>
+vec<u32> IntervalIndex<T>::overlap(const unit begin, const unit end) const {
+    vec<u32> ans;
+    if (begin >= end) return ans;
+    // notes starting before end, and ending after begin
+    const auto limit = std::lower_bound(starts.begin(), starts.end(), end) - starts.begin();
+    collect(limit, begin, ans);
+    return ans;
+}
+
+template<TType T>
+typename IntervalIndex<T>::Batch IntervalIndex<T>::at_batch(const std::span<const unit> times
+) const {
+    Batch ans;
+    ans.offsets.reserve(times.size() + 1);
+    ans.offsets.push_back(0);
+    for (const unit t : times) {
+        const auto limit = std::upper_bound(starts.begin(), starts.end(), t) - starts.begin();
+        collect(limit, t, ans.indices);
+        ans.offsets.push_back(ans.indices.size());
+    }
+    return ans;
+}
+
+template<TType T>
+typename IntervalIndex<T>::Batch IntervalIndex<T>::overlap_batch(
+    const std::span<const unit> range_begins, const std::span<const unit> range_ends
+) const {
+    if (range_begins.size() != range_ends.size()) {
+        throw std::invalid_argument("symusic::IntervalIndex: begins and ends must have the same size");
+    }
+    Batch ans;
+    ans.offsets.reserve(range_begins.size() + 1);
+    ans.offsets.push_back(0);
+    for (size_t i = 0; i < range_begins.size(); ++i) {
+        if (range_begins[i] < range_ends[i]) {
+            const auto limit
+                = std::lower_bound(starts.begin(), starts.end(), range_ends[i]) - starts.begin();
+            collect(limit, range_begins[i], ans.indices);
+        }
+        ans.offsets.push_back(ans.indices.size());
+    }
+    return ans;
+}
+
+#define INSTANTIATE_INTERVAL(__COUNT, T) template class IntervalIndex<T>;
+
+REPEAT_ON(INSTANTIATE_INTERVAL, Tick, Quarter, Second)
+
+#undef INSTANTIATE_INTERVAL
+
+}   // namespace symusic
@@ -195,6 +195,8 @@ template<TType T, typename Conv, typename Container>   // only works for Tick an
     const u16      tpq = midi.ticks_per_quarter();
     ScoreNative<T> score(tpq);   // create a score with the given ticks per quarter
     int            count = -1;
+    // lyrics and markers repeat a lot, so the decoded text payloads are interned
+    TextDecoder    decode_text;
     for (const minimidi::TrackView<Container>& midi_track : midi) {
 
         const size_t    message_num = midi_track.size / 3 + 100;
@@ -284,9 +286,7 @@ template<TType T, typename Conv, typename Container>   // only works for Tick an
             case minimidi::MessageType::Meta: {
                 switch (const auto& meta = msg.template cast<minimidi::Meta>(); meta.meta_type()) {
                 case (minimidi::MetaType::TrackName): {
-                    auto data = meta.meta_value();
-                    auto tmp  = std::string(data.begin(), data.end());
-                    cur_name  = strip_non_utf_8(tmp);
+                    cur_name = decode_text(meta.meta_value());
                     break;
                 }
                 case (minimidi::MetaType::TimeSignature): {
@@ -310,18 +310,15 @@ template<TType T, typename Conv, typename Container>   // only works for Tick an
                     break;
                 }
                 case (minimidi::MetaType::Lyric): {
-                    auto  data  = meta.meta_value();
-                    auto& track = trackManager.template get<true>(meta.channel()).track;
-                    auto  text  = strip_non_utf_8(std::string(data.begin(), data.end()));
+                    auto&       track = trackManager.template get<true>(meta.channel()).track;
+                    const auto& text  = decode_text(meta.meta_value());
 
                     if (text.empty()) break;
                     track.lyrics.emplace_back(cur_time, text);
                     break;
                 }
                 case (minimidi::MetaType::Marker): {
-                    auto data = meta.meta_value();
-                    auto tmp  = std::string(data.begin(), data.end());
-                    auto text = strip_non_utf_8(tmp);
+                    const auto& text = decode_text(meta.meta_value());
                     if (text.empty()) break;
                     score.markers.emplace_back(cur_time, text);
                     break;
@@ -339,7 +336,20 @@ template<TType T, typename Conv, typename Container>   // only works for Tick an
     sort_by_time(score.key_signatures);
     sort_by_time(score.tempos);
     sort_by_time(score.markers);
-    return to_shared(std::move(score));
+    auto ans = to_shared(std::move(score));
+    // events in a midi track are appended in time order, except pedals, which are appended at
+    // pedal-off and may interleave between channels
+    ans.time_sorted = Score<T>::ALL;
+    for (const auto& track : *ans.tracks) {
+        track->time_sorted = Track<T>::ALL;
+        const bool pedal_sorted = std::is_sorted(
+            track->pedals->cbegin(),
+            track->pedals->cend(),
+            [](const auto& a, const auto& b) { return (a.time) < (b.time); }
+        );
+        if (!pedal_sorted) track->time_sorted &= ~Track<T>::PEDALS;
+    }
+    return ans;
 }
 
 minimidi::MidiFile<> to_midi(const Score<Tick>& score) {
@@ -423,19 +433,29 @@ minimidi::MidiFile<> to_midi(const Score<Tick>& score) {
         const size_t note_size  = track->notes->size();
         const auto   note_begin = static_cast<ptrdiff_t>(msgs.size());
 
-        // collect notes and make sure they are sorted
-        vec<Note<Tick>> notes(track->notes->size());
-        bool            sorted    = true;
-        Tick::unit      prev_time = 0;
-        for (size_t j = 0; const auto& note : *track->notes) {
-            notes[j++] = note;
-            sorted &= note.time >= prev_time;
-            prev_time = note.time;
+        // collect notes and make sure they are sorted. Notes known to be sorted are written in
+        // place, after a scan that costs little next to encoding, so a stale flag can't
+        // corrupt the file
+        vec<Note<Tick>> sorted_notes;
+        if (!track->is_time_sorted(Track<Tick>::NOTES)
+            || !details::is_sorted_by_time(*track->notes)) {
+            sorted_notes.resize(note_size);
+            bool       sorted    = true;
+            Tick::unit prev_time = 0;
+            for (size_t j = 0; const auto& note : *track->notes) {
+                sorted_notes[j++] = note;
+                sorted &= note.time >= prev_time;
+                prev_time = note.time;
+            }
+            if (!sorted) { sort_by_time(sorted_notes); }
         }
-        if (!sorted) { sort_by_time(notes); }
+        auto note_at = [&](const size_t j) -> const Note<Tick>& {
+            return sorted_notes.empty() ? (*track->notes)[j] : sorted_notes[j];
+        };
         // add notes to messages
         msgs.resize(msgs.size() + note_size * 2);
-        for (size_t i = note_begin; const auto& note : notes) {
+        for (size_t i = note_begin, j = 0; j < note_size; ++j) {
+            const Note<Tick>& note = note_at(j);
             if (note.duration > 0) {
                 msgs[i] = minimidi::NoteOff(note.end(), channel, note.pitch, note.velocity);
                 msgs[i + note_size]
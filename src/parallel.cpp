@@ -0,0 +1,109 @@
+#include <atomic>
+#include <exception>
+#include <memory>
+
+#include "symusic/parallel.h"
+
+namespace symusic {
+
+ThreadPool::ThreadPool(const size_t threads) {
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([this] {
+            for (;;) {
+                std::function<void()> task;
+                {
+                    std::unique_lock lock(mutex);
+                    ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+                    if (tasks.empty()) return;
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                }
+                task();
+            }
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    ready.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+ThreadPool& ThreadPool::shared() {
+    // leaked on purpose, see the comment of ThreadPool
+    static auto* pool = new ThreadPool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    return *pool;
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    ready.notify_one();
+}
+
+namespace details {
+
+void parallel_for(const size_t n, const bool parallel, const std::function<void(size_t)>& f) {
+    if (!parallel || n < 2) {
+        for (size_t i = 0; i < n; ++i) f(i);
+        return;
+    }
+    // shared with the helpers, which could start after the caller returns and find nothing to do
+    struct State {
+        const std::function<void(size_t)>* f;
+        size_t                             n;
+        std::atomic<size_t>                next{0};
+        std::mutex                         mutex;
+        std::condition_variable            done;
+        size_t                             running = 0;
+        std::exception_ptr                 error;
+    };
+    auto state = std::make_shared<State>();
+    state->f   = &f;
+    state->n   = n;
+
+    auto work = [](State& s) {
+        for (size_t i; (i = s.next.fetch_add(1)) < s.n;) {
+            try {
+                (*s.f)(i);
+            } catch (...) {
+                std::lock_guard lock(s.mutex);
+                if (!s.error) s.error = std::current_exception();
+            }
+        }
+    };
+
+    ThreadPool&  pool    = ThreadPool::shared();
+    const size_t helpers = std::min(pool.size(), n - 1);
+    for (size_t i = 0; i < helpers; ++i) {
+        pool.submit([state, work] {
+            // registered before taking any index, so the caller waits for the calls it makes
+            {
+                std::lock_guard lock(state->mutex);
+                ++state->running;
+            }
+            work(*state);
+            {
+                std::lock_guard lock(state->mutex);
+                --state->running;
+            }
+            state->done.notify_all();
+        });
+    }
+    work(*state);
+
+    std::unique_lock lock(state->mutex);
+    state->done.wait(lock, [&state] { return state->running == 0; });
+    if (state->error) std::rethrow_exception(state->error);
+}
+
+}   // namespace details
+
+}   // namespace symusic
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "pdqsort.h"
+#include "MetaMacro.h"
+#include "symusic/pipeline.h"
+#include "symusic/ops.h"
+
+namespace symusic {
+
+namespace details {
+inline i8 pipeline_add(const i8 x, const i8 offset, const bool saturate, const char* name) {
+    const i32 ans = x + offset;
+    if (!saturate && (ans < 0 || ans > 127)) {
+        throw std::range_error(
+            std::string("symusic::Pipeline: overflow while shifting ") + name + " "
+            + std::to_string(x) + " by " + std::to_string(offset)
+        );
+    }
+    return static_cast<i8>(std::clamp(ans, 0, 127));
+}
+}   // namespace details
+
+template<TType T>
+Pipeline<T>& Pipeline<T>::clip(const unit start, const unit end, const bool clip_end) {
+    step_list.push_back({Kind::CLIP, start, end, 0, clip_end});
+    return *this;
+}
+
+template<TType T>
+Pipeline<T>& Pipeline<T>::shift_time(const unit offset) {
+    step_list.push_back({Kind::SHIFT_TIME, offset, 0, 0, false});
+    return *this;
+}
+
+template<TType T>
+Pipeline<T>& Pipeline<T>::shift_pitch(const i8 offset, const bool saturate) {
+    step_list.push_back({Kind::SHIFT_PITCH, 0, 0, offset, saturate});
+    return *this;
+}
+
+template<TType T>
+Pipeline<T>& Pipeline<T>::shift_velocity(const i8 offset, const bool saturate) {
+    step_list.push_back({Kind::SHIFT_VELOCITY, 0, 0, offset, saturate});
+    return *this;
+}
+
+template<TType T>
+Pipeline<T>& Pipeline<T>::filter_pitch(const i8 min_pitch, const i8 max_pitch) {
+    const auto lo = static_cast<unit>(min_pitch), hi = static_cast<unit>(max_pitch);
+    step_list.push_back({Kind::FILTER_PITCH, lo, hi, 0, false});
+    return *this;
+}
+
+template<TType T>
+Pipeline<T>& Pipeline<T>::filter_velocity(const i8 min_velocity, const i8 max_velocity) {
+    const auto lo = static_cast<unit>(min_velocity), hi = static_cast<unit>(max_velocity);
+    step_list.push_back({Kind::FILTER_VELOCITY, lo, hi, 0, false});
+    return *this;
+}
+
+template<TType T>
+Pipeline<T>& Pipeline<T>::filter_duration(const unit min_duration, const unit max_duration) {
+    step_list.push_back({Kind::FILTER_DURATION, min_duration, max_duration, 0, false});
+    return *this;
+}
+
+template<TType T>
+Pipeline<T>& Pipeline<T>::sort(const bool reverse) {
+    has_sort      = true;
+    this->reverse = reverse;
+    return *this;
+}
+
+template<TType T>
+template<TimeEvent E>
+bool Pipeline<T>::run(E& event) const {
+    constexpr bool is_note = std::is_same_v<E, Note<T>>;
+    for (const Step& step : step_list) {
+        switch (step.kind) {
+        case Kind::CLIP: {
+            bool keep = event.time >= step.lo;
+            if constexpr (HashDuration<E>) {
+                keep &= step.flag ? event.end() <= step.hi : event.time < step.hi;
+            } else {
+                keep &= event.time < step.hi;
+            }
+            if (!keep) return false;
+            break;
+        }
+        case Kind::SHIFT_TIME: event.time += step.lo; break;
+        case Kind::SHIFT_PITCH:
+            if constexpr (is_note) {
+                event.pitch = details::pipeline_add(event.pitch, step.offset, step.flag, "pitch");
+            }
+            break;
+        case Kind::SHIFT_VELOCITY:
+            if constexpr (is_note) {
+                event.velocity
+                    = details::pipeline_add(event.velocity, step.offset, step.flag, "velocity");
+            }
+            break;
+        case Kind::FILTER_PITCH:
+            if constexpr (is_note) {
+                if (event.pitch < step.lo || event.pitch > step.hi) return false;
+            }
+            break;
+        case Kind::FILTER_VELOCITY:
+            if constexpr (is_note) {
+                if (event.velocity < step.lo || event.velocity > step.hi) return false;
+            }
+            break;
+        case Kind::FILTER_DURATION:
+            if constexpr (HashDuration<E>) {
+                if (event.duration < step.lo || event.duration > step.hi) return false;
+            }
+            break;
+        }
+    }
+    return true;
+}
+
+template<TType T>
+template<TimeEvent E>
+pyvec<E> Pipeline<T>::run(const pyvec<E>& events) const {
+    vec<E> ans;
+    ans.reserve(events.size());
+    for (const E& event : events) {
+        ans.push_back(event);
+        if (!run(ans.back())) ans.pop_back();
+    }
+    if (has_sort) {
+        auto cmp = [this](const E& a, const E& b) {
+            return reverse ? b.default_key() < a.default_key() : a.default_key() < b.default_key();
+        };
+        pdqsort_branchless(ans.begin(), ans.end(), cmp);
+    }
+    return {std::move(ans)};
+}
+
+template<TType T>
+template<TimeEvent E>
+pyvec<E> Pipeline<T>::run_with_sentinel(const pyvec<E>& events) const {
+    auto ans = events.deepcopy();
+    for (const Step& step : step_list) {
+        if (step.kind == Kind::CLIP) {
+            ops::clip_with_sentinel_inplace(ans, step.lo, step.hi);
+        } else if (step.kind == Kind::SHIFT_TIME) {
+            ops::shift_time_inplace(ans, step.lo);
+        }
+    }
+    if (has_sort) ans.sort([](const E& event) { return event.default_key(); }, reverse);
+    return ans;
+}
+
+template<TType T>
+Track<T> Pipeline<T>::apply(const Track<T>& track) const {
+    Track<T> ans{
+        track.name,
+        track.program,
+        track.is_drum,
+        run(*track.notes),
+        run(*track.controls),
+        run(*track.pitch_bends),
+        run(*track.pedals),
+        run(*track.lyrics)
+    };
+    // all the steps except sort keep the relative order of the events
+    if (has_sort) {
+        ans.time_sorted = reverse ? 0 : Track<T>::ALL;
+    } else {
+        ans.time_sorted = track.time_sorted & ~track.exposed;
+    }
+    return ans;
+}
+
+template<TType T>
+Score<T> Pipeline<T>::apply(const Score<T>& score) const {
+    Score<T> ans{
+        score.ticks_per_quarter,
+        std::make_shared<vec<shared<Track<T>>>>(),
+        run_with_sentinel(*score.time_signatures),
+        run_with_sentinel(*score.key_signatures),
+        run_with_sentinel(*score.tempos),
+        // run(*score.lyrics),
+        run(*score.markers)
+    };
+    ans.tracks->reserve(score.tracks->size());
+    for (const auto& track : *score.tracks) {
+        ans.tracks->push_back(std::make_shared<Track<T>>(apply(*track)));
+    }
+    if (has_sort) {
+        ans.time_sorted = reverse ? 0 : Score<T>::ALL;
+    } else {
+        ans.time_sorted = score.time_sorted & ~score.exposed;
+    }
+    return ans;
+}
+
+#define INSTANTIATE_PIPELINE(__COUNT, T) template class Pipeline<T>;
+
+REPEAT_ON(INSTANTIATE_PIPELINE, Tick, Quarter, Second)
+
+#undef INSTANTIATE_PIPELINE
+
+}   // namespace symusic
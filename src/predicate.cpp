@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <optional>
+#include <stdexcept>
+
+#include "MetaMacro.h"
+#include "symusic/predicate.h"
+
+namespace symusic {
+
+namespace details {
+
+namespace {
+class PredicateParser {
+public:
+    PredicateParser(const std::string_view expr, const std::span<const std::string_view> fields) :
+        expr{expr}, fields{fields} {}
+
+    PredicateCode parse() {
+        parse_or();
+        skip_space();
+        if (pos != expr.size()) error("unexpected token");
+        return std::move(ans);
+    }
+
+private:
+    std::string_view                  expr;
+    std::span<const std::string_view> fields;
+    size_t                            pos   = 0;
+    size_t                            stack = 0;
+    PredicateCode                     ans;
+
+    [[noreturn]] void error(const std::string& msg) const {
+        throw std::invalid_argument(
+            "symusic::Predicate: " + msg + " at position " + std::to_string(pos) + " in \""
+            + std::string(expr) + "\""
+        );
+    }
+
+    void skip_space() {
+        while (pos < expr.size() && std::isspace(static_cast<unsigned char>(expr[pos]))) ++pos;
+    }
+
+    // try to consume a symbol, or a keyword that is not followed by an identifier character
+    bool accept(const std::string_view token) {
+        skip_space();
+        if (expr.substr(pos, token.size()) != token) return false;
+        const size_t next = pos + token.size();
+        if (std::isalpha(static_cast<unsigned char>(token.front())) && next < expr.size()
+            && (std::isalnum(static_cast<unsigned char>(expr[next])) || expr[next] == '_')) {
+            return false;
+        }
+        pos = next;
+        return true;
+    }
+
+    void expect(const std::string_view token) {
+        if (!accept(token)) error("expected \"" + std::string(token) + "\"");
+    }
+
+    void emit(const PredicateCode::Op op, const u8 field = 0, const f64 value = 0) {
+        ans.code.push_back({op, field, value});
+        // a comparison pushes a mask, NOT keeps the depth, AND and OR pop one
+        if (op <= PredicateCode::NE) {
+            ans.depth = std::max(ans.depth, ++stack);
+        } else if (op != PredicateCode::NOT) {
+            --stack;
+        }
+    }
+
+    void parse_or() {
+        parse_and();
+        while (accept("or") || accept("||")) {
+            parse_and();
+            emit(PredicateCode::OR);
+        }
+    }
+
+    void parse_and() {
+        parse_unary();
+        while (accept("and") || accept("&&")) {
+            parse_unary();
+            emit(PredicateCode::AND);
+        }
+    }
+
+    void parse_unary() {
+        if (accept("not") || accept("!")) {
+            parse_unary();
+            emit(PredicateCode::NOT);
+        } else if (accept("(")) {
+            parse_or();
+            expect(")");
+        } else {
+            parse_cmp();
+        }
+    }
+
+    std::optional<u8> parse_field() {
+        skip_space();
+        const size_t begin = pos;
+        while (pos < expr.size()
+               && (std::isalnum(static_cast<unsigned char>(expr[pos])) || expr[pos] == '_')) {
+            ++pos;
+        }
+        if (begin == pos || std::isdigit(static_cast<unsigned char>(expr[begin]))) {
+            pos = begin;
+            return std::nullopt;
+        }
+        const auto name = expr.substr(begin, pos - begin);
+        const auto it   = std::find(fields.begin(), fields.end(), name);
+        if (it == fields.end()) {
+            pos = begin;
+            error("unknown field \"" + std::string(name) + "\"");
+        }
+        return static_cast<u8>(it - fields.begin());
+    }
+
+    f64 parse_number() {
+        skip_space();
+        f64         value = 0;
+        const char* first = expr.data() + pos;
+        const char* last  = expr.data() + expr.size();
+        // from_chars doesn't accept a leading plus sign
+        if (first != last && *first == '+') ++first;
+        const auto [ptr, ec] = std::from_chars(first, last, value);
+        if (ec != std::errc{}) error("expected a number");
+        pos = ptr - expr.data();
+        return value;
+    }
+
+    std::optional<PredicateCode::Op> parse_op() {
+        // longer tokens first
+        static constexpr std::array<std::pair<std::string_view, PredicateCode::Op>, 6> ops{{
+            {"<=", PredicateCode::LE},
+            {">=", PredicateCode::GE},
+            {"==", PredicateCode::EQ},
+            {"!=", PredicateCode::NE},
+            {"<", PredicateCode::LT},
+            {">", PredicateCode::GT},
+        }};
+        for (const auto& [token, op] : ops) {
+            if (accept(token)) return op;
+        }
+        return std::nullopt;
+    }
+
+    static PredicateCode::Op flip(const PredicateCode::Op op) {
+        switch (op) {
+        case PredicateCode::LT: return PredicateCode::GT;
+        case PredicateCode::LE: return PredicateCode::GE;
+        case PredicateCode::GT: return PredicateCode::LT;
+        case PredicateCode::GE: return PredicateCode::LE;
+        default: return op;
+        }
+    }
+
+    void parse_cmp() {
+        if (const auto field = parse_field()) {
+            if (accept("in")) {
+                const bool left_open = accept("(");
+                if (!left_open) expect("[");
+                const f64 lo = parse_number();
+                expect(",");
+                const f64 hi         = parse_number();
+                const bool right_open = accept(")");
+                if (!right_open) expect("]");
+                emit(left_open ? PredicateCode::GT : PredicateCode::GE, *field, lo);
+                emit(right_open ? PredicateCode::LT : PredicateCode::LE, *field, hi);
+                emit(PredicateCode::AND);
+                return;
+            }
+            const auto op = parse_op();
+            if (!op) error("expected a comparison operator or \"in\"");
+            emit(*op, *field, parse_number());
+            return;
+        }
+        // number op field
+        const f64  value = parse_number();
+        const auto op    = parse_op();
+        if (!op) error("expected a comparison operator");
+        const auto field = parse_field();
+        if (!field) error("expected a field name");
+        emit(flip(*op), *field, value);
+    }
+};
+}   // namespace
+
+PredicateCode compile_predicate(
+    const std::string_view expr, const std::span<const std::string_view> fields
+) {
+    return PredicateParser(expr, fields).parse();
+}
+
+template<typename T>
+const auto& deref(const T& item) {
+    return item;
+}
+
+template<typename T>
+const auto& deref(const shared<T>& item) {
+    return *item;
+}
+
+template<PredicateCode::Op op>
+void compare(const f64* column, const size_t n, const f64 value, u8* out) {
+    for (size_t i = 0; i < n; ++i) {
+        const f64 x = column[i];
+        if constexpr (op == PredicateCode::LT) out[i] = x < value;
+        if constexpr (op == PredicateCode::LE) out[i] = x <= value;
+        if constexpr (op == PredicateCode::GT) out[i] = x > value;
+        if constexpr (op == PredicateCode::GE) out[i] = x >= value;
+        if constexpr (op == PredicateCode::EQ) out[i] = x == value;
+        if constexpr (op == PredicateCode::NE) out[i] = x != value;
+    }
+}
+
+}   // namespace details
+
+template<typename E>
+Predicate<E>::Predicate(const std::string_view expr) :
+    expr{expr}, program{details::compile_predicate(expr, Fields<E>::names)} {}
+
+template<typename E>
+vec<u8> Predicate<E>::mask(const container& items) const {
+    using Code = details::PredicateCode;
+    // evaluate block by block, so that the masks and the column stay in the cache
+    constexpr size_t block = 512;
+
+    const size_t               n = items.size();
+    vec<u8>                    ans(n);
+    vec<std::array<u8, block>> stack(program.depth);
+    std::array<f64, block>     column{};
+
+    for (size_t begin = 0; begin < n; begin += block) {
+        const size_t len = std::min(block, n - begin);
+        size_t       top = 0;
+        for (const auto& instr : program.code) {
+            if (instr.op <= Code::NE) {
+                Fields<E>::visit(instr.field, [&](auto getter) {
+                    for (size_t i = 0; i < len; ++i) {
+                        column[i] = static_cast<f64>(getter(details::deref(items[begin + i])));
+                    }
+                });
+                u8* out = stack[top++].data();
+                switch (instr.op) {
+                case Code::LT: details::compare<Code::LT>(column.data(), len, instr.value, out); break;
+                case Code::LE: details::compare<Code::LE>(column.data(), len, instr.value, out); break;
+                case Code::GT: details::compare<Code::GT>(column.data(), len, instr.value, out); break;
+                case Code::GE: details::compare<Code::GE>(column.data(), len, instr.value, out); break;
+                case Code::EQ: details::compare<Code::EQ>(column.data(), len, instr.value, out); break;
+                default: details::compare<Code::NE>(column.data(), len, instr.value, out); break;
+                }
+            } else if (instr.op == Code::NOT) {
+                auto& a = stack[top - 1];
+                for (size_t i = 0; i < len; ++i) a[i] ^= 1;
+            } else {
+                auto&       a = stack[top - 2];
+                const auto& b = stack[--top];
+                if (instr.op == Code::AND) {
+                    for (size_t i = 0; i < len; ++i) a[i] &= b[i];
+                } else {
+                    for (size_t i = 0; i < len; ++i) a[i] |= b[i];
+                }
+            }
+        }
+        std::copy_n(stack[0].begin(), len, ans.begin() + static_cast<ptrdiff_t>(begin));
+    }
+    return ans;
+}
+
+template<typename E>
+bool Predicate<E>::operator()(const E& item) const {
+    using Code = details::PredicateCode;
+    vec<u8> stack;
+    stack.reserve(program.depth);
+    for (const auto& instr : program.code) {
+        if (instr.op <= Code::NE) {
+            const f64 x = Fields<E>::visit(instr.field, [&](auto getter) {
+                return static_cast<f64>(getter(item));
+            });
+            const f64 v = instr.value;
+            switch (instr.op) {
+            case Code::LT: stack.push_back(x < v); break;
+            case Code::LE: stack.push_back(x <= v); break;
+            case Code::GT: stack.push_back(x > v); break;
+            case Code::GE: stack.push_back(x >= v); break;
+            case Code::EQ: stack.push_back(x == v); break;
+            default: stack.push_back(x != v); break;
+            }
+        } else if (instr.op == Code::NOT) {
+            stack.back() ^= 1;
+        } else {
+            const u8 b = stack.back();
+            stack.pop_back();
+            if (instr.op == Code::AND) stack.back() &= b;
+            else stack.back() |= b;
+        }
+    }
+    return stack.front();
+}
+
+template<typename E>
+void Predicate<E>::filter_inplace(container& items) const {
+    const auto keep = mask(items);
+    if constexpr (std::is_same_v<container, pyvec<E>>) {
+        // filter visits the items in order
+        size_t i = 0;
+        items.filter([&](const E&) { return keep[i++] != 0; });
+    } else {
+        size_t kept = 0;
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (keep[i]) items[kept++] = std::move(items[i]);
+        }
+        items.resize(kept);
+    }
+}
+
+#define INSTANTIATE_PREDICATE(__COUNT, T)         \
+    template class Predicate<Note<T>>;            \
+    template class Predicate<Pedal<T>>;           \
+    template class Predicate<ControlChange<T>>;   \
+    template class Predicate<TimeSignature<T>>;   \
+    template class Predicate<KeySignature<T>>;    \
+    template class Predicate<Tempo<T>>;           \
+    template class Predicate<PitchBend<T>>;       \
+    template class Predicate<TextMeta<T>>;        \
+    template class Predicate<Track<T>>;
+
+REPEAT_ON(INSTANTIATE_PREDICATE, Tick, Quarter, Second)
+
+#undef INSTANTIATE_PREDICATE
+
+}   // namespace symusic
@@ -4,6 +4,8 @@
 #include "MetaMacro.h"
 #include "symusic/score.h"
 #include "symusic/ops.h"
+#include "symusic/tempo_map.h"
+#include "symusic/beat_grid.h"
 
 namespace symusic {
 
@@ -21,11 +23,11 @@ typename T::unit Score<T>::start() const {
 
     typename T::unit ans = std::numeric_limits<typename T::unit>::max();
     for (const shared<Track<T>>& track : *tracks) { ans = std::min(ans, track->start()); }
-    ans = std::min(ans, ops::start(*time_signatures));
-    ans = std::min(ans, ops::start(*key_signatures));
-    ans = std::min(ans, ops::start(*tempos));
+    ans = std::min(ans, ops::start(*time_signatures, is_time_sorted(TIME_SIGNATURES)));
+    ans = std::min(ans, ops::start(*key_signatures, is_time_sorted(KEY_SIGNATURES)));
+    ans = std::min(ans, ops::start(*tempos, is_time_sorted(TEMPOS)));
     // ans = std::min(ans, ops::start(*lyrics));
-    ans = std::min(ans, ops::start(*markers));
+    ans = std::min(ans, ops::start(*markers, is_time_sorted(MARKERS)));
     return ans;
 }
 
@@ -35,11 +37,11 @@ typename T::unit Score<T>::end() const {
 
     typename T::unit ans = std::numeric_limits<typename T::unit>::min();
     for (const shared<Track<T>>& track : *tracks) { ans = std::max(ans, track->end()); }
-    ans = std::max(ans, ops::end(*time_signatures));
-    ans = std::max(ans, ops::end(*key_signatures));
-    ans = std::max(ans, ops::end(*tempos));
+    ans = std::max(ans, ops::end(*time_signatures, is_time_sorted(TIME_SIGNATURES)));
+    ans = std::max(ans, ops::end(*key_signatures, is_time_sorted(KEY_SIGNATURES)));
+    ans = std::max(ans, ops::end(*tempos, is_time_sorted(TEMPOS)));
     // ans = std::max(ans, ops::end(*lyrics));
-    ans = std::max(ans, ops::end(*markers));
+    ans = std::max(ans, ops::end(*markers, is_time_sorted(MARKERS)));
     return ans;
 }
 
@@ -50,6 +52,27 @@ size_t Score<T>::note_num() const {
     return ans;
 }
 
+template<TType T>
+shared<const TempoMap<T>> Score<T>::tempo_map() const {
+    // threads racing here may each build a map, any of them is valid
+    auto ans = tempo_map_cache.load();
+    if (ans == nullptr || !ans->matches(*tempos, ticks_per_quarter)) {
+        ans = std::make_shared<const TempoMap<T>>(*this);
+        tempo_map_cache.store(ans);
+    }
+    return ans;
+}
+
+template<TType T>
+shared<const BeatGrid<T>> Score<T>::beat_grid(const unit end) const {
+    auto ans = beat_grid_cache.load();
+    if (ans == nullptr || !ans->matches(*this, end)) {
+        ans = std::make_shared<const BeatGrid<T>>(*this, end);
+        beat_grid_cache.store(ans);
+    }
+    return ans;
+}
+
 template<TType T>
 bool Score<T>::empty() const {
     return tracks->empty()
@@ -66,83 +89,335 @@ size_t Score<T>::track_num() const {
 }
 
 template<TType T>
-void Score<T>::sort_inplace(const bool reverse) {
+MemoryUsage Score<T>::memory_usage() const {
+    MemoryUsage ans;
+    for (const auto& track : *tracks) {
+        ans += track->memory_usage();
+        // the block of the track object itself, apart from the block of its lists
+        ans.other += details::control_block_size;
+    }
+    ans.time_signatures = symusic::memory_usage(time_signatures);
+    ans.key_signatures  = symusic::memory_usage(key_signatures);
+    ans.tempos          = symusic::memory_usage(tempos);
+    ans.markers         = symusic::memory_usage(markers);
+    ans.other += sizeof(Score) + details::control_block_size;
+    ans.other += sizeof(vec<shared<Track<T>>>) + tracks->capacity() * sizeof(shared<Track<T>>);
+    ans.other += details::control_blocks_usage(
+        tracks, time_signatures, key_signatures, tempos, markers
+    );
+    // the block is allocated as a whole, see Track::memory_usage
+    if (const u8 block = pooled()) {
+        if (!(block & TIME_SIGNATURES)) ans.other += sizeof(pyvec<TimeSignature<T>>);
+        if (!(block & KEY_SIGNATURES)) ans.other += sizeof(pyvec<KeySignature<T>>);
+        if (!(block & TEMPOS)) ans.other += sizeof(pyvec<Tempo<T>>);
+        if (!(block & MARKERS)) ans.other += sizeof(pyvec<TextMeta<T>>);
+    }
+    if (const auto map = tempo_map_cache.load()) {
+        ans.other += details::control_block_size + map->memory_usage();
+    }
+    if (const auto grid = beat_grid_cache.load()) {
+        ans.other += details::control_block_size + grid->memory_usage();
+    }
+    return ans;
+}
+
+template<TType T>
+void Score<T>::shrink_to_fit() {
+    for (const auto& track : *tracks) track->shrink_to_fit();
+    tracks->shrink_to_fit();
+    // the block is rebuilt as a whole, see Track::shrink_to_fit
+    if (const u8 block = pooled(); block && !block_shared(block)) {
+        if (block == ALL) {
+            alloc_lists(std::make_shared<details::ScoreLists<T>>(
+                pyvec<TimeSignature<T>>(time_signatures->collect()),
+                pyvec<KeySignature<T>>(key_signatures->collect()),
+                pyvec<Tempo<T>>(tempos->collect()),
+                pyvec<TextMeta<T>>(markers->collect())
+            ));
+        } else {
+            unpool();
+        }
+    }
+    if (!(exposed & TIME_SIGNATURES) && own_refs(time_signatures) == 1)
+        details::shrink_list(time_signatures);
+    if (!(exposed & KEY_SIGNATURES) && own_refs(key_signatures) == 1)
+        details::shrink_list(key_signatures);
+    if (!(exposed & TEMPOS) && own_refs(tempos) == 1) details::shrink_list(tempos);
+    if (!(exposed & MARKERS) && own_refs(markers) == 1) details::shrink_list(markers);
+}
+
+template<TType T>
+Score<T> Score<T>::cow_copy() const {
+    auto new_tracks = std::make_shared<vec<shared<Track<T>>>>();
+    new_tracks->reserve(tracks->size());
+    for (const auto& track : *tracks) {
+        new_tracks->push_back(std::make_shared<Track<T>>(std::move(track->cow_copy())));
+    }
+    Score ans{
+        ticks_per_quarter, std::move(new_tracks), time_signatures, key_signatures, tempos, markers
+    };
+    ans.time_sorted     = time_sorted & ~exposed;
+    ans.tempo_map_cache = tempo_map_cache;
+    ans.beat_grid_cache = beat_grid_cache;
+    // exposed lists could be modified from outside without notice, so they are never shared
+    ans.detach(exposed);
+    return ans;
+}
+
+template<TType T>
+void Score<T>::detach(const u8 kinds) {
+    const u8 todo = kinds & ~exposed;
+    // a shared block is copied as a whole, see Track::detach
+    if (const u8 block = pooled(); (todo & block) && block_shared(block)) {
+        if (block == ALL) {
+            alloc_lists(std::make_shared<details::ScoreLists<T>>(
+                time_signatures->deepcopy(),
+                key_signatures->deepcopy(),
+                tempos->deepcopy(),
+                markers->deepcopy()
+            ));
+        } else {
+            unpool();
+        }
+    }
+    if (todo & TIME_SIGNATURES) details::detach_list(time_signatures, own_refs(time_signatures));
+    if (todo & KEY_SIGNATURES) details::detach_list(key_signatures, own_refs(key_signatures));
+    if (todo & TEMPOS) details::detach_list(tempos, own_refs(tempos));
+    if (todo & MARKERS) details::detach_list(markers, own_refs(markers));
+}
+
+template<TType T>
+void Score<T>::expose(const u8 kinds) {
+    unpool();
+    detach(kinds);
+    exposed |= kinds;
+}
+
+template<TType T>
+u8 Score<T>::pooled() const {
+    u8 ans = 0;
+    if (own_refs(time_signatures) > 1) ans |= TIME_SIGNATURES;
+    if (own_refs(key_signatures) > 1) ans |= KEY_SIGNATURES;
+    if (own_refs(tempos) > 1) ans |= TEMPOS;
+    if (own_refs(markers) > 1) ans |= MARKERS;
+    return ans;
+}
+
+template<TType T>
+bool Score<T>::block_shared(const u8 pooled) const {
+    // all the pooled lists are in one block, so any of them tells
+    if (pooled & TIME_SIGNATURES) return time_signatures.use_count() > own_refs(time_signatures);
+    if (pooled & KEY_SIGNATURES) return key_signatures.use_count() > own_refs(key_signatures);
+    if (pooled & TEMPOS) return tempos.use_count() > own_refs(tempos);
+    return false;
+}
+
+template<TType T>
+void Score<T>::unpool() {
+    const u8 block = pooled();
+    if (!block) return;
+    const bool shared_block = block_shared(block);
+    if (block & TIME_SIGNATURES) details::leave_block(time_signatures, shared_block);
+    if (block & KEY_SIGNATURES) details::leave_block(key_signatures, shared_block);
+    if (block & TEMPOS) details::leave_block(tempos, shared_block);
+    if (block & MARKERS) details::leave_block(markers, shared_block);
+}
+
+template<TType T>
+void Score<T>::sort_inplace(const bool reverse, const ExecPolicy policy) {
+    detach();
 
-    for (auto& track : *tracks) track->sort_inplace(reverse);
+    details::for_each_track(*tracks, policy, [this, reverse](const size_t i) {
+        (*tracks)[i]->sort_inplace(reverse);
+    });
     auto key = [](const auto& event) { return event.default_key(); };
     time_signatures->sort(key, reverse);
     key_signatures->sort(key, reverse);
     tempos->sort(key, reverse);
     // lyrics->sort(key, reverse);
     markers->sort(key, reverse);
+    // default_key starts with time
+    time_sorted = reverse ? 0 : ALL;
 }
 
 template<TType T>
-Score<T> Score<T>::sort(const bool reverse) const {
-    auto ans = deepcopy();
-    ans.sort_inplace(reverse);
+Score<T> Score<T>::sort(const bool reverse, const ExecPolicy policy) const {
+    auto ans = cow_copy();
+    ans.sort_inplace(reverse, policy);
     return ans;
 }
 
 template<TType T>
-void Score<T>::clip_inplace(unit start, unit end, bool clip_end) {
-    for (auto& track : *tracks) track->clip_inplace(start, end, clip_end);
-    ops::clip_with_sentinel_inplace(*time_signatures, start, end);
-    ops::clip_with_sentinel_inplace(*key_signatures, start, end);
-    ops::clip_with_sentinel_inplace(*tempos, start, end);
+void Score<T>::clip_inplace(unit start, unit end, bool clip_end, const ExecPolicy policy) {
+    detach();
+    details::for_each_track(*tracks, policy, [&](const size_t i) {
+        (*tracks)[i]->clip_inplace(start, end, clip_end);
+    });
+    ops::clip_with_sentinel_inplace(
+        *time_signatures, start, end, is_time_sorted(TIME_SIGNATURES)
+    );
+    ops::clip_with_sentinel_inplace(*key_signatures, start, end, is_time_sorted(KEY_SIGNATURES));
+    ops::clip_with_sentinel_inplace(*tempos, start, end, is_time_sorted(TEMPOS));
     // ops::clip_inplace(*lyrics, start, end);
-    ops::clip_inplace(*markers, start, end);
+    ops::clip_inplace(*markers, start, end, false, is_time_sorted(MARKERS));
 }
 
 
 template<TType T>
-Score<T> Score<T>::clip(unit start, unit end, bool clip_end) const {
-    auto ans = deepcopy();
-    ans.clip_inplace(start, end, clip_end);
+Score<T> Score<T>::clip(unit start, unit end, bool clip_end, const ExecPolicy policy) const {
+    // only the kept events are copied, instead of copying all and then filtering
+    Score ans{
+        ticks_per_quarter,
+        std::make_shared<vec<shared<Track<T>>>>(),
+        ops::clip_with_sentinel_copy(*time_signatures, start, end, is_time_sorted(TIME_SIGNATURES)),
+        ops::clip_with_sentinel_copy(*key_signatures, start, end, is_time_sorted(KEY_SIGNATURES)),
+        ops::clip_with_sentinel_copy(*tempos, start, end, is_time_sorted(TEMPOS)),
+        ops::clip_copy(*markers, start, end, false, is_time_sorted(MARKERS))
+    };
+    ans.tracks->resize(tracks->size());
+    details::for_each_track(*tracks, policy, [&](const size_t i) {
+        (*ans.tracks)[i] = std::make_shared<Track<T>>((*tracks)[i]->clip(start, end, clip_end));
+    });
+    ans.time_sorted = time_sorted & ~exposed;
     return ans;
 }
 
 // time shift
 template<TType T>
-void Score<T>::shift_time_inplace(const unit offset) {
-    for (auto& track : *tracks) track->shift_time_inplace(offset);
-    for (auto& time_signature : *time_signatures) time_signature->shift_time_inplace(offset);
-    for (auto& key_signature : *key_signatures) key_signature->shift_time_inplace(offset);
-    for (auto& tempo : *tempos) tempo->shift_time_inplace(offset);
-    // for (auto& lyric : *lyrics) lyric->shift_time_inplace(offset);
-    for (auto& marker : *markers) marker->shift_time_inplace(offset);
+void Score<T>::shift_time_inplace(const unit offset, const ExecPolicy policy) {
+    if (offset == 0) return;
+    detach();
+    details::for_each_track(*tracks, policy, [this, offset](const size_t i) {
+        (*tracks)[i]->shift_time_inplace(offset);
+    });
+    ops::shift_time_inplace(*time_signatures, offset);
+    ops::shift_time_inplace(*key_signatures, offset);
+    ops::shift_time_inplace(*tempos, offset);
+    // ops::shift_time_inplace(*lyrics, offset);
+    ops::shift_time_inplace(*markers, offset);
 }
 
 template<TType T>
-Score<T> Score<T>::shift_time(const unit offset) const {
-    auto ans = deepcopy();
-    ans.shift_time_inplace(offset);
+Score<T> Score<T>::shift_time(const unit offset, const ExecPolicy policy) const {
+    auto ans = cow_copy();
+    ans.shift_time_inplace(offset, policy);
     return ans;
 }
 
+namespace {
+// check the notes of all the tracks before any of them is shifted,
+// so that a range_error leaves the score unchanged
+template<TType T>
+void check_shift_tracks(
+    const vec<shared<Track<T>>>& tracks, const i8 pitch, const i8 velocity, const ExecPolicy policy
+) {
+    details::for_each_track(tracks, policy, [&](const size_t i) {
+        ops::details::check_shift<&Note<T>::pitch>(*tracks[i]->notes, pitch, "pitch");
+        ops::details::check_shift<&Note<T>::velocity>(*tracks[i]->notes, velocity, "velocity");
+    });
+}
+}   // namespace
+
 // pitch shift
 template<TType T>
-void Score<T>::shift_pitch_inplace(const i8 offset) {
-    for (auto& track : *tracks) track->shift_pitch_inplace(offset);
+void Score<T>::shift_pitch_inplace(const i8 offset, const bool saturate, const ExecPolicy policy) {
+    if (!saturate) check_shift_tracks(*tracks, offset, 0, policy);
+    details::for_each_track(*tracks, policy, [this, offset, saturate](const size_t i) {
+        (*tracks)[i]->shift_pitch_inplace(offset, saturate);
+    });
 }
 
 template<TType T>
-Score<T> Score<T>::shift_pitch(const i8 offset) const {
-    auto ans = deepcopy();
-    ans.shift_pitch_inplace(offset);
+Score<T> Score<T>::shift_pitch(const i8 offset, const bool saturate, const ExecPolicy policy)
+    const {
+    auto ans = cow_copy();
+    ans.shift_pitch_inplace(offset, saturate, policy);
     return ans;
 }
 
 // velocity shift
 template<TType T>
-void Score<T>::shift_velocity_inplace(const i8 offset) {
-    for (auto& track : *tracks) track->shift_velocity_inplace(offset);
+void Score<T>::shift_velocity_inplace(
+    const i8 offset, const bool saturate, const ExecPolicy policy
+) {
+    if (!saturate) check_shift_tracks(*tracks, 0, offset, policy);
+    details::for_each_track(*tracks, policy, [this, offset, saturate](const size_t i) {
+        (*tracks)[i]->shift_velocity_inplace(offset, saturate);
+    });
+}
+
+template<TType T>
+Score<T> Score<T>::shift_velocity(const i8 offset, const bool saturate, const ExecPolicy policy)
+    const {
+    auto ans = cow_copy();
+    ans.shift_velocity_inplace(offset, saturate, policy);
+    return ans;
+}
+
+// time, pitch and velocity shift in one pass
+template<TType T>
+void Score<T>::shift_inplace(
+    const unit time, const i8 pitch, const i8 velocity, const bool saturate, const ExecPolicy policy
+) {
+    if (!saturate) check_shift_tracks(*tracks, pitch, velocity, policy);
+    details::for_each_track(*tracks, policy, [&](const size_t i) {
+        (*tracks)[i]->shift_inplace(time, pitch, velocity, saturate);
+    });
+    if (time == 0) return;
+    detach();
+    ops::shift_time_inplace(*time_signatures, time);
+    ops::shift_time_inplace(*key_signatures, time);
+    ops::shift_time_inplace(*tempos, time);
+    // ops::shift_time_inplace(*lyrics, time);
+    ops::shift_time_inplace(*markers, time);
+}
+
+template<TType T>
+Score<T> Score<T>::shift(
+    const unit time, const i8 pitch, const i8 velocity, const bool saturate, const ExecPolicy policy
+) const {
+    auto ans = cow_copy();
+    ans.shift_inplace(time, pitch, velocity, saturate, policy);
+    return ans;
+}
+
+template<TType T>
+void Score<T>::apply_sustain_inplace() {
+    for (auto& track : *tracks) track->apply_sustain_inplace();
+}
+
+template<TType T>
+Score<T> Score<T>::apply_sustain() const {
+    auto ans = cow_copy();
+    ans.apply_sustain_inplace();
+    return ans;
+}
+
+template<TType T>
+OverlapStats Score<T>::dedup_notes_inplace() {
+    OverlapStats ans;
+    for (auto& track : *tracks) ans += track->dedup_notes_inplace();
+    return ans;
+}
+
+template<TType T>
+Score<T> Score<T>::dedup_notes() const {
+    auto ans = cow_copy();
+    ans.dedup_notes_inplace();
+    return ans;
+}
+
+template<TType T>
+OverlapStats Score<T>::resolve_overlaps_inplace(const OverlapPolicy policy) {
+    OverlapStats ans;
+    for (auto& track : *tracks) ans += track->resolve_overlaps_inplace(policy);
+    return ans;
 }
 
 template<TType T>
-Score<T> Score<T>::shift_velocity(const i8 offset) const {
-    auto ans = deepcopy();
-    ans.shift_velocity_inplace(offset);
+Score<T> Score<T>::resolve_overlaps(const OverlapPolicy policy) const {
+    auto ans = cow_copy();
+    ans.resolve_overlaps_inplace(policy);
     return ans;
 }
 
@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "MetaMacro.h"
+#include "symusic/segment.h"
+#include "symusic/beat_grid.h"
+#include "symusic/tempo_map.h"
+
+namespace symusic::ops {
+
+namespace details {
+
+template<typename unit>
+struct Window {
+    unit lo;
+    unit hi;
+};
+
+template<typename unit>
+unit to_unit(const f64 x) {
+    if constexpr (std::is_integral_v<unit>) {
+        return static_cast<unit>(std::llround(x));
+    } else {
+        return static_cast<unit>(x);
+    }
+}
+
+// call f with the list sorted by time, a sorted copy is made only if it's not sorted
+template<TimeEvent E, typename F>
+auto with_sorted(const pyvec<E>& events, const bool sorted, F&& f) {
+    if (sorted || events.is_sorted([](const E& event) { return event.time; })) return f(events);
+    auto copy = events.collect();
+    std::stable_sort(copy.begin(), copy.end(), [](const E& a, const E& b) {
+        return a.time < b.time;
+    });
+    return f(pyvec<E>(std::move(copy)));
+}
+
+// the events starting in each window, walking the sorted events once with two cursors
+template<TimeEvent E>
+vec<pyvec<E>> split_windows(
+    const pyvec<E>&                      events,
+    const vec<Window<typename E::unit>>& windows,
+    const bool                           truncate,
+    const bool                           shift
+) {
+    vec<pyvec<E>> ans;
+    ans.reserve(windows.size());
+    const auto   begin = events.cbegin();
+    const size_t n     = events.size();
+    size_t       first = 0, last = 0;
+    for (const auto& [lo, hi] : windows) {
+        while (first < n && begin[first].time < lo) ++first;
+        last = std::max(last, first);
+        while (last < n && begin[last].time < hi) ++last;
+        vec<E> part(begin + static_cast<ptrdiff_t>(first), begin + static_cast<ptrdiff_t>(last));
+        for (auto& event : part) {
+            if constexpr (HashDuration<E>) {
+                if (truncate && event.end() > hi) event.duration = hi - event.time;
+            }
+            if (shift) event.time -= lo;
+        }
+        ans.emplace_back(std::move(part));
+    }
+    return ans;
+}
+
+// the same as split_windows, with the sentinel of clip_with_sentinel: the first one of the
+// latest events at or before the start of the window is moved to the start
+template<TimeEvent E>
+vec<pyvec<E>> split_windows_with_sentinel(
+    const pyvec<E>& events, const vec<Window<typename E::unit>>& windows, const bool shift
+) {
+    vec<pyvec<E>> ans;
+    ans.reserve(windows.size());
+    const auto   begin = events.cbegin();
+    const size_t n     = events.size();
+    size_t       first = 0, last = 0, latest = 0;   // latest is the start of the group before first
+    for (const auto& [lo, hi] : windows) {
+        while (first < n && begin[first].time <= lo) {
+            if (first == 0 || begin[first].time != begin[first - 1].time) latest = first;
+            ++first;
+        }
+        last = std::max(last, first);
+        while (last < n && begin[last].time < hi) ++last;
+        vec<E> part;
+        part.reserve(last - first + 1);
+        if (first > 0) {
+            part.push_back(begin[latest]);
+            part.back().time = lo;
+        }
+        part.insert(part.end(), begin + static_cast<ptrdiff_t>(first), begin + static_cast<ptrdiff_t>(last));
+        if (shift) {
+            for (auto& event : part) event.time -= lo;
+        }
+        ans.emplace_back(std::move(part));
+    }
+    return ans;
+}
+
+template<TType T>
+vec<Window<typename T::unit>> make_windows(
+    const Score<T>& score, const f64 window, const f64 stride, const SegmentUnit unit
+) {
+    using unit_t = typename T::unit;
+    if (!(window > 0) || !(stride > 0)) {
+        throw std::invalid_argument(
+            "symusic::segment: window and stride should be positive, got " + std::to_string(window)
+            + " and " + std::to_string(stride)
+        );
+    }
+    vec<Window<unit_t>> ans;
+    if (score.empty()) return ans;
+    const unit_t end = score.end();
+    if (unit == SegmentUnit::TIME || (unit == SegmentUnit::SECOND && std::is_same_v<T, Second>)) {
+        for (size_t k = 0;; ++k) {
+            const f64 lo = static_cast<f64>(k) * stride;
+            if (to_unit<unit_t>(lo) >= end) break;
+            ans.push_back({to_unit<unit_t>(lo), to_unit<unit_t>(lo + window)});
+        }
+    } else if (unit == SegmentUnit::SECOND) {
+        const auto map   = score.tempo_map();
+        const f64  total = map->template convert<T, Second>(end);
+        for (size_t k = 0; static_cast<f64>(k) * stride < total; ++k) {
+            const f64 lo = static_cast<f64>(k) * stride;
+            ans.push_back({
+                map->template convert<Second, T>(static_cast<Second::unit>(lo)),
+                map->template convert<Second, T>(static_cast<Second::unit>(lo + window)),
+            });
+        }
+    } else {
+        if (window != std::floor(window) || stride != std::floor(stride)) {
+            throw std::invalid_argument(
+                "symusic::segment: window and stride should be whole numbers of bars"
+            );
+        }
+        const auto grid = score.beat_grid(end);
+        const auto w    = static_cast<i64>(window);
+        const auto s    = static_cast<i64>(stride);
+        for (i64 k = 0;; k += s) {
+            const unit_t lo = grid->downbeat(k);
+            if (lo >= end) break;
+            ans.push_back({lo, grid->downbeat(k + w)});
+        }
+    }
+    return ans;
+}
+
+}   // namespace details
+
+template<TType T>
+vec<Score<T>> segment(
+    const Score<T>&   score,
+    const f64         window,
+    const f64         stride,
+    const SegmentUnit unit,
+    const bool        truncate_notes,
+    const bool        shift
+) {
+    const auto windows = details::make_windows(score, window, stride, unit);
+    const auto num     = windows.size();
+
+    auto split = [&](const auto& events, const bool sorted, const bool truncate) {
+        return details::with_sorted(events, sorted, [&](const auto& list) {
+            return details::split_windows(list, windows, truncate, shift);
+        });
+    };
+    auto split_with_sentinel = [&](const auto& events, const bool sorted) {
+        return details::with_sorted(events, sorted, [&](const auto& list) {
+            return details::split_windows_with_sentinel(list, windows, shift);
+        });
+    };
+
+    auto time_signatures = split_with_sentinel(*score.time_signatures, score.is_time_sorted(Score<T>::TIME_SIGNATURES));
+    auto key_signatures  = split_with_sentinel(*score.key_signatures, score.is_time_sorted(Score<T>::KEY_SIGNATURES));
+    auto tempos          = split_with_sentinel(*score.tempos, score.is_time_sorted(Score<T>::TEMPOS));
+    auto markers         = split(*score.markers, score.is_time_sorted(Score<T>::MARKERS), false);
+
+    vec<Score<T>> ans;
+    ans.reserve(num);
+    for (size_t k = 0; k < num; ++k) {
+        auto tracks = std::make_shared<vec<shared<Track<T>>>>();
+        tracks->reserve(score.tracks->size());
+        ans.emplace_back(
+            score.ticks_per_quarter,
+            std::move(tracks),
+            std::move(time_signatures[k]),
+            std::move(key_signatures[k]),
+            std::move(tempos[k]),
+            std::move(markers[k])
+        );
+        ans.back().time_sorted = Score<T>::ALL;
+    }
+    for (const auto& track : *score.tracks) {
+        auto notes       = split(*track->notes, track->is_time_sorted(Track<T>::NOTES), truncate_notes);
+        auto controls    = split(*track->controls, track->is_time_sorted(Track<T>::CONTROLS), false);
+        auto pitch_bends = split(*track->pitch_bends, track->is_time_sorted(Track<T>::PITCH_BENDS), false);
+        auto pedals      = split(*track->pedals, track->is_time_sorted(Track<T>::PEDALS), truncate_notes);
+        auto lyrics      = split(*track->lyrics, track->is_time_sorted(Track<T>::LYRICS), false);
+        for (size_t k = 0; k < num; ++k) {
+            auto part = std::make_shared<Track<T>>(
+                track->name,
+                track->program,
+                track->is_drum,
+                std::move(notes[k]),
+                std::move(controls[k]),
+                std::move(pitch_bends[k]),
+                std::move(pedals[k]),
+                std::move(lyrics[k])
+            );
+            part->time_sorted = Track<T>::ALL;
+            ans[k].tracks->push_back(std::move(part));
+        }
+    }
+    return ans;
+}
+
+#define INSTANTIATE_SEGMENT(__COUNT, T)                                                       \
+    template vec<Score<T>> segment(                                                          \
+        const Score<T>& score, f64 window, f64 stride, SegmentUnit unit, bool truncate_notes, \
+        bool shift                                                                           \
+    );
+
+REPEAT_ON(INSTANTIATE_SEGMENT, Tick, Quarter, Second)
+
+#undef INSTANTIATE_SEGMENT
+
+}   // namespace symusic::ops
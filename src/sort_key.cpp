@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+#include "pdqsort.h"
+#include "MetaMacro.h"
+#include "symusic/sort_key.h"
+
+namespace symusic {
+
+namespace details {
+
+// number of bits of the order preserving integer form of a field
+template<typename V>
+constexpr u8 key_bits() {
+    if constexpr (std::is_same_v<V, bool>) {
+        return 1;
+    } else {
+        return sizeof(V) * 8;
+    }
+}
+
+// map a value to an unsigned integer of key_bits<V>() bits with the same order
+template<typename V>
+u64 key_ordinal(const V x) {
+    if constexpr (std::is_same_v<V, bool>) {
+        return x;
+    } else if constexpr (std::is_floating_point_v<V>) {
+        using U      = std::conditional_t<sizeof(V) == 4, u32, u64>;
+        constexpr U sign = U{1} << (sizeof(V) * 8 - 1);
+        const U     bits = std::bit_cast<U>(x);
+        return (bits & sign) ? ~bits : bits ^ sign;
+    } else if constexpr (std::is_signed_v<V>) {
+        using U = std::make_unsigned_t<V>;
+        return static_cast<U>(static_cast<U>(x) ^ (U{1} << (sizeof(V) * 8 - 1)));
+    } else {
+        return x;
+    }
+}
+
+template<typename T>
+const auto& sort_deref(const T& item) {
+    return item;
+}
+
+template<typename T>
+const auto& sort_deref(const shared<T>& item) {
+    return *item;
+}
+
+// stable LSD radix sort of (key, index) pairs by key, a byte per pass from the lowest one.
+// The byte histograms don't depend on the order, so they are all counted in one pass first,
+// and the bytes that are equal in all the keys are skipped.
+inline void radix_sort_pairs(vec<std::pair<u64, u32>>& pairs, vec<std::pair<u64, u32>>& buffer) {
+    const size_t n = pairs.size();
+    if (n < 2) return;
+    std::array<std::array<size_t, 256>, 8> counts{};
+    for (const auto& [key, _] : pairs) {
+        for (size_t b = 0; b < 8; ++b) ++counts[b][(key >> (8 * b)) & 0xFF];
+    }
+    buffer.resize(n);
+    for (size_t b = 0; b < 8; ++b) {
+        auto& count = counts[b];
+        if (count[(pairs.front().first >> (8 * b)) & 0xFF] == n) continue;
+        size_t offset = 0;
+        for (auto& c : count) offset += std::exchange(c, offset);
+        for (const auto& pair : pairs) buffer[count[(pair.first >> (8 * b)) & 0xFF]++] = pair;
+        pairs.swap(buffer);
+    }
+}
+
+}   // namespace details
+
+template<typename E>
+SortKey<E>::SortKey(const vec<std::string>& keys) {
+    if (keys.empty()) throw std::invalid_argument("symusic::SortKey: no key is given");
+    u8 used = 64;   // bits used in the current word, a new word is started at the first key
+    for (const auto& key : keys) {
+        std::string_view name       = key;
+        bool             descending = false;
+        if (!name.empty() && (name.front() == '-' || name.front() == '+')) {
+            descending = name.front() == '-';
+            name.remove_prefix(1);
+        }
+        const auto field = static_cast<u8>(Fields<E>::index(name));
+        const u8   bits  = Fields<E>::visit(field, [](auto getter) {
+            return details::key_bits<std::invoke_result_t<decltype(getter), const E&>>();
+        });
+        if (used + bits > 64) {
+            ++word_num;
+            used = 0;
+        }
+        used += bits;
+        // earlier keys take the higher bits, so they are compared first
+        parts.push_back({field, static_cast<u8>(word_num - 1), static_cast<u8>(64 - used), descending});
+    }
+    if (word_num > max_words) {
+        throw std::invalid_argument(
+            "symusic::SortKey: the keys need " + std::to_string(word_num * 64)
+            + " bits, more than the supported " + std::to_string(max_words * 64)
+        );
+    }
+}
+
+template<typename E>
+std::array<u64, SortKey<E>::max_words> SortKey<E>::pack(const E& item) const {
+    std::array<u64, max_words> ans{};
+    for (const auto& part : parts) {
+        Fields<E>::visit(part.field, [&](auto getter) {
+            using V             = std::invoke_result_t<decltype(getter), const E&>;
+            constexpr u8  bits  = details::key_bits<V>();
+            constexpr u64 mask  = bits == 64 ? ~u64{0} : (u64{1} << bits) - 1;
+            const u64     ord   = details::key_ordinal(getter(item));
+            ans[part.word]     |= (part.descending ? ~ord & mask : ord) << part.shift;
+        });
+    }
+    return ans;
+}
+
+template<typename E>
+vec<u64> SortKey<E>::pack_all(const container& items, const bool reverse) const {
+    const size_t n = items.size();
+    vec<u64>     keys(n * word_num, 0);
+    for (const auto& part : parts) {
+        // reverse is done by flipping every key, so that ties keep their original order
+        const bool descending = part.descending != reverse;
+        Fields<E>::visit(part.field, [&](auto getter) {
+            using V            = std::invoke_result_t<decltype(getter), const E&>;
+            constexpr u8  bits = details::key_bits<V>();
+            constexpr u64 mask = bits == 64 ? ~u64{0} : (u64{1} << bits) - 1;
+            u64*          out  = keys.data() + part.word;
+            for (size_t i = 0; i < n; ++i) {
+                const u64 ord = details::key_ordinal(getter(details::sort_deref(items[i])));
+                out[i * word_num] |= (descending ? ~ord & mask : ord) << part.shift;
+            }
+        });
+    }
+    return keys;
+}
+
+template<typename E>
+vec<u32> SortKey<E>::argsort(const container& items, const bool reverse) const {
+    const size_t n = items.size();
+    if (n > std::numeric_limits<u32>::max()) {
+        throw std::overflow_error("symusic::SortKey: too many items to argsort");
+    }
+    const auto keys = pack_all(items, reverse);
+    vec<u32>   ans(n);
+    if (n >= radix_threshold) {
+        // from the least significant word, each pass is stable, so the ties are in index order
+        std::iota(ans.begin(), ans.end(), 0);
+        vec<std::pair<u64, u32>> pairs(n), buffer;
+        for (size_t w = word_num; w-- > 0;) {
+            for (size_t i = 0; i < n; ++i) pairs[i] = {keys[ans[i] * word_num + w], ans[i]};
+            details::radix_sort_pairs(pairs, buffer);
+            for (size_t i = 0; i < n; ++i) ans[i] = pairs[i].second;
+        }
+        return ans;
+    }
+    if (word_num == 1) {
+        // sort (key, index) pairs, the index breaks ties so the result is stable
+        vec<std::pair<u64, u32>> pairs(n);
+        for (u32 i = 0; i < n; ++i) pairs[i] = {keys[i], i};
+        pdqsort_branchless(pairs.begin(), pairs.end());
+        for (size_t i = 0; i < n; ++i) ans[i] = pairs[i].second;
+        return ans;
+    }
+    std::iota(ans.begin(), ans.end(), 0);
+    const size_t w = word_num;
+    pdqsort(ans.begin(), ans.end(), [&keys, w](const u32 a, const u32 b) {
+        const u64* ka = keys.data() + a * w;
+        const u64* kb = keys.data() + b * w;
+        for (size_t i = 0; i < w; ++i) {
+            if (ka[i] != kb[i]) return ka[i] < kb[i];
+        }
+        return a < b;
+    });
+    return ans;
+}
+
+template<typename E>
+void SortKey<E>::sort_inplace(container& items, const bool reverse) const {
+    if constexpr (std::is_same_v<container, pyvec<E>>) {
+        // sort the element pointers in place, so that the elements keep their identities
+        items.sort([this](const E& item) { return pack(item); }, reverse);
+    } else {
+        const auto order = argsort(items, reverse);
+        container  ans;
+        ans.reserve(items.size());
+        for (const u32 i : order) ans.push_back(std::move(items[i]));
+        items = std::move(ans);
+    }
+}
+
+template<typename E>
+void SortKey<E>::sort_rebuild(pyvec<E>& items, const bool reverse) const
+    requires(!std::is_same_v<container, vec<shared<E>>>)
+{
+    const auto order = argsort(items, reverse);
+    vec<E>     ans;
+    ans.reserve(items.size());
+    for (const u32 i : order) ans.push_back(std::move(items[i]));
+    items = pyvec<E>(std::move(ans));
+}
+
+namespace details {
+// field names of default_key() in event.h, in the same order
+template<TimeEvent E>
+std::span<const std::string_view> default_key_fields() {
+    using T = typename E::ttype;
+    if constexpr (std::is_same_v<E, Note<T>>) {
+        static constexpr std::array<std::string_view, 4> keys{"time", "duration", "pitch", "velocity"};
+        return keys;
+    } else if constexpr (std::is_same_v<E, Pedal<T>>) {
+        static constexpr std::array<std::string_view, 2> keys{"time", "duration"};
+        return keys;
+    } else if constexpr (std::is_same_v<E, ControlChange<T>>) {
+        static constexpr std::array<std::string_view, 3> keys{"time", "number", "value"};
+        return keys;
+    } else {
+        static constexpr std::array<std::string_view, 1> keys{"time"};
+        return keys;
+    }
+}
+}   // namespace details
+
+template<TimeEvent E>
+const SortKey<E>& default_sort_key() {
+    static const SortKey<E> ans{[] {
+        const auto fields = details::default_key_fields<E>();
+        return vec<std::string>(fields.begin(), fields.end());
+    }()};
+    return ans;
+}
+
+template<typename E>
+bool SortKey<E>::is_sorted(const container& items, const bool reverse) const {
+    if constexpr (std::is_same_v<container, pyvec<E>>) {
+        return items.is_sorted([this](const E& item) { return pack(item); }, reverse);
+    } else {
+        auto cmp = [this, reverse](const shared<E>& a, const shared<E>& b) {
+            return reverse ? pack(*b) < pack(*a) : pack(*a) < pack(*b);
+        };
+        return std::is_sorted(items.begin(), items.end(), cmp);
+    }
+}
+
+#define INSTANTIATE_EVENT_SORT_KEY(EVENT) \
+    template class SortKey<EVENT>;        \
+    template const SortKey<EVENT>& default_sort_key<EVENT>();
+
+#define INSTANTIATE_SORT_KEY(__COUNT, T)                \
+    INSTANTIATE_EVENT_SORT_KEY(Note<T>)                 \
+    INSTANTIATE_EVENT_SORT_KEY(Pedal<T>)                \
+    INSTANTIATE_EVENT_SORT_KEY(ControlChange<T>)        \
+    INSTANTIATE_EVENT_SORT_KEY(TimeSignature<T>)        \
+    INSTANTIATE_EVENT_SORT_KEY(KeySignature<T>)         \
+    INSTANTIATE_EVENT_SORT_KEY(Tempo<T>)                \
+    INSTANTIATE_EVENT_SORT_KEY(PitchBend<T>)            \
+    INSTANTIATE_EVENT_SORT_KEY(TextMeta<T>)             \
+    template class SortKey<Track<T>>;
+
+REPEAT_ON(INSTANTIATE_SORT_KEY, Tick, Quarter, Second)
+
+#undef INSTANTIATE_SORT_KEY
+#undef INSTANTIATE_EVENT_SORT_KEY
+
+}   // namespace symusic
@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "MetaMacro.h"
+#include "symusic/tempo_map.h"
+
+namespace symusic {
+
+template<TType T>
+TempoMap<T>::TempoMap(const pyvec<Tempo<T>>& tempos, const i32 ticks_per_quarter) :
+    tpq{ticks_per_quarter}, source(tempos.cbegin(), tempos.cend()) {
+    if (std::is_same_v<T, Tick> && tpq <= 0) {
+        throw std::invalid_argument(
+            "symusic::TempoMap: ticks_per_quarter should be positive, got " + std::to_string(tpq)
+        );
+    }
+    vec<Tempo<T>> sorted = source;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+        return a.time < b.time;
+    });
+    auto spq_of = [](const i32 mspq) { return static_cast<f64>(std::max(mspq, 1)) / 1e6; };
+
+    quarters.reserve(sorted.size() + 1);
+    seconds.reserve(sorted.size() + 1);
+    spq.reserve(sorted.size() + 1);
+    quarters.push_back(0);
+    seconds.push_back(0);
+    spq.push_back(spq_of(500000));
+    for (const auto& tempo : sorted) {
+        const auto time = static_cast<f64>(tempo.time);
+        f64        q, s;
+        if constexpr (std::is_same_v<T, Second>) {
+            s = time;
+            q = quarters.back() + (s - seconds.back()) / spq.back();
+        } else {
+            q = std::is_same_v<T, Tick> ? time / tpq : time;
+            s = seconds.back() + (q - quarters.back()) * spq.back();
+        }
+        // tempos at or before the last change (or 0) replace it
+        if (q <= quarters.back()) {
+            spq.back() = spq_of(tempo.mspq);
+            continue;
+        }
+        quarters.push_back(q);
+        seconds.push_back(s);
+        spq.push_back(spq_of(tempo.mspq));
+    }
+}
+
+template<TType T>
+bool TempoMap<T>::matches(const pyvec<Tempo<T>>& tempos, const i32 ticks_per_quarter) const {
+    if (ticks_per_quarter != tpq || tempos.size() != source.size()) return false;
+    auto it = source.begin();
+    for (const auto& tempo : tempos) {
+        if (tempo.time != it->time || tempo.mspq != it->mspq) return false;
+        ++it;
+    }
+    return true;
+}
+
+template<TType T>
+size_t TempoMap<T>::locate(const vec<f64>& pivots, const f64 x, size_t& hint) {
+    const size_t n = pivots.size();
+    if (pivots[hint] <= x && (hint + 1 == n || x < pivots[hint + 1])) return hint;
+    // sorted times usually move to the next tempo change
+    if (hint + 1 < n && pivots[hint + 1] <= x && (hint + 2 == n || x < pivots[hint + 2])) {
+        return ++hint;
+    }
+    const size_t i = std::upper_bound(pivots.begin(), pivots.end(), x) - pivots.begin();
+    // times before 0 follow the first tempo
+    hint = i == 0 ? 0 : i - 1;
+    return hint;
+}
+
+template<TType T>
+template<TType From>
+f64 TempoMap<T>::pivot_of(const typename From::unit time) const {
+    const auto t = static_cast<f64>(time);
+    if constexpr (std::is_same_v<From, Tick>) {
+        return t / tpq;
+    } else {
+        return t;
+    }
+}
+
+template<TType T>
+template<TType From, TType To>
+typename To::unit TempoMap<T>::convert_in(const typename From::unit time, const Segment& seg) {
+    const auto t = static_cast<f64>(time);
+    f64        q;
+    if constexpr (std::is_same_v<From, Tick>) {
+        q = t / seg.tpq;
+    } else if constexpr (std::is_same_v<From, Quarter>) {
+        q = t;
+    } else {
+        q = seg.quarters + (t - seg.seconds) / seg.spq;
+    }
+    if constexpr (std::is_same_v<To, Tick>) {
+        return static_cast<Tick::unit>(std::llround(q * seg.tpq));
+    } else if constexpr (std::is_same_v<To, Quarter>) {
+        return static_cast<Quarter::unit>(q);
+    } else {
+        return static_cast<Second::unit>(seg.seconds + (q - seg.quarters) * seg.spq);
+    }
+}
+
+template<TType T>
+template<TType From, TType To>
+typename To::unit TempoMap<T>::convert(const typename From::unit time, size_t& hint) const {
+    if constexpr (std::is_same_v<From, To>) {
+        return time;
+    } else if constexpr (!std::is_same_v<From, Second> && !std::is_same_v<To, Second>) {
+        // ticks and quarters don't depend on the tempos
+        return convert_in<From, To>(time, segment(0));
+    } else {
+        const vec<f64>& pivots = std::is_same_v<From, Second> ? seconds : quarters;
+        return convert_in<From, To>(time, segment(locate(pivots, pivot_of<From>(time), hint)));
+    }
+}
+
+template<TType T>
+template<TType From, TType To>
+void TempoMap<T>::convert_sorted(
+    const std::span<const typename From::unit> times, const std::span<typename To::unit> out
+) const {
+    auto run = [&times, &out](const size_t begin, const size_t end, const Segment seg) {
+        const typename From::unit* src = times.data();
+        typename To::unit*         dst = out.data();
+        for (size_t i = begin; i < end; ++i) dst[i] = convert_in<From, To>(src[i], seg);
+    };
+    if constexpr (std::is_same_v<From, To>) {
+        std::copy(times.begin(), times.end(), out.begin());
+    } else if constexpr (!std::is_same_v<From, Second> && !std::is_same_v<To, Second>) {
+        run(0, times.size(), segment(0));
+    } else {
+        const vec<f64>& pivots = std::is_same_v<From, Second> ? seconds : quarters;
+        // times before 0 follow the first tempo, so the first run starts from the beginning
+        size_t begin = 0;
+        for (size_t k = 0; begin < times.size(); ++k) {
+            size_t end = times.size();
+            if (k + 1 < pivots.size()) {
+                const f64 next = pivots[k + 1];
+                end = std::partition_point(
+                          times.begin() + static_cast<ptrdiff_t>(begin),
+                          times.end(),
+                          [this, next](const auto t) { return pivot_of<From>(t) < next; }
+                      )
+                      - times.begin();
+            }
+            run(begin, end, segment(k));
+            begin = end;
+        }
+    }
+}
+
+template<TType T>
+template<TType From, TType To>
+void TempoMap<T>::convert(
+    const std::span<const typename From::unit> times, const std::span<typename To::unit> out
+) const {
+    if (times.size() != out.size()) {
+        throw std::invalid_argument(
+            "symusic::TempoMap: times and out should have the same size, got "
+            + std::to_string(times.size()) + " and " + std::to_string(out.size())
+        );
+    }
+    if (std::is_sorted(times.begin(), times.end())) {
+        convert_sorted<From, To>(times, out);
+        return;
+    }
+    size_t hint = 0;
+    for (size_t i = 0; i < times.size(); ++i) out[i] = convert<From, To>(times[i], hint);
+}
+
+template<TType T>
+template<TType From, TType To>
+vec<typename To::unit> TempoMap<T>::convert(const std::span<const typename From::unit> times
+) const {
+    vec<typename To::unit> ans(times.size());
+    convert<From, To>(times, std::span<typename To::unit>(ans));
+    return ans;
+}
+
+#define INSTANTIATE_TEMPO_MAP_CONVERT(T, From, To)                                               \
+    template To::unit TempoMap<T>::convert<From, To>(From::unit time, size_t & hint) const;      \
+    template void     TempoMap<T>::convert<From, To>(                                            \
+        std::span<const From::unit> times, std::span<To::unit> out                           \
+    ) const;                                                                                     \
+    template vec<To::unit> TempoMap<T>::convert<From, To>(std::span<const From::unit> times) const;
+
+#define INSTANTIATE_TEMPO_MAP_FROM(T, From)              \
+    INSTANTIATE_TEMPO_MAP_CONVERT(T, From, Tick)         \
+    INSTANTIATE_TEMPO_MAP_CONVERT(T, From, Quarter)      \
+    INSTANTIATE_TEMPO_MAP_CONVERT(T, From, Second)
+
+#define INSTANTIATE_TEMPO_MAP(__COUNT, T)      \
+    template class TempoMap<T>;                \
+    INSTANTIATE_TEMPO_MAP_FROM(T, Tick)        \
+    INSTANTIATE_TEMPO_MAP_FROM(T, Quarter)     \
+    INSTANTIATE_TEMPO_MAP_FROM(T, Second)
+
+REPEAT_ON(INSTANTIATE_TEMPO_MAP, Tick, Quarter, Second)
+
+#undef INSTANTIATE_TEMPO_MAP
+#undef INSTANTIATE_TEMPO_MAP_FROM
+#undef INSTANTIATE_TEMPO_MAP_CONVERT
+
+}   // namespace symusic
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "MetaMacro.h"
+#include "symusic/time_warp.h"
+
+namespace symusic {
+
+template<TType T>
+TimeWarp<T>::TimeWarp(vec<unit> original_times, vec<unit> new_times) :
+    src{std::move(original_times)}, dst{std::move(new_times)} {
+    if (src.size() != dst.size()) {
+        throw std::invalid_argument(
+            "symusic::TimeWarp: original_times and new_times should have the same size"
+        );
+    }
+    if (src.size() < 2) {
+        throw std::invalid_argument(
+            "symusic::TimeWarp: original_times and new_times should have at least 2 elements"
+        );
+    }
+    if (!std::is_sorted(src.begin(), src.end())) {
+        throw std::invalid_argument("symusic::TimeWarp: original_times should be sorted");
+    }
+    if (!std::is_sorted(dst.begin(), dst.end())) {
+        throw std::invalid_argument("symusic::TimeWarp: new_times should be sorted");
+    }
+    slopes.resize(src.size());
+    for (size_t k = 1; k < src.size(); ++k) {
+        const auto len = static_cast<f64>(src[k] - src[k - 1]);
+        // an empty segment is only reached by a time equal to both of its ends
+        slopes[k] = len == 0 ? 0 : static_cast<f64>(dst[k] - dst[k - 1]) / len;
+    }
+}
+
+template<TType T>
+size_t TimeWarp<T>::locate(const unit time, const size_t hint) const {
+    const auto begin = src.begin();
+    if (src[hint] < time) {
+        // gallop forward until src[hi] >= time, which holds at the last anchor
+        size_t lo = hint, step = 1;
+        while (lo + step < src.size() - 1 && src[lo + step] < time) {
+            lo += step;
+            step <<= 1;
+        }
+        const size_t hi = std::min(lo + step, src.size() - 1);
+        return std::lower_bound(begin + lo + 1, begin + hi, time) - begin;
+    }
+    if (hint == 1 || src[hint - 1] < time) return hint;
+    // gallop backward until src[lo] < time, or lo reaches the first segment
+    size_t hi = hint - 1, step = 1;
+    while (hi > step && src[hi - step] >= time) {
+        hi -= step;
+        step <<= 1;
+    }
+    const size_t lo = hi > step ? hi - step + 1 : 1;
+    return std::lower_bound(begin + lo, begin + hi, time) - begin;
+}
+
+template<TType T>
+typename T::unit TimeWarp<T>::operator()(const unit time) const {
+    if (time < src.front() || time > src.back()) {
+        throw std::out_of_range(
+            "symusic::TimeWarp: time " + std::to_string(time) + " is out of ["
+            + std::to_string(src.front()) + ", " + std::to_string(src.back()) + "]"
+        );
+    }
+    return map(time, locate(time, 1));
+}
+
+template<TType T>
+template<TimeEvent E>
+void TimeWarp<T>::apply_inplace(pyvec<E>& events) const {
+    const unit first = src.front();
+    const unit last  = src.back();
+    size_t     k     = 1;   // segment of the previous event
+    size_t     i     = 0;
+    for (size_t j = 0; j < events.size(); ++j) {
+        E& event = events[j];
+        if constexpr (HashDuration<E>) {
+            const unit end = event.end();
+            if (event.time < first || end > last) continue;
+            k                    = locate(event.time, k);
+            const unit new_start = map(event.time, k);
+            // the end is never before the start, so only gallop forward from there
+            event.duration = map(end, locate(end, k)) - new_start;
+            event.time     = new_start;
+        } else {
+            if (event.time < first || event.time > last) continue;
+            k          = locate(event.time, k);
+            event.time = map(event.time, k);
+        }
+        *(events.pbegin() + i) = *(events.pbegin() + j);
+        ++i;
+    }
+    events.resize(i);
+}
+
+template<TType T>
+void TimeWarp<T>::apply_inplace(Track<T>& track) const {
+    track.detach();
+    // the map is monotone, so time_sorted is kept
+    apply_inplace(*track.notes);
+    apply_inplace(*track.controls);
+    apply_inplace(*track.pitch_bends);
+    apply_inplace(*track.pedals);
+    apply_inplace(*track.lyrics);
+}
+
+template<TType T>
+void TimeWarp<T>::apply_inplace(Score<T>& score, const ExecPolicy policy) const {
+    details::for_each_track(*score.tracks, policy, [this, &score](const size_t i) {
+        apply_inplace(*(*score.tracks)[i]);
+    });
+    score.detach();
+    apply_inplace(*score.time_signatures);
+    apply_inplace(*score.key_signatures);
+    apply_inplace(*score.tempos);
+    // apply_inplace(*score.lyrics);
+    apply_inplace(*score.markers);
+}
+
+template<TType T>
+void TimeWarp<T>::apply_inplace(const vec<shared<Track<T>>>& tracks) const {
+    for (const auto& track : tracks) apply_inplace(*track);
+}
+
+template<TType T>
+void TimeWarp<T>::apply_inplace(const vec<shared<Score<T>>>& scores) const {
+    for (const auto& score : scores) apply_inplace(*score);
+}
+
+template<TType T>
+Track<T> TimeWarp<T>::apply(const Track<T>& track) const {
+    Track<T> ans = track.cow_copy();
+    apply_inplace(ans);
+    return ans;
+}
+
+template<TType T>
+Score<T> TimeWarp<T>::apply(const Score<T>& score, const ExecPolicy policy) const {
+    Score<T> ans = score.cow_copy();
+    apply_inplace(ans, policy);
+    return ans;
+}
+
+#define INSTANTIATE_TIME_WARP_LIST(T, EVENT) \
+    template void TimeWarp<T>::apply_inplace(pyvec<EVENT<T>>& events) const;
+
+#define INSTANTIATE_TIME_WARP(__COUNT, T)                 \
+    template class TimeWarp<T>;                           \
+    INSTANTIATE_TIME_WARP_LIST(T, Note)                   \
+    INSTANTIATE_TIME_WARP_LIST(T, Pedal)                  \
+    INSTANTIATE_TIME_WARP_LIST(T, ControlChange)          \
+    INSTANTIATE_TIME_WARP_LIST(T, TimeSignature)          \
+    INSTANTIATE_TIME_WARP_LIST(T, KeySignature)           \
+    INSTANTIATE_TIME_WARP_LIST(T, Tempo)                  \
+    INSTANTIATE_TIME_WARP_LIST(T, PitchBend)              \
+    INSTANTIATE_TIME_WARP_LIST(T, TextMeta)
+
+REPEAT_ON(INSTANTIATE_TIME_WARP, Tick, Quarter, Second)
+
+#undef INSTANTIATE_TIME_WARP
+#undef INSTANTIATE_TIME_WARP_LIST
+
+}   // namespace symusic
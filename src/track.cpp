@@ -3,10 +3,34 @@
 //
 #include "symusic/track.h"
 #include "symusic/ops.h"
+#include "symusic/sort_key.h"
 #include "MetaMacro.h"
 
 namespace symusic {
 
+namespace details {
+// sort by default_key. Large lists that python holds no reference to are radix sorted and
+// rebuilt, and the others are sorted in place so that the elements keep their identities
+template<TimeEvent E>
+void sort_list(pyvec<E>& events, const bool reverse, const bool exposed) {
+    if (!exposed && events.size() >= SortKey<E>::radix_threshold) {
+        default_sort_key<E>().sort_rebuild(events, reverse);
+    } else {
+        events.sort([](const E& event) { return event.default_key(); }, reverse);
+    }
+}
+
+// remove the notes whose mask is 0, keeping the order of the others
+template<TType T>
+size_t remove_notes(pyvec<Note<T>>& notes, const vec<u8>& keep) {
+    const size_t before = notes.size();
+    // filter visits the notes in order
+    size_t i = 0;
+    notes.filter([&](const Note<T>&) { return keep[i++] != 0; });
+    return before - notes.size();
+}
+}   // namespace details
+
 // extern to_string and summary
 #define EXTERN_REPR(__COUNT, T) \
     extern template std::string Track<T>::to_string() const; \
@@ -19,11 +43,11 @@ template<TType T>
 typename T::unit Track<T>::start() const {
     if(this->empty()) return 0;
     typename T::unit ans = std::numeric_limits<typename T::unit>::max();
-    ans = std::min(ans, ops::start(*notes));
-    ans = std::min(ans, ops::start(*controls));
-    ans = std::min(ans, ops::start(*pitch_bends));
-    ans = std::min(ans, ops::start(*pedals));
-    ans = std::min(ans, ops::start(*lyrics));
+    ans = std::min(ans, ops::start(*notes, is_time_sorted(NOTES)));
+    ans = std::min(ans, ops::start(*controls, is_time_sorted(CONTROLS)));
+    ans = std::min(ans, ops::start(*pitch_bends, is_time_sorted(PITCH_BENDS)));
+    ans = std::min(ans, ops::start(*pedals, is_time_sorted(PEDALS)));
+    ans = std::min(ans, ops::start(*lyrics, is_time_sorted(LYRICS)));
     return ans;
 }
 
@@ -31,11 +55,11 @@ template<TType T>
 typename T::unit Track<T>::end() const {
     if(this->empty()) return 0;
     typename T::unit ans = std::numeric_limits<typename T::unit>::min();
-    ans = std::max(ans, ops::end(*notes));
-    ans = std::max(ans, ops::end(*controls));
-    ans = std::max(ans, ops::end(*pitch_bends));
-    ans = std::max(ans, ops::end(*pedals));
-    ans = std::max(ans, ops::end(*lyrics));
+    ans = std::max(ans, ops::end(*notes, is_time_sorted(NOTES)));
+    ans = std::max(ans, ops::end(*controls, is_time_sorted(CONTROLS)));
+    ans = std::max(ans, ops::end(*pitch_bends, is_time_sorted(PITCH_BENDS)));
+    ans = std::max(ans, ops::end(*pedals, is_time_sorted(PEDALS)));
+    ans = std::max(ans, ops::end(*lyrics, is_time_sorted(LYRICS)));
     return ans;
 }
 
@@ -49,77 +73,345 @@ bool Track<T>::empty() const {
     return notes->empty() && controls->empty() && pitch_bends->empty() && pedals->empty() && lyrics->empty();
 }
 
+template<TType T>
+Track<T> Track<T>::cow_copy() const {
+    Track ans{name, program, is_drum, notes, controls, pitch_bends, pedals, lyrics};
+    ans.time_sorted = time_sorted & ~exposed;
+    // exposed lists could be modified from outside without notice, so they are never shared
+    ans.detach(exposed);
+    return ans;
+}
+
+template<TType T>
+void Track<T>::detach(const u8 kinds) {
+    const u8 todo = kinds & ~exposed;
+    // a shared block is copied as a whole, otherwise the copy of one list would leave the old
+    // one behind in the block, kept alive by the lists of this track still in it
+    if (const u8 block = pooled(); (todo & block) && block_shared(block)) {
+        if (block == ALL) {
+            alloc_lists(std::make_shared<details::TrackLists<T>>(
+                notes->deepcopy(),
+                controls->deepcopy(),
+                pitch_bends->deepcopy(),
+                pedals->deepcopy(),
+                lyrics->deepcopy()
+            ));
+        } else {
+            unpool();
+        }
+    }
+    if (todo & NOTES) details::detach_list(notes, own_refs(notes));
+    if (todo & CONTROLS) details::detach_list(controls, own_refs(controls));
+    if (todo & PITCH_BENDS) details::detach_list(pitch_bends, own_refs(pitch_bends));
+    if (todo & PEDALS) details::detach_list(pedals, own_refs(pedals));
+    if (todo & LYRICS) details::detach_list(lyrics, own_refs(lyrics));
+}
+
+template<TType T>
+void Track<T>::expose(const u8 kinds) {
+    unpool();
+    detach(kinds);
+    exposed |= kinds;
+}
+
+template<TType T>
+u8 Track<T>::pooled() const {
+    u8 ans = 0;
+    if (own_refs(notes) > 1) ans |= NOTES;
+    if (own_refs(controls) > 1) ans |= CONTROLS;
+    if (own_refs(pitch_bends) > 1) ans |= PITCH_BENDS;
+    if (own_refs(pedals) > 1) ans |= PEDALS;
+    if (own_refs(lyrics) > 1) ans |= LYRICS;
+    return ans;
+}
+
+template<TType T>
+bool Track<T>::block_shared(const u8 pooled) const {
+    // all the pooled lists are in one block, so any of them tells
+    if (pooled & NOTES) return notes.use_count() > own_refs(notes);
+    if (pooled & CONTROLS) return controls.use_count() > own_refs(controls);
+    if (pooled & PITCH_BENDS) return pitch_bends.use_count() > own_refs(pitch_bends);
+    if (pooled & PEDALS) return pedals.use_count() > own_refs(pedals);
+    return false;
+}
+
+template<TType T>
+void Track<T>::unpool() {
+    const u8 block = pooled();
+    if (!block) return;
+    const bool shared_block = block_shared(block);
+    if (block & NOTES) details::leave_block(notes, shared_block);
+    if (block & CONTROLS) details::leave_block(controls, shared_block);
+    if (block & PITCH_BENDS) details::leave_block(pitch_bends, shared_block);
+    if (block & PEDALS) details::leave_block(pedals, shared_block);
+    if (block & LYRICS) details::leave_block(lyrics, shared_block);
+}
+
+template<TType T>
+MemoryUsage Track<T>::memory_usage() const {
+    MemoryUsage ans;
+    ans.notes       = symusic::memory_usage(notes);
+    ans.controls    = symusic::memory_usage(controls);
+    ans.pitch_bends = symusic::memory_usage(pitch_bends);
+    ans.pedals      = symusic::memory_usage(pedals);
+    ans.lyrics      = symusic::memory_usage(lyrics);
+    ans.other       = sizeof(Track) + details::string_memory_usage(name)
+                + details::control_blocks_usage(notes, controls, pitch_bends, pedals, lyrics);
+    // the block is allocated as a whole, so the slots of the lists moved out of it still count
+    if (const u8 block = pooled()) {
+        if (!(block & NOTES)) ans.other += sizeof(pyvec<Note<T>>);
+        if (!(block & CONTROLS)) ans.other += sizeof(pyvec<ControlChange<T>>);
+        if (!(block & PITCH_BENDS)) ans.other += sizeof(pyvec<PitchBend<T>>);
+        if (!(block & PEDALS)) ans.other += sizeof(pyvec<Pedal<T>>);
+        if (!(block & LYRICS)) ans.other += sizeof(pyvec<TextMeta<T>>);
+    }
+    return ans;
+}
+
+template<TType T>
+void Track<T>::shrink_to_fit() {
+    name.shrink_to_fit();
+    // the block is rebuilt as a whole, so that the old one is freed. A block shared with
+    // copy-on-write copies is left as it is, they still read it
+    if (const u8 block = pooled(); block && !block_shared(block)) {
+        if (block == ALL) {
+            alloc_lists(std::make_shared<details::TrackLists<T>>(
+                pyvec<Note<T>>(notes->collect()),
+                pyvec<ControlChange<T>>(controls->collect()),
+                pyvec<PitchBend<T>>(pitch_bends->collect()),
+                pyvec<Pedal<T>>(pedals->collect()),
+                pyvec<TextMeta<T>>(lyrics->collect())
+            ));
+        } else {
+            unpool();
+        }
+    }
+    // the lists out of the block, exposed ones are never shrunk since python may hold them
+    if (!(exposed & NOTES) && own_refs(notes) == 1) details::shrink_list(notes);
+    if (!(exposed & CONTROLS) && own_refs(controls) == 1) details::shrink_list(controls);
+    if (!(exposed & PITCH_BENDS) && own_refs(pitch_bends) == 1) details::shrink_list(pitch_bends);
+    if (!(exposed & PEDALS) && own_refs(pedals) == 1) details::shrink_list(pedals);
+    if (!(exposed & LYRICS) && own_refs(lyrics) == 1) details::shrink_list(lyrics);
+}
+
 template<TType T>
 void Track<T>::sort_inplace(const bool reverse) {
-    auto key = [](const auto & event) { return event.default_key(); };
-    notes->sort(key, reverse);
-    controls->sort(key, reverse);
-    pitch_bends->sort(key, reverse);
-    pedals->sort(key, reverse);
-    lyrics->sort(key, reverse);
+    detach();
+    details::sort_list(*notes, reverse, exposed & NOTES);
+    details::sort_list(*controls, reverse, exposed & CONTROLS);
+    details::sort_list(*pitch_bends, reverse, exposed & PITCH_BENDS);
+    details::sort_list(*pedals, reverse, exposed & PEDALS);
+    details::sort_list(*lyrics, reverse, exposed & LYRICS);
+    // default_key starts with time
+    time_sorted = reverse ? 0 : ALL;
 }
 
 template<TType T>
 Track<T> Track<T>::sort(const bool reverse) {
-    auto ans = deepcopy();
+    auto ans = cow_copy();
     ans.sort_inplace(reverse);
     return ans;
 }
 
 template<TType T>
 void Track<T>::clip_inplace(const unit start, const unit end, const bool clip_end) {
-    ops::clip_inplace(*notes, start, end, clip_end);
-    ops::clip_inplace(*controls, start, end);
-    ops::clip_inplace(*pitch_bends, start, end);
-    ops::clip_inplace(*pedals, start, end, clip_end);
-    ops::clip_inplace(*lyrics, start, end, clip_end);
+    detach();
+    ops::clip_inplace(*notes, start, end, clip_end, is_time_sorted(NOTES));
+    ops::clip_inplace(*controls, start, end, false, is_time_sorted(CONTROLS));
+    ops::clip_inplace(*pitch_bends, start, end, false, is_time_sorted(PITCH_BENDS));
+    ops::clip_inplace(*pedals, start, end, clip_end, is_time_sorted(PEDALS));
+    ops::clip_inplace(*lyrics, start, end, clip_end, is_time_sorted(LYRICS));
 }
 
 
 template<TType T>
 Track<T> Track<T>::clip(const unit start, const unit end, const bool clip_end) const {
-    auto ans = deepcopy();
-    ans.clip_inplace(start, end, clip_end);
+    // only the kept events are copied, instead of copying all and then filtering
+    Track ans{
+        name,
+        program,
+        is_drum,
+        ops::clip_copy(*notes, start, end, clip_end, is_time_sorted(NOTES)),
+        ops::clip_copy(*controls, start, end, false, is_time_sorted(CONTROLS)),
+        ops::clip_copy(*pitch_bends, start, end, false, is_time_sorted(PITCH_BENDS)),
+        ops::clip_copy(*pedals, start, end, clip_end, is_time_sorted(PEDALS)),
+        ops::clip_copy(*lyrics, start, end, clip_end, is_time_sorted(LYRICS))
+    };
+    ans.time_sorted = time_sorted & ~exposed;
     return ans;
 }
 
 template<TType T>
 void Track<T>::shift_time_inplace(const unit offset) {
-    for(auto& note: *notes) note->shift_time_inplace(offset);
-    for(auto& control: *controls) control->shift_time_inplace(offset);
-    for(auto& pitch_bend: *pitch_bends) pitch_bend->shift_time_inplace(offset);
-    for(auto& pedal: *pedals) pedal->shift_time_inplace(offset);
-    for(auto& lyric: *lyrics) lyric->shift_time_inplace(offset);
+    if(offset == 0) return;
+    detach();
+    ops::shift_time_inplace(*notes, offset);
+    ops::shift_time_inplace(*controls, offset);
+    ops::shift_time_inplace(*pitch_bends, offset);
+    ops::shift_time_inplace(*pedals, offset);
+    ops::shift_time_inplace(*lyrics, offset);
 }
 
 template<TType T>
 Track<T> Track<T>::shift_time(const unit offset) const {
-    auto ans = deepcopy();
+    auto ans = cow_copy();
     ans.shift_time_inplace(offset);
     return ans;
 }
 
 template<TType T>
-void Track<T>::shift_pitch_inplace(const i8 offset) {
-    for(auto& note: *notes) note->shift_pitch_inplace(offset);
+void Track<T>::shift_pitch_inplace(const i8 offset, const bool saturate) {
+    if(offset == 0) return;
+    if(!saturate) ops::details::check_shift<&Note<T>::pitch>(*notes, offset, "pitch");
+    detach(NOTES);
+    ops::shift_notes_inplace(*notes, 0, offset, 0, true);
+}
+
+template<TType T>
+Track<T> Track<T>::shift_pitch(const i8 offset, const bool saturate) const {
+    auto ans = cow_copy();
+    ans.shift_pitch_inplace(offset, saturate);
+    return ans;
+}
+
+template<TType T>
+void Track<T>::shift_velocity_inplace(const i8 offset, const bool saturate) {
+    if(offset == 0) return;
+    if(!saturate) ops::details::check_shift<&Note<T>::velocity>(*notes, offset, "velocity");
+    detach(NOTES);
+    ops::shift_notes_inplace(*notes, 0, 0, offset, true);
+}
+
+template<TType T>
+Track<T> Track<T>::shift_velocity(const i8 offset, const bool saturate) const {
+    auto ans = cow_copy();
+    ans.shift_velocity_inplace(offset, saturate);
+    return ans;
+}
+
+template<TType T>
+void Track<T>::shift_inplace(
+    const unit time, const i8 pitch, const i8 velocity, const bool saturate
+) {
+    if(pitch == 0 && velocity == 0) return shift_time_inplace(time);
+    if(!saturate) {
+        ops::details::check_shift<&Note<T>::pitch>(*notes, pitch, "pitch");
+        ops::details::check_shift<&Note<T>::velocity>(*notes, velocity, "velocity");
+    }
+    detach(time == 0 ? NOTES : ALL);
+    ops::shift_notes_inplace(*notes, time, pitch, velocity, true);
+    if(time == 0) return;
+    ops::shift_time_inplace(*controls, time);
+    ops::shift_time_inplace(*pitch_bends, time);
+    ops::shift_time_inplace(*pedals, time);
+    ops::shift_time_inplace(*lyrics, time);
 }
 
 template<TType T>
-Track<T> Track<T>::shift_pitch(const i8 offset) const {
-    auto ans = deepcopy();
-    ans.shift_pitch_inplace(offset);
+Track<T> Track<T>::shift(
+    const unit time, const i8 pitch, const i8 velocity, const bool saturate
+) const {
+    auto ans = cow_copy();
+    ans.shift_inplace(time, pitch, velocity, saturate);
     return ans;
 }
 
 template<TType T>
-void Track<T>::shift_velocity_inplace(const i8 offset) {
-    for(auto& note: *notes) note->shift_velocity_inplace(offset);
+void Track<T>::apply_sustain_inplace() {
+    if (notes->empty() || pedals->empty()) return;
+    detach(NOTES);
+    ops::apply_sustain_inplace(*notes, *pedals, is_time_sorted(NOTES), is_time_sorted(PEDALS));
+}
+
+template<TType T>
+Track<T> Track<T>::apply_sustain() const {
+    auto ans = cow_copy();
+    ans.apply_sustain_inplace();
+    return ans;
+}
+
+template<TType T>
+OverlapStats Track<T>::dedup_notes_inplace() {
+    if (notes->size() < 2) return {};
+    static const SortKey<Note<T>> key{{"pitch", "time", "duration"}};
+    // argsort is stable, so the first one of the duplicates in the list comes first
+    const auto order = key.argsort(*notes);
+    vec<u8>    keep(notes->size(), 1);
+    size_t     removed = 0;
+    for (size_t i = 1; i < order.size(); ++i) {
+        const auto& prev = (*notes)[order[i - 1]];
+        const auto& cur  = (*notes)[order[i]];
+        if (cur.pitch == prev.pitch && cur.time == prev.time && cur.duration == prev.duration) {
+            keep[order[i]] = 0;
+            ++removed;
+        }
+    }
+    if (removed == 0) return {};
+    detach(NOTES);
+    details::remove_notes(*notes, keep);
+    return {removed, 0};
+}
+
+template<TType T>
+Track<T> Track<T>::dedup_notes() const {
+    auto ans = cow_copy();
+    ans.dedup_notes_inplace();
+    return ans;
+}
+
+template<TType T>
+OverlapStats Track<T>::resolve_overlaps_inplace(const OverlapPolicy policy) {
+    if (notes->size() < 2) return {};
+    static const SortKey<Note<T>> key{{"pitch", "time"}};
+    const auto   order = key.argsort(*notes);
+    vec<u8>      keep(notes->size(), 1);
+    vec<unit>    durations;   // new durations of the truncated notes, applied after detaching
+    vec<u32>     truncated;
+    OverlapStats ans;
+    // the last kept note of the current pitch
+    u32 last = order[0];
+    for (size_t i = 1; i < order.size(); ++i) {
+        const u32   idx  = order[i];
+        const auto& cur  = (*notes)[idx];
+        const auto& prev = (*notes)[last];
+        if (cur.pitch != prev.pitch || cur.time >= prev.end()) {
+            last = idx;
+            continue;
+        }
+        switch (policy) {
+        case OverlapPolicy::KEEP_FIRST: keep[idx] = 0; break;
+        case OverlapPolicy::KEEP_LONGEST:
+            if (cur.duration > prev.duration) {
+                keep[last] = 0;
+                last       = idx;
+            } else {
+                keep[idx] = 0;
+            }
+            break;
+        case OverlapPolicy::TRUNCATE_PREVIOUS:
+            if (cur.time == prev.time) {
+                keep[last] = 0;
+            } else {
+                truncated.push_back(last);
+                durations.push_back(cur.time - prev.time);
+            }
+            last = idx;
+            break;
+        }
+    }
+    ans.truncated = truncated.size();
+    ans.removed   = static_cast<size_t>(std::count(keep.begin(), keep.end(), u8{0}));
+    if (ans.removed == 0 && ans.truncated == 0) return ans;
+    detach(NOTES);
+    for (size_t i = 0; i < truncated.size(); ++i) (*notes)[truncated[i]].duration = durations[i];
+    details::remove_notes(*notes, keep);
+    return ans;
 }
 
 template<TType T>
-Track<T> Track<T>::shift_velocity(const i8 offset) const {
-    auto ans = deepcopy();
-    ans.shift_velocity_inplace(offset);
+Track<T> Track<T>::resolve_overlaps(const OverlapPolicy policy) const {
+    auto ans = cow_copy();
+    ans.resolve_overlaps_inplace(policy);
     return ans;
 }
 
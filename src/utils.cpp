@@ -1,15 +1,31 @@
 //
 // Created by lyk on 23-12-16.
 //
+#include <algorithm>
 #include "symusic/utils.h"
 #include "utf8.h"
 
 namespace symusic::details {
 
-std::string strip_non_utf_8(const std::string &str) {
+std::string strip_non_utf_8(const std::string_view str) {
+  const bool ascii = std::all_of(str.begin(), str.end(), [](const char c) {
+    return static_cast<unsigned char>(c) < 0x80;
+  });
+  if (ascii || utf8::is_valid(str.begin(), str.end())) return std::string(str);
   std::string ans;
+  ans.reserve(str.size());
   utf8::replace_invalid(str.begin(), str.end(), std::back_inserter(ans));
   return ans;
 }
 
+const std::string& TextDecoder::operator()(const std::span<const u8> bytes) {
+  const std::string_view raw(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  if (raw.size() > max_interned) {
+    scratch = strip_non_utf_8(raw);
+    return scratch;
+  }
+  if (const auto it = interned.find(raw); it != interned.end()) return it->second;
+  return interned.emplace(std::string(raw), strip_non_utf_8(raw)).first->second;
+}
+
 } // namespace symusic::details
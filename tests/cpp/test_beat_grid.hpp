@@ -0,0 +1,125 @@
+#pragma once
+#ifndef SYMUSIC_TEST_BEAT_GRID_HPP
+#define SYMUSIC_TEST_BEAT_GRID_HPP
+
+#include <cmath>
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+using namespace symusic;
+
+TEST_CASE("Test BeatGrid", "[symusic][beat_grid]") {
+    SECTION("Bars and beats") {
+        Score<Tick> score(480);
+        score.time_signatures->emplace_back(3840, 3, 4);
+        score.time_signatures->emplace_back(0, 4, 4);
+        const BeatGrid<Tick> grid(score, 6000);
+        REQUIRE(grid.downbeats() == vec<i32>{0, 1920, 3840, 5280});
+        REQUIRE(grid.beats().size() == 8 + 3 + 2);
+        REQUIRE(grid.beats()[9] == 4320);
+        REQUIRE(grid.beats().back() == 5760);
+
+        const auto pos = grid.locate(4400);
+        REQUIRE(pos.bar == 2);
+        REQUIRE(pos.beat == 1);
+        REQUIRE(std::abs(pos.position - 1. / 6) < 1e-9);
+        // before 0 and after the grid, in the time signature in effect there
+        REQUIRE(grid.locate(-480).bar == -1);
+        REQUIRE(grid.locate(-480).beat == 3);
+        REQUIRE(grid.locate(7000).bar == 4);
+        REQUIRE(grid.locate(7000).beat == 0);
+        REQUIRE(grid.locate(7500).beat == 1);
+        REQUIRE(grid.downbeat(6) == 6720 + 2 * 1440);
+        REQUIRE(grid.downbeat(-2) == -3840);
+        REQUIRE_THROWS_AS(BeatGrid<Tick>(Score<Tick>(0), 6000), std::invalid_argument);
+        REQUIRE_THROWS_AS(BeatGrid<Tick>(Score<Tick>(-96), 6000), std::invalid_argument);
+    }
+
+    SECTION("Time signatures in the middle of a bar and compound meters") {
+        Score<Tick> score(480);
+        score.time_signatures->emplace_back(0, 4, 4);
+        score.time_signatures->emplace_back(960, 6, 8);
+        const BeatGrid<Tick> grid(score, 2400);
+        // the first bar is cut at 960, then bars of 6 eighths
+        REQUIRE(grid.downbeats() == vec<i32>{0, 960, 2400});
+        REQUIRE(grid.beats()[2] == 960);
+        REQUIRE(grid.beats()[3] == 1200);
+        REQUIRE(grid.locate(2300).beat == 5);
+        // the default 4/4 without any time signature
+        const BeatGrid<Tick> plain(Score<Tick>(96), 400);
+        REQUIRE(plain.downbeats() == vec<i32>{0, 384});
+    }
+
+    SECTION("Seconds follow the tempos") {
+        Score<Second> score(480);
+        score.time_signatures->emplace_back(0, 4, 4);
+        score.tempos->emplace_back(0, 500000);
+        score.tempos->emplace_back(2, 250000);
+        const BeatGrid<Second> grid(score, 4.5f);
+        const vec<f32>         expected{0, 2, 3, 4};
+        REQUIRE(grid.downbeats().size() == expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            REQUIRE(std::abs(grid.downbeats()[i] - expected[i]) < 1e-5);
+        }
+        const auto pos = grid.locate(2.125f);
+        REQUIRE(pos.bar == 1);
+        REQUIRE(pos.beat == 0);
+        REQUIRE(std::abs(pos.position - 0.5) < 1e-5);
+
+        // the same grid as the Tick score it's converted from
+        Score<Tick> ticks(480);
+        ticks.time_signatures->emplace_back(0, 3, 4);
+        ticks.time_signatures->emplace_back(2880, 5, 8);
+        ticks.tempos->emplace_back(0, 600000);
+        ticks.tempos->emplace_back(1000, 400000);
+        auto track = std::make_shared<Track<Tick>>("piano", 0, false);
+        track->notes->emplace_back(9000, 100, 60, 100);
+        ticks.tracks->push_back(track);
+        const BeatGrid<Tick>   tick_grid(ticks);
+        const BeatGrid<Second> second_grid(convert<Second>(ticks));
+        REQUIRE(tick_grid.beats().size() == second_grid.beats().size());
+        for (size_t i = 0; i < tick_grid.beats().size(); ++i) {
+            REQUIRE(
+                tick_grid.locate(tick_grid.beats()[i]).bar
+                == second_grid.locate(second_grid.beats()[i]).bar
+            );
+        }
+    }
+
+    SECTION("Batched lookups") {
+        Score<Quarter> score(480);
+        score.time_signatures->emplace_back(0, 3, 4);
+        const BeatGrid<Quarter> grid(score, 12);
+        const vec<f32>          sorted{-1, 0, 0.5, 2.9f, 3, 7.25f, 12, 20};
+        const vec<f32>          shuffled{7.25f, 0, 20, -1, 3, 0.5, 12, 2.9f};
+        for (const auto& times : {sorted, shuffled}) {
+            const auto batch = grid.locate(std::span<const f32>(times));
+            REQUIRE(batch.bars.size() == times.size());
+            for (size_t i = 0; i < times.size(); ++i) {
+                const auto pos = grid.locate(times[i]);
+                REQUIRE(batch.bars[i] == pos.bar);
+                REQUIRE(batch.beats[i] == pos.beat);
+                REQUIRE(batch.positions[i] == pos.position);
+            }
+        }
+        REQUIRE(grid.locate(7.25f).bar == 2);
+        REQUIRE(grid.locate(7.25f).beat == 1);
+    }
+
+    SECTION("Cached on the score") {
+        Score<Second> score(480);
+        score.time_signatures->emplace_back(0, 3, 4);
+        const auto first = score.beat_grid(10);
+        REQUIRE(score.beat_grid(10) == first);
+        REQUIRE(score.beat_grid(12) != first);
+        const auto second = score.beat_grid(12);
+        score.tempos->emplace_back(1, 1000000);
+        const auto slower = score.beat_grid(12);
+        REQUIRE(slower != second);
+        REQUIRE(slower->downbeat(1) > second->downbeat(1));
+        score.time_signatures->emplace_back(0, 4, 4);
+        REQUIRE(score.beat_grid(12) != slower);
+        REQUIRE(score.beat_grid(12)->beats() == BeatGrid<Second>(score, 12).beats());
+    }
+}
+
+#endif   // SYMUSIC_TEST_BEAT_GRID_HPP
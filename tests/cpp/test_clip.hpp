@@ -0,0 +1,48 @@
+#pragma once
+#ifndef SYMUSIC_TEST_CLIP_HPP
+#define SYMUSIC_TEST_CLIP_HPP
+
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+using namespace symusic;
+
+TEST_CASE("Test clip on sorted lists", "[symusic][clip]") {
+    Score<Tick> score(480);
+    auto        track = std::make_shared<Track<Tick>>("piano", 0, false);
+    for (i32 i = 0; i < 100; ++i) {
+        track->notes->emplace_back(i * 10, i % 4 * 10, 60, 80);
+        track->controls->emplace_back(i * 10 + 5, 64, 127);
+    }
+    score.tracks->push_back(track);
+    score.tempos->emplace_back(0, 500000);
+    score.tempos->emplace_back(100, 400000);
+    score.tempos->emplace_back(100, 300000);
+    score.tempos->emplace_back(300, 600000);
+
+    // the same score, without knowing it's sorted
+    const Score<Tick> unknown = score.deepcopy();
+    score.sort_inplace();
+    REQUIRE(score.is_time_sorted(Score<Tick>::ALL));
+    REQUIRE(track->is_time_sorted(Track<Tick>::ALL));
+    REQUIRE_FALSE(unknown.tracks->front()->is_time_sorted(Track<Tick>::NOTES));
+
+    for (const auto& [start, end] : {std::pair{0, 1000}, {95, 405}, {100, 300}, {150, 150}, {-50, 20}}) {
+        for (const bool clip_end : {false, true}) {
+            const auto clipped = score.clip(start, end, clip_end);
+            REQUIRE(clipped == unknown.clip(start, end, clip_end));
+            REQUIRE(clipped.is_time_sorted(Score<Tick>::ALL));
+
+            auto inplace = score.cow_copy();
+            inplace.clip_inplace(start, end, clip_end);
+            REQUIRE(inplace == clipped);
+        }
+    }
+    REQUIRE(score.start() == unknown.start());
+    REQUIRE(score.end() == unknown.end());
+
+    track->expose(Track<Tick>::NOTES);
+    REQUIRE_FALSE(track->is_time_sorted(Track<Tick>::NOTES));
+    REQUIRE(track->is_time_sorted(Track<Tick>::CONTROLS));
+}
+
+#endif   // SYMUSIC_TEST_CLIP_HPP
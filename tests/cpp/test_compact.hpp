@@ -0,0 +1,44 @@
+#pragma once
+#ifndef SYMUSIC_TEST_COMPACT_HPP
+#define SYMUSIC_TEST_COMPACT_HPP
+
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+using namespace symusic;
+
+TEST_CASE("Test CompactNotes", "[symusic][compact]") {
+    SECTION("Tick round trip") {
+        vec<Note<Tick>> notes;
+        for (i32 i = 0; i < 1000; ++i) {
+            // unsorted onsets, negative durations and velocities are all allowed
+            notes.emplace_back((i * 37) % 500 - 20, i % 7 - 1, i % 128, i == 700 ? -1 : i % 100);
+        }
+        const CompactNotes<Tick> compact(notes, 64);
+        REQUIRE(compact.size() == notes.size());
+        REQUIRE(compact.block_num() == 16);
+        REQUIRE(compact.decode() == notes);
+        REQUIRE(compact.at(700) == notes[700]);
+        REQUIRE(compact.decode_block(3) == vec<Note<Tick>>(notes.begin() + 192, notes.begin() + 256));
+        REQUIRE(compact.decode_range(100, 300) == vec<Note<Tick>>(notes.begin() + 100, notes.begin() + 300));
+        REQUIRE(compact.nbytes() < notes.size() * sizeof(Note<Tick>));
+    }
+    SECTION("Quarter round trip") {
+        vec<Note<Quarter>> notes;
+        for (i32 i = 0; i < 300; ++i) {
+            notes.emplace_back(static_cast<f32>(i) * 0.25f - 3.f, 0.5f, 60 + i % 12, 80);
+        }
+        const CompactNotes<Quarter> compact(notes);
+        REQUIRE(compact.decode() == notes);
+        REQUIRE(compact.at(299) == notes[299]);
+    }
+    SECTION("CompactTrack") {
+        Track<Tick> track("piano", 1, false);
+        for (i32 i = 0; i < 10; ++i) track.notes->emplace_back(i * 10, 5, 60, 100);
+        track.controls->emplace_back(0, 64, 127);
+        const CompactTrack<Tick> compact(track);
+        REQUIRE(compact.note_num() == 10);
+        REQUIRE(compact.to_track() == track);
+    }
+}
+
+#endif // SYMUSIC_TEST_COMPACT_HPP
@@ -0,0 +1,57 @@
+#pragma once
+#ifndef SYMUSIC_TEST_CONCAT_HPP
+#define SYMUSIC_TEST_CONCAT_HPP
+
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+#include "test_scores.hpp"
+using namespace symusic;
+
+TEST_CASE("Test concat and splice", "[symusic][concat]") {
+    SECTION("Concat") {
+        const vec<shared<Score<Tick>>> scores{
+            test_scores::concat(480, 500000, 0),
+            test_scores::concat(480, 500000, 0),
+            test_scores::concat(960, 400000, 24),
+        };
+        const auto ans = ops::concat<Tick>(scores, 240);
+        REQUIRE(ans.ticks_per_quarter == 480);
+        // piano of the first two, drums of all, guitar of the last
+        REQUIRE(ans.tracks->size() == 3);
+        REQUIRE((*ans.tracks)[0]->note_num() == 8);
+        REQUIRE((*ans.tracks)[1]->note_num() == 3);
+        REQUIRE((*ans.tracks)[2]->program == 24);
+        REQUIRE((*(*ans.tracks)[0]->notes)[4].time == 1920 + 240);
+        // the third one is resampled to 480 tpq
+        REQUIRE((*(*ans.tracks)[2]->notes)[1].time - (*(*ans.tracks)[2]->notes)[0].time == 480);
+        REQUIRE((*(*ans.tracks)[2]->notes)[0].time == 2 * (1920 + 240));
+        // the tempo and time signature of the copies are kept, without redundant ones
+        REQUIRE(ans.tempos->size() == 2);
+        REQUIRE((*ans.tempos)[1] == Tempo<Tick>(2 * (1920 + 240), 400000));
+        REQUIRE(ans.time_signatures->size() == 1);
+        REQUIRE(ans.is_time_sorted(Score<Tick>::ALL));
+        REQUIRE((*ans.tracks)[0]->is_time_sorted(Track<Tick>::ALL));
+        REQUIRE_THROWS_AS(ops::concat<Tick>(vec<shared<Score<Tick>>>{}), std::invalid_argument);
+    }
+    SECTION("Splice") {
+        const auto score = test_scores::concat(480, 500000, 0);
+        const auto other = test_scores::concat(480, 400000, 0);
+        other->time_signatures->clear();
+        const auto ans = ops::splice(*score, 960, *other);
+        const auto& notes = *(*ans.tracks)[0]->notes;
+        REQUIRE(notes.size() == 8);
+        REQUIRE(notes[1].time == 480);
+        REQUIRE(notes[2].time == 960);    // the first note of other
+        REQUIRE(notes[6].time == 960 + 1920);   // the third note of score, delayed
+        // other uses 400000 and the default 4/4, and the maps of score are restored after it
+        REQUIRE(ans.tempos->collect() == vec<Tempo<Tick>>{
+            {0, 500000}, {960, 400000}, {960 + 1920, 500000}
+        });
+        REQUIRE(ans.time_signatures->collect() == vec<TimeSignature<Tick>>{
+            {0, 3, 4}, {960, 4, 4}, {960 + 1920, 3, 4}
+        });
+        REQUIRE(ans.is_time_sorted(Score<Tick>::ALL));
+    }
+}
+
+#endif   // SYMUSIC_TEST_CONCAT_HPP
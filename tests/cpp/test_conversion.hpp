@@ -0,0 +1,117 @@
+#pragma once
+#ifndef SYMUSIC_TEST_CONVERSION_HPP
+#define SYMUSIC_TEST_CONVERSION_HPP
+
+#include <cmath>
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+#include "test_scores.hpp"
+using namespace symusic;
+
+TEST_CASE("Test partial conversion", "[symusic][conversion]") {
+    const auto score = test_scores::conversion();
+
+    SECTION("A single track") {
+        const auto map  = score.tempo_map();
+        const auto full = convert<Second>(score);
+        for (size_t i = 0; i < score.tracks->size(); ++i) {
+            const auto track = convert<Second>(*(*score.tracks)[i], *map);
+            REQUIRE(track == *(*full.tracks)[i]);
+        }
+        // ticks and quarters only need the tpq of the map
+        const auto quarters = convert<Quarter>(score);
+        REQUIRE(convert<Quarter>(*(*score.tracks)[1], *map) == *(*quarters.tracks)[1]);
+        // and back, with the map of the converted score
+        const auto back = convert<Tick>(*(*full.tracks)[2], *full.tempo_map());
+        REQUIRE(back == *(*convert<Tick>(full).tracks)[2]);
+        REQUIRE(convert<Second>(*(*score.tracks)[0], *map, 1.f).notes->front().duration == 1.f);
+    }
+
+    SECTION("A time range") {
+        const auto part = convert<Second>(score, 1000, 4000);
+        REQUIRE(part == convert<Second>(score).clip(
+            score.tempo_map()->convert<Tick, Second>(1000),
+            score.tempo_map()->convert<Tick, Second>(4000)
+        ));
+        // the times still follow the tempos before the range
+        REQUIRE(part.tempos->front().time == score.tempo_map()->convert<Tick, Second>(1000));
+        REQUIRE(part.tempos->front().mspq == 500000);
+        REQUIRE(part.tempos->back().mspq == 250000);
+        for (const auto& track : *part.tracks) {
+            for (const auto& note : *track->notes) {
+                REQUIRE(note.time >= score.tempo_map()->convert<Tick, Second>(1000));
+            }
+        }
+        const auto first = convert<Second>(score, 0, 1920);
+        // the pedals end at 2500, after the tempo change at 1920
+        REQUIRE(std::abs(first.end() - score.tempo_map()->convert<Tick, Second>(2500)) < 1e-5);
+        REQUIRE(first.note_num() == 3 * 8);
+    }
+}
+
+TEST_CASE("Test resample", "[symusic][conversion]") {
+    const auto score = test_scores::conversion();
+
+    SECTION("Exact ticks") {
+        Score<Tick> ties(480);
+        auto        track = std::make_shared<Track<Tick>>("ties", 0, false);
+        for (const i32 t : {-3, -1, 1, 3, 5}) track->notes->emplace_back(t, 1, 60, 100);
+        ties.tracks->push_back(track);
+        // halves are rounded away from zero, like std::round
+        const auto half  = resample(ties, 240);
+        vec<i32>   times;
+        for (const auto& note : *half.tracks->front()->notes) times.push_back(note.time);
+        REQUIRE(times == vec<i32>{-2, -1, 1, 2, 3});
+        REQUIRE(half.tracks->front()->notes->front().duration == 1);
+        // integral ratios are exact in both ways
+        REQUIRE(resample(resample(score, 2400), 480) == score);
+        REQUIRE(resample(score, 480) == score);
+
+        Score<Tick> far(480);
+        far.markers->emplace_back(1 << 30, "far");
+        REQUIRE_THROWS_AS(resample(far, 4800), std::overflow_error);
+        REQUIRE_THROWS_AS(resample(far, 0), std::invalid_argument);
+    }
+
+    SECTION("In place") {
+        const auto expected = resample(score, 96, 10);
+        Score<Tick> copied  = score.deepcopy();
+        resample_inplace(copied, 96, 10);
+        REQUIRE(copied == expected);
+        // lists shared with another score are copied, not modified
+        const auto  original = score.deepcopy();
+        Score<Tick> shared   = score.cow_copy();
+        resample_inplace(shared, 96, 10);
+        REQUIRE(shared == expected);
+        REQUIRE(score == original);
+        // the same tpq only applies min_dur
+        resample_inplace(copied, 96, 30);
+        REQUIRE(copied.ticks_per_quarter == 96);
+        REQUIRE(copied.tracks->front()->notes->front().duration == 72);
+        REQUIRE(copied.tracks->front()->pedals->front().duration == 400);
+        // an overflow in any list leaves the score unchanged
+        Score<Tick> far = score.deepcopy();
+        far.tracks->back()->notes->emplace_back(0, 1 << 30, 60, 100);
+        far.markers->emplace_back(1 << 29, "far");
+        const auto before = far.deepcopy();
+        REQUIRE_THROWS_AS(resample_inplace(far, 4800), std::overflow_error);
+        REQUIRE(far == before);
+    }
+
+    SECTION("From quarters and seconds") {
+        // converted to the new ticks directly
+        const auto expected = resample(score, 960);
+        REQUIRE(resample(convert<Quarter>(score), 960) == expected);
+        const auto seconds = resample(convert<Second>(score), 960);
+        REQUIRE(seconds.ticks_per_quarter == 960);
+        const auto& got  = *seconds.tracks->front()->notes;
+        const auto& want = *expected.tracks->front()->notes;
+        REQUIRE(got.size() == want.size());
+        for (size_t i = 0; i < got.size(); ++i) {
+            REQUIRE(std::abs(got[i].time - want[i].time) <= 1);
+            REQUIRE(std::abs(got[i].duration - want[i].duration) <= 1);
+        }
+    }
+}
+
+#endif   // SYMUSIC_TEST_CONVERSION_HPP
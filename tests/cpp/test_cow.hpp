@@ -0,0 +1,110 @@
+#pragma once
+#ifndef SYMUSIC_TEST_COW_HPP
+#define SYMUSIC_TEST_COW_HPP
+
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+using namespace symusic;
+
+TEST_CASE("Test copy-on-write", "[symusic][cow]") {
+    Track<Tick> track("piano", 0, false);
+    for (i32 i = 0; i < 16; ++i) {
+        track.notes->emplace_back(i * 10, 10, 60 + i, 80);
+        track.controls->emplace_back(i * 10, 64, 127);
+    }
+    const Track<Tick> origin = track.deepcopy();
+
+    SECTION("Track") {
+        // the pooled lists are copied together, and the source is left as it is
+        const auto shifted = track.shift_pitch(2);
+        REQUIRE(shifted.notes != track.notes);
+        REQUIRE(shifted.controls != track.controls);
+        REQUIRE(track == origin);
+        REQUIRE((*shifted.notes)[3].pitch == 65);
+
+        // out of the block, shifting pitch only copies notes
+        auto unpooled = track.cow_copy();
+        unpooled.unpool();
+        const auto reshifted = unpooled.shift_pitch(2);
+        REQUIRE(reshifted.notes != unpooled.notes);
+        REQUIRE(reshifted.controls == unpooled.controls);
+        REQUIRE(reshifted == shifted);
+
+        // mutating a copy detaches the shared lists first
+        auto copied = track.cow_copy();
+        copied.shift_time_inplace(5);
+        REQUIRE(copied.controls != track.controls);
+        REQUIRE(track == origin);
+        track.shift_time_inplace(5);
+        REQUIRE(track == copied);
+    }
+    SECTION("Exposed lists are never shared") {
+        track.expose(Track<Tick>::NOTES);
+        const auto copied = track.cow_copy();
+        REQUIRE(copied.notes != track.notes);
+        REQUIRE(copied.controls == track.controls);
+        REQUIRE(copied == track);
+    }
+    SECTION("Plain copies are copy-on-write") {
+        track.expose(Track<Tick>::NOTES);
+        Track<Tick> copied(track);
+        REQUIRE(copied.notes != track.notes);
+        REQUIRE(copied.controls == track.controls);
+        // the shared lists are detached by whichever side mutates them first
+        track.shift_time_inplace(5);
+        REQUIRE(copied == origin);
+        Track<Tick> assigned("other", 1, false);
+        assigned = copied;
+        REQUIRE(assigned.controls == copied.controls);
+        copied.shift_time_inplace(5);
+        REQUIRE(assigned == origin);
+        REQUIRE(copied == track);
+
+        Score<Tick> score(480);
+        score.tracks->push_back(std::make_shared<Track<Tick>>(origin.deepcopy()));
+        score.tempos->emplace_back(0, 500000);
+        const Score<Tick> before = score.deepcopy();
+        Score<Tick>       other  = score;
+        REQUIRE(other.tempos == score.tempos);
+        other.shift_time_inplace(10);
+        REQUIRE(score == before);
+        other = score;
+        score.shift_time_inplace(10);
+        REQUIRE(other == before);
+        // copy() is shallow, so the changes are seen by both
+        Score<Tick> fresh = before.deepcopy();
+        Score<Tick> alias = fresh.copy();
+        alias.shift_time_inplace(10);
+        REQUIRE(fresh.tempos->front().time == 10);
+        REQUIRE(fresh == alias);
+    }
+    SECTION("Copies of a shallow copy") {
+        // a cow copy of an alias is independent of both aliases
+        Track<Tick> alias = track.copy();
+        const auto  cow   = alias.cow_copy();
+        track.shift_time_inplace(5);
+        REQUIRE(cow == origin);
+        REQUIRE(alias == track);
+        // and copying only reads the source
+        const Track<Tick>& source = alias;
+        const Track<Tick>  copied(source);
+        REQUIRE(source.exposed == Track<Tick>::ALL);
+        REQUIRE(copied.exposed == 0);
+        REQUIRE(copied.notes != source.notes);
+    }
+    SECTION("Score") {
+        Score<Tick> score(480);
+        score.tracks->push_back(std::make_shared<Track<Tick>>(track));
+        score.tracks->front()->unpool();
+        score.tempos->emplace_back(0, 500000);
+        const auto clipped = score.clip(0, 50);
+        REQUIRE(clipped.tracks->front()->notes->size() == 5);
+        REQUIRE(score.tracks->front()->notes->size() == 16);
+        REQUIRE(*score.tracks->front() == origin);
+        const auto transposed = score.shift_pitch(-1);
+        REQUIRE(transposed.tempos == score.tempos);
+        REQUIRE(transposed.tracks->front()->controls == score.tracks->front()->controls);
+    }
+}
+
+#endif   // SYMUSIC_TEST_COW_HPP
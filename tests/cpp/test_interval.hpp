@@ -0,0 +1,64 @@
+#pragma once
+#ifndef SYMUSIC_TEST_INTERVAL_HPP
+#define SYMUSIC_TEST_INTERVAL_HPP
+
+#include <algorithm>
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+using namespace symusic;
+
+TEST_CASE("Test IntervalIndex", "[symusic][interval]") {
+    pyvec<Note<Tick>> notes;
+    for (i32 i = 0; i < 200; ++i) {
+        // unsorted onsets, with some zero-duration notes
+        notes.emplace_back((i * 53) % 400, i % 9 * 5, 60, 80);
+    }
+    const IntervalIndex<Tick> index(notes);
+    REQUIRE(index.size() == notes.size());
+
+    auto brute_force = [&](const i32 begin, const i32 end) {
+        vec<u32> ans;
+        for (u32 i = 0; i < notes.size(); ++i) {
+            const auto& note = notes[i];
+            if (note.duration > 0 && note.time < end && note.end() > begin) ans.push_back(i);
+        }
+        return ans;
+    };
+    auto sorted = [](vec<u32> v) {
+        std::sort(v.begin(), v.end());
+        return v;
+    };
+
+    SECTION("Point and range queries") {
+        for (i32 t = -10; t < 450; t += 7) {
+            REQUIRE(sorted(index.at(t)) == brute_force(t, t + 1));
+            REQUIRE(sorted(index.overlap(t, t + 30)) == brute_force(t, t + 30));
+        }
+        REQUIRE(index.overlap(100, 100).empty());
+
+        // notes with non-positive duration occupy nothing, even inside the range
+        pyvec<Note<Tick>> empty_notes;
+        empty_notes.emplace_back(10, 0, 60, 80);
+        empty_notes.emplace_back(20, -5, 60, 80);
+        empty_notes.emplace_back(30, 1, 60, 80);
+        const IntervalIndex<Tick> empty_index(empty_notes);
+        REQUIRE(empty_index.overlap(0, 100) == vec<u32>{2});
+        REQUIRE(empty_index.at(10).empty());
+        REQUIRE(empty_index.overlap_batch(vec<i32>{0, 5}, vec<i32>{25, 11}).indices.empty());
+    }
+    SECTION("Batched queries") {
+        const vec<i32> times{0, 50, 100, 500};
+        const auto     batch = index.at_batch(times);
+        REQUIRE(batch.offsets.size() == times.size() + 1);
+        for (size_t i = 0; i < times.size(); ++i) {
+            const vec<u32> row(
+                batch.indices.begin() + static_cast<ptrdiff_t>(batch.offsets[i]),
+                batch.indices.begin() + static_cast<ptrdiff_t>(batch.offsets[i + 1])
+            );
+            REQUIRE(row == index.at(times[i]));
+        }
+        REQUIRE_THROWS(index.overlap_batch(times, vec<i32>{1}));
+    }
+}
+
+#endif   // SYMUSIC_TEST_INTERVAL_HPP
@@ -5,3 +5,24 @@
 //
 
 #include "test_time_events.hpp"
+#include "test_compact.hpp"
+#include "test_cow.hpp"
+#include "test_interval.hpp"
+#include "test_clip.hpp"
+#include "test_text.hpp"
+#include "test_memory.hpp"
+#include "test_shift.hpp"
+#include "test_pipeline.hpp"
+#include "test_predicate.hpp"
+#include "test_sort_key.hpp"
+#include "test_time_warp.hpp"
+#include "test_quantize.hpp"
+#include "test_sustain.hpp"
+#include "test_overlap.hpp"
+#include "test_merge_split.hpp"
+#include "test_concat.hpp"
+#include "test_segment.hpp"
+#include "test_beat_grid.hpp"
+#include "test_tempo_map.hpp"
+#include "test_conversion.hpp"
+#include "test_parallel.hpp"
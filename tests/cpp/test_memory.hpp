@@ -0,0 +1,111 @@
+#pragma once
+#ifndef SYMUSIC_TEST_MEMORY_HPP
+#define SYMUSIC_TEST_MEMORY_HPP
+
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+using namespace symusic;
+
+TEST_CASE("Test memory usage", "[symusic][memory]") {
+    Score<Tick> score(480);
+    auto        track = std::make_shared<Track<Tick>>("piano", 0, false);
+    for (i32 i = 0; i < 100; ++i) track->notes->emplace_back(i * 10, 10, 60, 80);
+    track->lyrics->emplace_back(0, std::string(100, 'a'));
+    score.tracks->push_back(track);
+    score.tempos->emplace_back(0, 500000);
+
+    const auto usage = score.memory_usage();
+    REQUIRE(usage.notes >= 100 * sizeof(Note<Tick>));
+    REQUIRE(usage.lyrics >= 100);
+    REQUIRE(track->memory_usage().notes == usage.notes);
+    // the lists of the track share one block, counted once
+    REQUIRE(track->memory_usage().other
+            == sizeof(Track<Tick>) + details::control_block_size
+                   + details::string_memory_usage(track->name));
+
+    // a block is counted as a whole, even when a list is moved out of it
+    Track<Tick> partial("piano", 0, false);
+    const auto  pooled_other = partial.memory_usage().other;
+    partial.notes            = std::make_shared<pyvec<Note<Tick>>>();
+    REQUIRE(
+        partial.memory_usage().other
+        == pooled_other + sizeof(pyvec<Note<Tick>>) + details::control_block_size
+    );
+
+    // the cached tempo map is counted
+    const auto before_map = score.memory_usage().other;
+    REQUIRE(score.tempo_map()->memory_usage() > sizeof(TempoMap<Tick>));
+    REQUIRE(
+        score.memory_usage().other
+        == before_map + details::control_block_size + score.tempo_map()->memory_usage()
+    );
+
+    // the reserved slack is counted, and released by shrink_to_fit
+    track->controls->reserve(1000);
+    const auto reserved = track->memory_usage().controls;
+    REQUIRE(reserved >= 1000 * sizeof(ControlChange<Tick>));
+    track->shrink_to_fit();
+    REQUIRE(track->memory_usage().controls < reserved);
+
+    // shrinking keeps the content, and the exposed lists are untouched
+    const Score<Tick> origin = score.deepcopy();
+    track->expose(Track<Tick>::NOTES);
+    const auto notes = track->notes;
+    track->clip_inplace(0, 500);
+    score.shrink_to_fit();
+    REQUIRE(track->notes == notes);
+    REQUIRE(score == origin.clip(0, 500));
+}
+
+TEST_CASE("Test pooled event lists", "[symusic][memory]") {
+    Track<Tick> track("piano", 0, false);
+    track.notes->emplace_back(0, 10, 60, 80);
+    // all the lists live in one block
+    REQUIRE(track.own_refs(track.notes) == 5);
+    REQUIRE(track.notes.use_count() == 5);
+
+    // a copy-on-write copy shares the block, and detaches it as a whole on write
+    auto copy = track.cow_copy();
+    copy.detach(Track<Tick>::NOTES);
+    copy.notes->emplace_back(10, 10, 62, 80);
+    REQUIRE(track.notes->size() == 1);
+    REQUIRE(copy.notes->size() == 2);
+    REQUIRE(copy.own_refs(copy.notes) == 5);
+    REQUIRE(track.notes.use_count() == 5);
+
+    // shrinking rebuilds the block, and frees the old one
+    track.controls->reserve(1024);
+    std::weak_ptr<void> block = track.controls;
+    const auto before = track.memory_usage().total();
+    track.shrink_to_fit();
+    REQUIRE(block.expired());
+    REQUIRE(track.own_refs(track.notes) == 5);
+    REQUIRE(track.memory_usage().total() < before);
+
+    // a list handed out or replaced moves all the lists out of the block
+    block = track.notes;
+    track.expose(Track<Tick>::NOTES);
+    REQUIRE(block.expired());
+    REQUIRE(track.pooled() == 0);
+    REQUIRE(track.notes->size() == 1);
+    REQUIRE(copy.pooled() == Track<Tick>::ALL);
+    block = copy.notes;
+    copy.unpool();
+    copy.notes = std::make_shared<pyvec<Note<Tick>>>();
+    REQUIRE(block.expired());
+    REQUIRE(copy.controls->empty());
+
+    Score<Tick> score(480);
+    REQUIRE(score.own_refs(score.tempos) == 4);
+    REQUIRE(!details::same_owner(score.tracks, score.tempos));
+    score.tempos->reserve(1024);
+    block = score.tempos;
+    score.shrink_to_fit();
+    REQUIRE(block.expired());
+    const Score<Tick> other{
+        480, std::make_shared<vec<shared<Track<Tick>>>>(), {}, {}, pyvec<Tempo<Tick>>{}, {}
+    };
+    REQUIRE(other.own_refs(other.tempos) == 4);
+}
+
+#endif   // SYMUSIC_TEST_MEMORY_HPP
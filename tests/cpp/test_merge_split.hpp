@@ -0,0 +1,85 @@
+#pragma once
+#ifndef SYMUSIC_TEST_MERGE_SPLIT_HPP
+#define SYMUSIC_TEST_MERGE_SPLIT_HPP
+
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+using namespace symusic;
+
+TEST_CASE("Test merge and split tracks", "[symusic][merge]") {
+    vec<shared<Track<Tick>>> tracks;
+    for (u8 k = 0; k < 3; ++k) {
+        auto track = std::make_shared<Track<Tick>>("track" + std::to_string(k), k, false);
+        for (i32 i = 0; i < 50; ++i) {
+            track->notes->emplace_back(i * (k + 2), 10, 40 + k * 20 + i % 10, 100);
+        }
+        track->controls->emplace_back(k * 7, 64, 127);
+        tracks.push_back(track);
+    }
+    // an unsorted track
+    std::reverse(tracks[2]->notes->begin(), tracks[2]->notes->end());
+
+    SECTION("Merge") {
+        const auto merged = ops::merge_tracks<Tick>(tracks);
+        REQUIRE(merged.name == "track0");
+        REQUIRE(merged.note_num() == 150);
+        REQUIRE(merged.is_time_sorted(Track<Tick>::ALL));
+
+        // the reversed track is sorted stably, and ties keep the order of the tracks
+        auto by_time = [](const auto& x, const auto& y) { return x.time < y.time; };
+        vec<Note<Tick>> expected;
+        for (const auto& track : tracks) {
+            auto notes = track->notes->collect();
+            std::stable_sort(notes.begin(), notes.end(), by_time);
+            expected.insert(expected.end(), notes.begin(), notes.end());
+        }
+        std::stable_sort(expected.begin(), expected.end(), by_time);
+        REQUIRE(merged.notes->collect() == expected);
+        REQUIRE((*merged.controls)[1].time == 7);
+
+        auto list = tracks;
+        ops::merge_tracks_inplace(list, {2, 0});
+        REQUIRE(list.size() == 2);
+        REQUIRE(list[0]->note_num() == 100);
+        REQUIRE(list[1] == tracks[1]);
+        REQUIRE_THROWS_AS(ops::merge_tracks_inplace(list, {5}), std::out_of_range);
+    }
+    SECTION("Split") {
+        const auto parts = ops::split_track(*tracks[0], "pitch", {0, 44, 128});
+        REQUIRE(parts.size() == 2);
+        REQUIRE(parts[0].note_num() == 20);
+        REQUIRE(parts[1].note_num() == 30);
+        for (const auto& note : *parts[0].notes) REQUIRE(note.pitch < 44);
+        // the parts hold fresh lists, which don't keep the ones of the track alive
+        REQUIRE(*parts[0].controls == *tracks[0]->controls);
+        REQUIRE(!details::same_owner(parts[0].controls, tracks[0]->controls));
+        REQUIRE(parts[0].own_refs(parts[0].notes) == 5);
+        // the other events stay in the first part, and merge back once
+        REQUIRE(parts[1].controls->empty());
+        REQUIRE(parts[1].name == tracks[0]->name);
+        const auto merged = ops::merge_tracks<Tick>(vec<shared<Track<Tick>>>{
+            std::make_shared<Track<Tick>>(parts[0]), std::make_shared<Track<Tick>>(parts[1])
+        });
+        REQUIRE(*merged.controls == *tracks[0]->controls);
+        REQUIRE(std::is_sorted(parts[1].notes->begin(), parts[1].notes->end(), [](const auto& a, const auto& b) {
+            return a.time < b.time;
+        }));
+        REQUIRE_THROWS_AS(ops::split_track(*tracks[0], "pitch", {10, 0}), std::invalid_argument);
+        REQUIRE_THROWS_AS(ops::split_track(*tracks[0], "channel", {0, 10}), std::invalid_argument);
+
+        auto list = tracks;
+        ops::split_track_inplace(list, 1, "velocity", {0, 64, 128});
+        // the part below 64 has no notes, but keeps the controls
+        REQUIRE(list.size() == 4);
+        REQUIRE(list[1]->note_num() == 0);
+        REQUIRE(*list[1]->controls == *tracks[1]->controls);
+        REQUIRE(list[2]->note_num() == 50);
+        REQUIRE(list[3] == tracks[2]);
+        // a part with nothing is dropped
+        ops::split_track_inplace(list, 2, "time", {1000, 2000});
+        REQUIRE(list.size() == 3);
+        REQUIRE(list[2] == tracks[2]);
+    }
+}
+
+#endif   // SYMUSIC_TEST_MERGE_SPLIT_HPP
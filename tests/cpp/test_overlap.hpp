@@ -0,0 +1,73 @@
+#pragma once
+#ifndef SYMUSIC_TEST_OVERLAP_HPP
+#define SYMUSIC_TEST_OVERLAP_HPP
+
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+using namespace symusic;
+
+TEST_CASE("Test overlap resolution", "[symusic][overlap]") {
+    Track<Tick> track("piano", 0, false);
+    track.notes->emplace_back(0, 100, 60, 100);
+    track.notes->emplace_back(50, 200, 60, 90);    // overlaps the first one
+    track.notes->emplace_back(0, 100, 60, 80);     // duplicate of the first one
+    track.notes->emplace_back(0, 100, 64, 100);    // other pitch
+    track.notes->emplace_back(300, 50, 60, 100);   // no overlap
+    const auto origin = track.deepcopy();
+
+    SECTION("Dedup") {
+        auto deduped = track.deepcopy();
+        const auto stats = deduped.dedup_notes_inplace();
+        REQUIRE(stats.removed == 1);
+        REQUIRE(stats.truncated == 0);
+        REQUIRE(deduped.notes->collect() == vec<Note<Tick>>{
+            {0, 100, 60, 100}, {50, 200, 60, 90}, {0, 100, 64, 100}, {300, 50, 60, 100}
+        });
+        REQUIRE(deduped.dedup_notes_inplace().removed == 0);
+        REQUIRE(track == origin);
+    }
+    SECTION("Keep first") {
+        auto ans = track.deepcopy();
+        const auto stats = ans.resolve_overlaps_inplace(OverlapPolicy::KEEP_FIRST);
+        REQUIRE(stats.removed == 2);
+        REQUIRE(ans.notes->collect() == vec<Note<Tick>>{
+            {0, 100, 60, 100}, {0, 100, 64, 100}, {300, 50, 60, 100}
+        });
+    }
+    SECTION("Keep longest") {
+        const auto ans = track.resolve_overlaps(OverlapPolicy::KEEP_LONGEST);
+        REQUIRE(ans.notes->collect() == vec<Note<Tick>>{
+            {50, 200, 60, 90}, {0, 100, 64, 100}, {300, 50, 60, 100}
+        });
+        REQUIRE(track == origin);
+
+        // on ties, the later note is removed
+        Track<Tick> tie("piano", 0, false);
+        tie.notes->emplace_back(0, 100, 60, 80);
+        tie.notes->emplace_back(50, 100, 60, 90);
+        const auto tied = tie.resolve_overlaps(OverlapPolicy::KEEP_LONGEST);
+        REQUIRE(tied.notes->collect() == vec<Note<Tick>>{{0, 100, 60, 80}});
+    }
+    SECTION("Truncate previous") {
+        auto ans = track.deepcopy();
+        const auto stats = ans.resolve_overlaps_inplace(OverlapPolicy::TRUNCATE_PREVIOUS);
+        // the first note is removed since the duplicate starts with it,
+        // and the duplicate is truncated to the onset of the third one
+        REQUIRE(stats.removed == 1);
+        REQUIRE(stats.truncated == 1);
+        REQUIRE(ans.notes->collect() == vec<Note<Tick>>{
+            {50, 200, 60, 90}, {0, 50, 60, 80}, {0, 100, 64, 100}, {300, 50, 60, 100}
+        });
+    }
+    SECTION("Score") {
+        Score<Tick> score(480);
+        score.tracks->push_back(std::make_shared<Track<Tick>>(track.deepcopy()));
+        score.tracks->push_back(std::make_shared<Track<Tick>>(track.deepcopy()));
+        auto       copy  = score.resolve_overlaps();
+        const auto stats = score.resolve_overlaps_inplace();
+        REQUIRE(stats.removed == 4);
+        REQUIRE(copy == score);
+    }
+}
+
+#endif   // SYMUSIC_TEST_OVERLAP_HPP
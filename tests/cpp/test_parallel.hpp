@@ -0,0 +1,83 @@
+#pragma once
+#ifndef SYMUSIC_TEST_PARALLEL_HPP
+#define SYMUSIC_TEST_PARALLEL_HPP
+
+#include <atomic>
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+#include "test_scores.hpp"
+using namespace symusic;
+
+TEST_CASE("Test parallel execution", "[symusic][parallel]") {
+    const auto score = test_scores::parallel();
+    REQUIRE(details::use_parallel(*score.tracks, ExecPolicy::PARALLEL));
+    REQUIRE_FALSE(details::use_parallel(*score.tracks, ExecPolicy::SEQUENTIAL));
+
+    SECTION("Score operations") {
+        constexpr auto seq = ExecPolicy::SEQUENTIAL;
+        constexpr auto par = ExecPolicy::PARALLEL;
+        REQUIRE(score.sort(false, par) == score.sort(false, seq));
+        REQUIRE(score.clip(10000, 90000, true, par) == score.clip(10000, 90000, true, seq));
+        REQUIRE(score.shift_time(-100, par) == score.shift_time(-100, seq));
+        REQUIRE(score.shift(10, 2, -3, false, par) == score.shift(10, 2, -3, false, seq));
+        REQUIRE(convert<Second>(score, 0.f, par) == convert<Second>(score, 0.f, seq));
+        REQUIRE(convert<Quarter>(score, 0, 96000, 0.f, par) == convert<Quarter>(score, 0, 96000));
+        REQUIRE(resample(score, 96, 1, par) == resample(score, 96, 1, seq));
+        const vec<i32> original{0, 100000, 300000};
+        const vec<i32> adjusted{0, 50000, 250000};
+        REQUIRE(ops::adjust_time(score, original, adjusted, par) == ops::adjust_time(score, original, adjusted));
+
+        Score<Tick> inplace = score.deepcopy();
+        inplace.sort_inplace(false, par);
+        REQUIRE(inplace == score.sort());
+        // the exception of a track is rethrown by the caller, before any track is shifted
+        REQUIRE_THROWS_AS(inplace.shift_pitch_inplace(100, false, par), std::range_error);
+        REQUIRE_THROWS_AS(inplace.shift_inplace(10, 0, 100, false, par), std::range_error);
+        REQUIRE(inplace == score.sort());
+    }
+
+    SECTION("Serial fallbacks") {
+        // a track held twice couldn't be modified by two threads
+        Score<Tick> twice = score.deepcopy();
+        twice.tracks->push_back(twice.tracks->front());
+        REQUIRE_FALSE(details::use_parallel(*twice.tracks, ExecPolicy::PARALLEL));
+        twice.shift_time_inplace(10, ExecPolicy::PARALLEL);
+        REQUIRE(twice.tracks->front()->notes->front().time == score.tracks->front()->notes->front().time + 20);
+        // and so do distinct tracks sharing lists
+        Score<Tick> shared = score.deepcopy();
+        shared.tracks->push_back(std::make_shared<Track<Tick>>(shared.tracks->front()->cow_copy()));
+        REQUIRE_FALSE(details::use_parallel(*shared.tracks, ExecPolicy::PARALLEL));
+        shared.shift_time_inplace(10, ExecPolicy::PARALLEL);
+        REQUIRE(*shared.tracks->back() == *shared.tracks->front());
+        REQUIRE(shared.tracks->back()->notes != shared.tracks->front()->notes);
+        // small scores stay serial
+        REQUIRE_FALSE(details::use_parallel(*score.clip(0, 4800).tracks, ExecPolicy::PARALLEL));
+    }
+
+    SECTION("ThreadPool") {
+        std::atomic<size_t> count{0};
+        {
+            ThreadPool pool(3);
+            REQUIRE(pool.size() == 3);
+            for (size_t i = 0; i < 100; ++i) pool.submit([&count] { ++count; });
+        }   // the queued tasks are done before the workers are joined
+        REQUIRE(count == 100);
+    }
+
+    SECTION("parallel_for") {
+        std::atomic<size_t> sum{0};
+        details::parallel_for(1000, true, [&sum](const size_t i) {
+            // nested calls don't wait on the pool
+            details::parallel_for(10, true, [&sum, i](const size_t j) { sum += i * 10 + j; });
+        });
+        REQUIRE(sum == 9999 * 10000 / 2);
+        REQUIRE_THROWS_AS(
+            details::parallel_for(100, true, [](const size_t i) {
+                if (i == 42) throw std::runtime_error("42");
+            }),
+            std::runtime_error
+        );
+    }
+}
+
+#endif   // SYMUSIC_TEST_PARALLEL_HPP
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef SYMUSIC_TEST_PIPELINE_HPP
+#define SYMUSIC_TEST_PIPELINE_HPP
+
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+using namespace symusic;
+
+TEST_CASE("Test pipeline", "[symusic][pipeline]") {
+    Score<Tick> score(480);
+    auto        track = std::make_shared<Track<Tick>>("piano", 0, false);
+    for (i32 i = 31; i >= 0; --i) {
+        track->notes->emplace_back(i * 10, 15, 40 + i, 60 + i);
+        track->controls->emplace_back(i * 10, 64, 127);
+    }
+    track->pedals->emplace_back(50, 100);
+    score.tracks->push_back(track);
+    score.tempos->emplace_back(0, 500000);
+    score.tempos->emplace_back(100, 400000);
+    score.markers->emplace_back(120, "verse");
+    const Score<Tick> origin = score.deepcopy();
+
+    SECTION("Same as the step by step version") {
+        Pipeline<Tick> pipeline;
+        pipeline.clip(50, 250).shift_time(-50).shift_pitch(2).filter_velocity(70, 127).sort();
+        REQUIRE(pipeline.size() == 5);
+
+        const auto expected = score.clip(50, 250).shift_time(-50).shift_pitch(2).sort();
+        auto       fused    = pipeline.apply(score);
+        REQUIRE(score == origin);
+        REQUIRE((*fused.tempos)[0].time == 0);
+        REQUIRE((*fused.tempos)[0].qpm() == (*expected.tempos)[0].qpm());
+
+        // filter_velocity has no step by step counterpart, apply it to the expected notes
+        auto expected_track = (*expected.tracks)[0]->deepcopy();
+        expected_track.notes->filter([](const auto& note) { return note.velocity >= 70; });
+        REQUIRE(*(*fused.tracks)[0] == expected_track);
+        REQUIRE(fused.is_time_sorted(Score<Tick>::ALL));
+        REQUIRE(*fused.markers == *expected.markers);
+    }
+    SECTION("Overflow and saturate") {
+        Pipeline<Tick> pipeline;
+        pipeline.shift_pitch(100);
+        REQUIRE_THROWS_AS(pipeline.apply(*track), std::range_error);
+        REQUIRE(*track == *(*origin.tracks)[0]);
+
+        Pipeline<Tick> saturated;
+        saturated.filter_duration(0, 20).shift_pitch(100, true);
+        const auto ans = saturated.apply(*track);
+        REQUIRE(ans.notes->size() == 32);
+        REQUIRE(ans.pedals->empty());
+        REQUIRE((*ans.notes)[0].pitch == 127);
+    }
+}
+
+#endif   // SYMUSIC_TEST_PIPELINE_HPP
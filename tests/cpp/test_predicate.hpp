@@ -0,0 +1,56 @@
+#pragma once
+#ifndef SYMUSIC_TEST_PREDICATE_HPP
+#define SYMUSIC_TEST_PREDICATE_HPP
+
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+using namespace symusic;
+
+TEST_CASE("Test predicate", "[symusic][predicate]") {
+    pyvec<Note<Tick>> notes;
+    for (i32 i = 0; i < 1000; ++i) notes.emplace_back(i, i % 50, i % 128, i % 100);
+
+    SECTION("Mask and filter") {
+        const Predicate<Note<Tick>> pred("pitch in [21, 108) and velocity > 10 and duration >= 30");
+        const auto                  mask = pred.mask(notes);
+        size_t                      num  = 0;
+        for (size_t i = 0; i < notes.size(); ++i) {
+            const auto& note   = notes[i];
+            const bool  expect = note.pitch >= 21 && note.pitch < 108 && note.velocity > 10
+                                && note.duration >= 30;
+            REQUIRE(mask[i] == expect);
+            REQUIRE(pred(note) == expect);
+            num += expect;
+        }
+        pred.filter_inplace(notes);
+        REQUIRE(notes.size() == num);
+        REQUIRE(std::is_sorted(notes.begin(), notes.end(), [](const auto& a, const auto& b) {
+            return a.time < b.time;
+        }));
+    }
+    SECTION("Syntax") {
+        const Predicate<Note<Tick>> pred("not (time < 10 || 990 <= time) && !(end == 22)");
+        const auto                  mask = pred.mask(notes);
+        REQUIRE(mask[9] == 0);
+        REQUIRE(mask[10] == 1);
+        REQUIRE(mask[11] == 0);   // end = 11 + 11
+        REQUIRE(mask[989] == 1);
+        REQUIRE(mask[990] == 0);
+        REQUIRE(Predicate<Note<Tick>>("velocity in (98, 99]").mask(notes)[99] == 1);
+        REQUIRE_THROWS_AS(Predicate<Note<Tick>>("pitch >"), std::invalid_argument);
+        REQUIRE_THROWS_AS(Predicate<Note<Tick>>("number > 3"), std::invalid_argument);
+        REQUIRE_THROWS_AS(Predicate<Note<Tick>>("pitch > 3 pitch"), std::invalid_argument);
+    }
+    SECTION("Tracks") {
+        vec<shared<Track<Tick>>> tracks;
+        for (u8 i = 0; i < 4; ++i) {
+            tracks.push_back(std::make_shared<Track<Tick>>("", i, i % 2 == 1));
+            for (u8 j = 0; j < i; ++j) tracks.back()->notes->emplace_back(j, 1, 60, 80);
+        }
+        Predicate<Track<Tick>>("is_drum == 0 and note_num > 0").filter_inplace(tracks);
+        REQUIRE(tracks.size() == 1);
+        REQUIRE(tracks[0]->program == 2);
+    }
+}
+
+#endif   // SYMUSIC_TEST_PREDICATE_HPP
@@ -0,0 +1,73 @@
+#pragma once
+#ifndef SYMUSIC_TEST_QUANTIZE_HPP
+#define SYMUSIC_TEST_QUANTIZE_HPP
+
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+using namespace symusic;
+
+TEST_CASE("Test quantize", "[symusic][quantize]") {
+    Track<Tick> track("piano", 0, false);
+    track.notes->emplace_back(-50, 100, 60, 100);
+    track.notes->emplace_back(10, 20, 60, 100);
+    track.notes->emplace_back(55, 130, 62, 100);
+    track.notes->emplace_back(130, 100, 64, 100);
+    track.controls->emplace_back(70, 64, 127);
+    track.pedals->emplace_back(55, 130);
+    const auto origin = track.deepcopy();
+
+    SECTION("Modes") {
+        const auto both = ops::quantize(track, 120);
+        REQUIRE(both.notes->collect() == vec<Note<Tick>>{
+            {0, 0, 60, 100}, {0, 0, 60, 100}, {0, 240, 62, 100}, {120, 120, 64, 100}
+        });
+        REQUIRE((*both.controls)[0].time == 120);
+        REQUIRE((*both.pedals)[0] == Pedal<Tick>(0, 240));
+
+        const auto onset = ops::quantize(track, 120, ops::QuantizeMode::ONSET, 30);
+        REQUIRE(onset.notes->collect() == vec<Note<Tick>>{
+            {0, 100, 60, 100}, {0, 30, 60, 100}, {0, 130, 62, 100}, {120, 100, 64, 100}
+        });
+
+        const auto offset = ops::quantize(track, 120, ops::QuantizeMode::OFFSET, 10);
+        REQUIRE(offset.notes->collect() == vec<Note<Tick>>{
+            {-50, 50, 60, 100}, {10, 10, 60, 100}, {55, 185, 62, 100}, {130, 110, 64, 100}
+        });
+        REQUIRE(track == origin);
+    }
+    SECTION("Swing and fractional grid") {
+        // odd grid points at 180 instead of 120
+        const auto swung = ops::quantize(track, 120, ops::QuantizeMode::ONSET, 0, 0.5);
+        REQUIRE((*swung.notes)[3].time == 180);
+        REQUIRE((*swung.notes)[2].time == 0);
+
+        const auto septuplet = ops::quantize(track, 480. / 7, ops::QuantizeMode::ONSET);
+        REQUIRE((*septuplet.notes)[2].time == 69);
+        REQUIRE((*septuplet.notes)[3].time == 137);
+
+        REQUIRE_THROWS_AS(ops::quantize(track, 0), std::invalid_argument);
+        REQUIRE_THROWS_AS(ops::quantize(track, 120, ops::QuantizeMode::BOTH, 0, 1), std::invalid_argument);
+    }
+    SECTION("Score") {
+        Score<Tick> score(480);
+        score.tracks->push_back(std::make_shared<Track<Tick>>(track.deepcopy()));
+        score.tempos->emplace_back(130, 500000);
+        score.time_sorted = Score<Tick>::ALL;
+        ops::quantize_inplace(score, 4);
+        REQUIRE(*(*score.tracks)[0] == ops::quantize(track, 120));
+        REQUIRE((*score.tempos)[0].time == 120);
+        REQUIRE(score.is_time_sorted(Score<Tick>::ALL));
+
+        Score<Quarter> quarter(480);
+        auto q_track = std::make_shared<Track<Quarter>>("piano", 0, false);
+        q_track->notes->emplace_back(0.3f, 0.4f, 60, 100);
+        quarter.tracks->push_back(q_track);
+        ops::quantize_inplace(quarter, 4);
+        REQUIRE((*q_track->notes)[0] == Note<Quarter>(0.25f, 0.5f, 60, 100));
+
+        Score<Second> second(480);
+        REQUIRE_THROWS_AS(ops::quantize_inplace(second, 4), std::invalid_argument);
+    }
+}
+
+#endif   // SYMUSIC_TEST_QUANTIZE_HPP
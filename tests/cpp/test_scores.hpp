@@ -0,0 +1,75 @@
+#pragma once
+#ifndef SYMUSIC_TEST_SCORES_HPP
+#define SYMUSIC_TEST_SCORES_HPP
+
+#include "symusic.h"
+using namespace symusic;
+
+// scores shared by the tests, all the test files are included into one translation unit
+namespace test_scores {
+// a piano and a drum track in 3/4, at the given tpq, tempo and piano program
+inline shared<Score<Tick>> concat(const i32 tpq, const i32 mspq, const u8 program) {
+    auto score = std::make_shared<Score<Tick>>(tpq);
+    score->tempos->emplace_back(0, mspq);
+    score->time_signatures->emplace_back(0, 3, 4);
+    auto track = std::make_shared<Track<Tick>>("piano", program, false);
+    for (i32 i = 0; i < 4; ++i) track->notes->emplace_back(i * tpq, tpq, 60 + i, 100);
+    score->tracks->push_back(track);
+    score->tracks->push_back(std::make_shared<Track<Tick>>("drums", 0, true));
+    (*score->tracks)[1]->notes->emplace_back(0, 10, 36, 100);
+    return score;
+}
+
+// 2 bars of 4/4 and 4 bars of 3/4 at 480 tpq, a note on every quarter
+inline Score<Tick> segment() {
+    Score<Tick> score(480);
+    score.time_signatures->emplace_back(0, 4, 4);
+    score.time_signatures->emplace_back(3840, 3, 4);
+    score.tempos->emplace_back(0, 500000);
+    score.tempos->emplace_back(960, 250000);
+    score.key_signatures->emplace_back(0, 2, 0);
+    score.markers->emplace_back(1920, "B");
+    auto track = std::make_shared<Track<Tick>>("piano", 0, false);
+    for (i32 i = 0; i < 20; ++i) track->notes->emplace_back(i * 480, 720, 60 + i, 100);
+    track->controls->emplace_back(100, 64, 127);
+    track->controls->emplace_back(5000, 64, 0);
+    score.tracks->push_back(track);
+    score.tracks->push_back(std::make_shared<Track<Tick>>("empty", 1, false));
+    return score;
+}
+
+// 3 tracks with notes, a control and a pedal, and a tempo change at 1920
+inline Score<Tick> conversion() {
+    Score<Tick> score(480);
+    score.tempos->emplace_back(0, 500000);
+    score.tempos->emplace_back(1920, 250000);
+    score.time_signatures->emplace_back(0, 4, 4);
+    score.markers->emplace_back(2000, "B");
+    for (u8 program = 0; program < 3; ++program) {
+        auto track = std::make_shared<Track<Tick>>("track", program, false);
+        for (i32 i = 0; i < 32; ++i) track->notes->emplace_back(i * 240 + program, 360, 60 + program, 100);
+        track->controls->emplace_back(100, 64, 127);
+        track->pedals->emplace_back(500, 2000);
+        score.tracks->push_back(track);
+    }
+    return score;
+}
+
+// 8 tracks of 5000 notes, more than parallel_threshold events, in reverse order
+inline Score<Tick> parallel() {
+    Score<Tick> score(480);
+    score.tempos->emplace_back(0, 500000);
+    score.tempos->emplace_back(96000, 400000);
+    for (u8 program = 0; program < 8; ++program) {
+        auto track = std::make_shared<Track<Tick>>("track", program, false);
+        for (i32 i = 5000; i > 0; --i) {
+            track->notes->emplace_back(i * 48 + program, 60 + i % 7, 40 + i % 12, 64 + i % 32);
+        }
+        track->controls->emplace_back(1000, 64, 127);
+        score.tracks->push_back(track);
+    }
+    return score;
+}
+}   // namespace test_scores
+
+#endif   // SYMUSIC_TEST_SCORES_HPP
@@ -0,0 +1,80 @@
+#pragma once
+#ifndef SYMUSIC_TEST_SEGMENT_HPP
+#define SYMUSIC_TEST_SEGMENT_HPP
+
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+#include "test_scores.hpp"
+using namespace symusic;
+
+TEST_CASE("Test segment", "[symusic][segment]") {
+    const auto score = test_scores::segment();
+
+    SECTION("Each window is a clip of the score") {
+        const auto parts = ops::segment(score, 1920, 960, ops::SegmentUnit::TIME);
+        // windows start at 0, 960, ..., 9600, before the end 9840
+        REQUIRE(parts.size() == 11);
+        for (size_t k = 0; k < parts.size(); ++k) {
+            const i32 lo = static_cast<i32>(k) * 960;
+            REQUIRE(parts[k] == score.clip(lo, lo + 1920).shift_time(-lo));
+        }
+        const auto unshifted = ops::segment(score, 1920, 960, ops::SegmentUnit::TIME, false, false);
+        REQUIRE(unshifted[3] == score.clip(2880, 4800));
+    }
+
+    SECTION("Unsorted lists") {
+        auto shuffled = score.deepcopy();
+        auto& notes   = *(*shuffled.tracks)[0]->notes;
+        std::reverse(notes.begin(), notes.end());
+        shuffled.time_sorted = 0;
+        (*shuffled.tracks)[0]->time_sorted = 0;
+        const auto parts = ops::segment(shuffled, 1920, 1920, ops::SegmentUnit::TIME);
+        REQUIRE(parts.size() == 6);
+        REQUIRE(parts[1] == score.clip(1920, 3840).shift_time(-1920));
+    }
+
+    SECTION("Truncate notes") {
+        const auto parts = ops::segment(score, 1000, 1000, ops::SegmentUnit::TIME, true);
+        for (const auto& part : parts) {
+            for (const auto& note : *(*part.tracks)[0]->notes) REQUIRE(note.end() <= 1000);
+        }
+        // the note at 480 ends at 1200 and is cut at 1000
+        REQUIRE((*(*parts[0].tracks)[0]->notes)[1].duration == 520);
+    }
+
+    SECTION("Bars") {
+        // bars start at 0, 1920, 3840, 5280, 6720, 8160, 9600
+        const auto parts = ops::segment(score, 2, 1, ops::SegmentUnit::BAR, false, false);
+        REQUIRE(parts.size() == 7);
+        REQUIRE(parts[0] == score.clip(0, 3840));
+        REQUIRE(parts[1] == score.clip(1920, 5280));
+        REQUIRE(parts[2] == score.clip(3840, 6720));
+        REQUIRE(parts[6] == score.clip(9600, 12480));
+        // the time signature in effect is moved to the start of the window
+        REQUIRE(parts[3].time_signatures->front().time == 5280);
+        REQUIRE(parts[3].time_signatures->front().numerator == 3);
+        REQUIRE_THROWS_AS(ops::segment(score, 1.5, 1, ops::SegmentUnit::BAR), std::invalid_argument);
+        // the same bars in seconds
+        const auto seconds = ops::segment(convert<Second>(score), 2, 1, ops::SegmentUnit::BAR);
+        REQUIRE(seconds.size() == 7);
+        REQUIRE((*seconds[2].tracks)[0]->note_num() == (*parts[2].tracks)[0]->note_num());
+    }
+
+    SECTION("Seconds") {
+        // 960 ticks of 0.5s quarters, then 0.25s quarters: 1s at 960 ticks, 2s at 2880 ticks
+        const auto parts = ops::segment(score, 1, 1, ops::SegmentUnit::SECOND, false, false);
+        REQUIRE(parts[0] == score.clip(0, 960));
+        REQUIRE(parts[1] == score.clip(960, 2880));
+        REQUIRE(parts[2] == score.clip(2880, 4800));
+        // the score ends at 9840 ticks, i.e. 1 + 8880 / 1920 = 5.625s
+        REQUIRE(parts.size() == 6);
+    }
+
+    SECTION("Invalid arguments and empty scores") {
+        REQUIRE_THROWS_AS(ops::segment(score, 0, 1), std::invalid_argument);
+        REQUIRE_THROWS_AS(ops::segment(score, 1, -1), std::invalid_argument);
+        REQUIRE(ops::segment(Score<Tick>(480), 480, 480).empty());
+    }
+}
+
+#endif   // SYMUSIC_TEST_SEGMENT_HPP
@@ -0,0 +1,65 @@
+#pragma once
+#ifndef SYMUSIC_TEST_SHIFT_HPP
+#define SYMUSIC_TEST_SHIFT_HPP
+
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+using namespace symusic;
+
+TEST_CASE("Test shift kernels", "[symusic][shift]") {
+    Track<Tick> track("piano", 0, false);
+    for (i32 i = 0; i < 16; ++i) {
+        track.notes->emplace_back(i * 10, 10, 60 + i, 100 + i);
+        track.controls->emplace_back(i * 10, 64, 127);
+    }
+    const Track<Tick> origin = track.deepcopy();
+
+    SECTION("Overflow throws before modifying") {
+        REQUIRE_THROWS_AS(track.shift_pitch_inplace(60), std::range_error);
+        REQUIRE_THROWS_AS(track.shift_velocity_inplace(-101), std::range_error);
+        REQUIRE_THROWS_AS(track.shift_inplace(10, 2, 20), std::range_error);
+        REQUIRE(track == origin);
+    }
+    SECTION("A score throws before modifying any track") {
+        Score<Tick> score(480);
+        score.tracks->push_back(std::make_shared<Track<Tick>>(track.deepcopy()));
+        auto high = std::make_shared<Track<Tick>>(track.deepcopy());
+        high->notes->emplace_back(0, 10, 120, 100);
+        score.tracks->push_back(high);
+        score.tempos->emplace_back(0, 500000);
+        const Score<Tick> before = score.deepcopy();
+        REQUIRE_THROWS_AS(score.shift_pitch_inplace(10), std::range_error);
+        REQUIRE_THROWS_AS(score.shift_velocity_inplace(-101), std::range_error);
+        REQUIRE_THROWS_AS(score.shift_inplace(10, 10, 0), std::range_error);
+        REQUIRE(score == before);
+    }
+    SECTION("Saturate") {
+        track.shift_pitch_inplace(60, true);
+        track.shift_velocity_inplace(-105, true);
+        REQUIRE((*track.notes)[0].pitch == 120);
+        REQUIRE((*track.notes)[15].pitch == 127);
+        REQUIRE((*track.notes)[0].velocity == 0);
+        REQUIRE((*track.notes)[15].velocity == 10);
+    }
+    SECTION("Combined shift") {
+        const auto fused = track.shift(5, -3, 2);
+        REQUIRE(fused == track.shift_time(5).shift_pitch(-3).shift_velocity(2));
+        REQUIRE(track == origin);
+
+        // only notes are copied when time is not shifted, once the lists are out of their block
+        track.unpool();
+        const auto transposed = track.shift(0, 1, 0);
+        REQUIRE(transposed.controls == track.controls);
+        REQUIRE((*transposed.notes)[0].pitch == 61);
+
+        Score<Tick> score(480);
+        score.tracks->push_back(std::make_shared<Track<Tick>>(track.deepcopy()));
+        score.tempos->emplace_back(0, 500000);
+        const auto shifted = score.shift(5, -3, 2);
+        REQUIRE(*(*shifted.tracks)[0] == fused);
+        REQUIRE((*shifted.tempos)[0].time == 5);
+        REQUIRE((*score.tempos)[0].time == 0);
+    }
+}
+
+#endif   // SYMUSIC_TEST_SHIFT_HPP
@@ -0,0 +1,100 @@
+#pragma once
+#ifndef SYMUSIC_TEST_SORT_KEY_HPP
+#define SYMUSIC_TEST_SORT_KEY_HPP
+
+#include <numeric>
+#include <random>
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+using namespace symusic;
+
+TEST_CASE("Test sort key", "[symusic][sort]") {
+    std::mt19937        rng(42);
+    pyvec<Note<Tick>>   notes;
+    pyvec<Note<Second>> float_notes;
+    for (i32 i = 0; i < 500; ++i) {
+        const i32 time = static_cast<i32>(rng() % 50) - 25;
+        const auto pitch = static_cast<i8>(rng() % 128);
+        notes.emplace_back(time, static_cast<i32>(rng() % 4), pitch, static_cast<i8>(rng() % 128));
+        float_notes.emplace_back(static_cast<f32>(time) / 7.f, 1.f, pitch, 0);
+    }
+
+    SECTION("Argsort matches a stable tuple sort") {
+        const SortKey<Note<Tick>> key({"time", "-pitch"});
+        REQUIRE(key.words() == 1);
+        auto tuple_key = [&](const u32 i) {
+            return std::make_tuple(notes[i].time, -static_cast<i32>(notes[i].pitch));
+        };
+        vec<u32> expected(notes.size());
+        std::iota(expected.begin(), expected.end(), 0);
+        std::stable_sort(expected.begin(), expected.end(), [&](u32 a, u32 b) {
+            return tuple_key(a) < tuple_key(b);
+        });
+        REQUIRE(key.argsort(notes) == expected);
+
+        // reverse keeps the equal items in their original order
+        std::stable_sort(expected.begin(), expected.end(), [&](u32 a, u32 b) {
+            return tuple_key(b) < tuple_key(a);
+        });
+        REQUIRE(key.argsort(notes, true) == expected);
+    }
+    SECTION("Multiple words and floats") {
+        const SortKey<Note<Tick>> key({"duration", "time", "velocity", "-end"});
+        REQUIRE(key.words() == 2);
+        key.sort_inplace(notes);
+        REQUIRE(key.is_sorted(notes));
+        REQUIRE(std::is_sorted(notes.begin(), notes.end(), [](const auto& a, const auto& b) {
+            return std::make_tuple(a.duration, a.time, a.velocity, -a.end())
+                   < std::make_tuple(b.duration, b.time, b.velocity, -b.end());
+        }));
+
+        const SortKey<Note<Second>> float_key({"-time"});
+        float_key.sort_inplace(float_notes);
+        REQUIRE(std::is_sorted(float_notes.begin(), float_notes.end(), [](const auto& a, const auto& b) {
+            return a.time > b.time;
+        }));
+        REQUIRE_THROWS_AS(SortKey<Note<Tick>>({"number"}), std::invalid_argument);
+        REQUIRE_THROWS_AS(SortKey<Note<Tick>>({}), std::invalid_argument);
+    }
+    SECTION("Radix sort of large lists") {
+        Track<Tick>    track("piano", 0, false);
+        Track<Quarter> quarter("piano", 0, false);
+        for (i32 i = 0; i < 5000; ++i) {
+            const i32  time  = static_cast<i32>(rng() % 100000) - 1000;
+            const i32  dur   = static_cast<i32>(rng() % 500);
+            const auto pitch = static_cast<i8>(rng() % 128);
+            track.notes->emplace_back(time, dur, pitch, static_cast<i8>(rng() % 128));
+            quarter.notes->emplace_back(static_cast<f32>(time) / 480.f, 1.f, pitch, 0);
+        }
+        auto expected = track.notes->collect();
+        std::stable_sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) {
+            return a.default_key() < b.default_key();
+        });
+        track.sort_inplace();
+        REQUIRE(track.notes->collect() == expected);
+        track.sort_inplace(true);
+        std::reverse(expected.begin(), expected.end());
+        REQUIRE(track.notes->collect() == expected);
+
+        quarter.sort_inplace();
+        REQUIRE(std::is_sorted(quarter.notes->begin(), quarter.notes->end(), [](const auto& a, const auto& b) {
+            return a.default_key() < b.default_key();
+        }));
+
+        // exposed lists are sorted in place
+        const auto* first = &(*track.notes)[0];
+        track.expose(Track<Tick>::NOTES);
+        track.sort_inplace(true);
+        REQUIRE(&(*track.notes)[0] == first);
+    }
+    SECTION("Tracks") {
+        vec<shared<Track<Tick>>> tracks;
+        for (u8 i = 0; i < 6; ++i) tracks.push_back(std::make_shared<Track<Tick>>("", i, i % 3 == 0));
+        SortKey<Track<Tick>>({"-is_drum", "program"}).sort_inplace(tracks);
+        vec<u8> programs;
+        for (const auto& track : tracks) programs.push_back(track->program);
+        REQUIRE(programs == vec<u8>{0, 3, 1, 2, 4, 5});
+    }
+}
+
+#endif   // SYMUSIC_TEST_SORT_KEY_HPP
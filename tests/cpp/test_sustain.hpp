@@ -0,0 +1,50 @@
+#pragma once
+#ifndef SYMUSIC_TEST_SUSTAIN_HPP
+#define SYMUSIC_TEST_SUSTAIN_HPP
+
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+using namespace symusic;
+
+TEST_CASE("Test apply sustain", "[symusic][sustain]") {
+    Track<Tick> track("piano", 0, false);
+    // unsorted on purpose
+    track.notes->emplace_back(300, 50, 60, 100);   // retrigger of pitch 60 under the pedal
+    track.notes->emplace_back(0, 100, 60, 100);    // sustained until the retrigger
+    track.notes->emplace_back(0, 100, 64, 100);    // sustained until the release
+    track.notes->emplace_back(0, 50, 67, 100);     // released before the pedal
+    track.notes->emplace_back(500, 100, 67, 100);  // no pedal
+    track.notes->emplace_back(700, 100, 72, 100);  // released exactly when the second pedal goes down
+    track.pedals->emplace_back(80, 320);           // [80, 400)
+    track.pedals->emplace_back(200, 100);          // overlapped, merged into the first one
+    track.pedals->emplace_back(800, 100);          // [800, 900)
+    const auto origin = track.deepcopy();
+
+    track.unpool();
+    const auto sustained = track.apply_sustain();
+    REQUIRE(sustained.notes->collect() == vec<Note<Tick>>{
+        {300, 100, 60, 100},
+        {0, 300, 60, 100},
+        {0, 400, 64, 100},
+        {0, 50, 67, 100},
+        {500, 100, 67, 100},
+        {700, 200, 72, 100},
+    });
+    REQUIRE(sustained.pedals == track.pedals);
+    REQUIRE(track == origin);
+
+    // the same result through the sorted path
+    track.sort_inplace();
+    track.time_sorted = Track<Tick>::ALL;
+    track.apply_sustain_inplace();
+    auto expected = sustained.deepcopy();
+    expected.sort_inplace();
+    REQUIRE(track.notes->collect() == expected.notes->collect());
+
+    Score<Tick> score(480);
+    score.tracks->push_back(std::make_shared<Track<Tick>>(origin.deepcopy()));
+    REQUIRE(*(*score.apply_sustain().tracks)[0] == sustained);
+    REQUIRE(*(*score.tracks)[0] == origin);
+}
+
+#endif   // SYMUSIC_TEST_SUSTAIN_HPP
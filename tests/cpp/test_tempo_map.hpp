@@ -0,0 +1,118 @@
+#pragma once
+#ifndef SYMUSIC_TEST_TEMPO_MAP_HPP
+#define SYMUSIC_TEST_TEMPO_MAP_HPP
+
+#include <cmath>
+#include <thread>
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+using namespace symusic;
+
+TEST_CASE("Test TempoMap", "[symusic][tempo_map]") {
+    // 120 qpm for 2 quarters, then 240 qpm
+    Score<Tick> score(480);
+    score.tempos->emplace_back(960, 250000);
+    score.tempos->emplace_back(0, 500000);
+
+    SECTION("Single times") {
+        const TempoMap<Tick> map(score);
+        REQUIRE(map.size() == 2);
+        REQUIRE(map.convert<Tick, Second>(960) == 1.0f);
+        REQUIRE(map.convert<Tick, Second>(1920) == 1.5f);
+        REQUIRE(map.convert<Second, Tick>(1.25f) == 1440);
+        REQUIRE(map.convert<Quarter, Second>(3.f) == 1.25f);
+        REQUIRE(map.convert<Second, Quarter>(1.5f) == 4.f);
+        REQUIRE(map.convert<Tick, Quarter>(240) == 0.5f);
+        REQUIRE(map.convert<Quarter, Tick>(0.25f) == 120);
+        // before 0, the tempo in effect at 0
+        REQUIRE(map.convert<Tick, Second>(-480) == -0.5f);
+        // no tempo is 120 qpm, and the latest one at the same time wins
+        const TempoMap<Tick> plain(pyvec<Tempo<Tick>>{}, 96);
+        REQUIRE(plain.convert<Tick, Second>(96) == 0.5f);
+        const TempoMap<Tick> doubled(pyvec<Tempo<Tick>>(vec<Tempo<Tick>>{{0, 1000000}, {0, 250000}}), 96);
+        REQUIRE(doubled.convert<Tick, Second>(96) == 0.25f);
+        // the map of a Second score
+        const TempoMap<Second> seconds(convert<Second>(score));
+        REQUIRE(seconds.convert<Second, Tick>(1.5f) == 1920);
+        REQUIRE_THROWS_AS(TempoMap<Tick>(*score.tempos, 0), std::invalid_argument);
+    }
+
+    SECTION("Batched conversion") {
+        const TempoMap<Tick> map(score);
+        const vec<i32>       sorted{-10, 0, 100, 959, 960, 961, 5000, 100000};
+        const vec<i32>       shuffled{5000, 0, 961, -10, 100000, 960, 100, 959};
+        for (const auto& times : {sorted, shuffled}) {
+            const auto ans = map.convert<Tick, Second>(std::span<const i32>(times));
+            REQUIRE(ans.size() == times.size());
+            for (size_t i = 0; i < times.size(); ++i) {
+                REQUIRE(ans[i] == map.convert<Tick, Second>(times[i]));
+                REQUIRE(map.convert<Second, Tick>(ans[i]) == times[i]);
+            }
+        }
+        vec<f32> out(3);
+        REQUIRE_THROWS_AS(
+            (map.convert<Tick, Second>(std::span<const i32>(sorted), std::span<f32>(out))),
+            std::invalid_argument
+        );
+    }
+
+    SECTION("Sorted runs") {
+        // many tempo changes, with times before the first one and after the last one
+        Score<Tick> dense(96);
+        for (i32 i = 0; i < 64; ++i) dense.tempos->emplace_back(i * 200, 300000 + i * 7000);
+        const TempoMap<Tick> map(dense);
+        vec<i32>             ticks;
+        for (i32 i = 0, t = -300; t < 64 * 200 + 500; t += i++ % 7 + 1) ticks.push_back(t);
+        ticks.push_back(ticks.back());
+        const auto seconds = map.convert<Tick, Second>(std::span<const i32>(ticks));
+        const auto back    = map.convert<Second, Tick>(std::span<const f32>(seconds));
+        const auto quarter = map.convert<Second, Quarter>(std::span<const f32>(seconds));
+        size_t     hint    = 0;
+        for (size_t i = 0; i < ticks.size(); ++i) {
+            REQUIRE(seconds[i] == map.convert<Tick, Second>(ticks[i], hint));
+            REQUIRE(back[i] == map.convert<Second, Tick>(seconds[i]));
+            REQUIRE(back[i] == ticks[i]);
+            REQUIRE(quarter[i] == map.convert<Second, Quarter>(seconds[i]));
+        }
+    }
+
+    SECTION("Cached on the score") {
+        Score<Tick> cached = score.deepcopy();
+        const auto  first  = cached.tempo_map();
+        REQUIRE(cached.tempo_map() == first);
+        cached.tempos->emplace_back(1920, 500000);
+        const auto second = cached.tempo_map();
+        REQUIRE(second != first);
+        REQUIRE(second->size() == 3);
+        cached.ticks_per_quarter = 960;
+        REQUIRE(cached.tempo_map() != second);
+        REQUIRE(cached.tempo_map()->convert<Tick, Second>(960) == 0.5f);
+
+        // const calls from several threads share the cache safely
+        const Score<Tick>&                shared_score = cached;
+        vec<shared<const TempoMap<Tick>>> maps(4);
+        vec<std::thread>                  threads;
+        for (auto& map : maps) {
+            threads.emplace_back([&shared_score, &map] { map = shared_score.tempo_map(); });
+        }
+        for (auto& thread : threads) thread.join();
+        for (const auto& map : maps) REQUIRE(map->convert<Tick, Second>(960) == 0.5f);
+    }
+
+    SECTION("Score conversion follows the map") {
+        auto track = std::make_shared<Track<Tick>>("piano", 0, false);
+        for (i32 i = 0; i < 16; ++i) track->notes->emplace_back(i * 300, 500, 60, 100);
+        score.tracks->push_back(track);
+        const auto map     = score.tempo_map();
+        const auto seconds = convert<Second>(score);
+        const auto& notes  = *(*seconds.tracks)[0]->notes;
+        for (size_t i = 0; i < notes.size(); ++i) {
+            const auto& note = (*track->notes)[i];
+            REQUIRE(notes[i].time == map->convert<Tick, Second>(note.time));
+            REQUIRE(std::abs(notes[i].end() - map->convert<Tick, Second>(note.end())) < 1e-6);
+        }
+        REQUIRE(convert<Tick>(seconds).tracks->front()->notes->front().duration == 500);
+    }
+}
+
+#endif   // SYMUSIC_TEST_TEMPO_MAP_HPP
@@ -0,0 +1,27 @@
+#pragma once
+#ifndef SYMUSIC_TEST_TEXT_HPP
+#define SYMUSIC_TEST_TEXT_HPP
+
+#include "symusic/utils.h"
+#include "catch2/catch_test_macros.hpp"
+using namespace symusic;
+
+TEST_CASE("Test text decoding", "[symusic][text]") {
+    auto bytes = [](const std::string_view str) {
+        return std::span(reinterpret_cast<const u8*>(str.data()), str.size());
+    };
+    details::TextDecoder decode;
+    REQUIRE(decode(bytes("la")) == "la");
+    REQUIRE(decode(bytes("")).empty());
+    // valid utf-8 is kept as it is
+    REQUIRE(decode(bytes("\xe6\xad\x8c")) == "\xe6\xad\x8c");
+    // invalid bytes are replaced, both when interned and when decoded directly
+    const std::string invalid = "a\xff" "b";
+    REQUIRE(decode(bytes(invalid)) == details::strip_non_utf_8(invalid));
+    REQUIRE(decode(bytes(invalid)) != invalid);
+    const std::string long_text = std::string(100, 'x') + invalid;
+    REQUIRE(decode(bytes(long_text)) == details::strip_non_utf_8(long_text));
+    REQUIRE(decode(bytes("la")) == "la");
+}
+
+#endif   // SYMUSIC_TEST_TEXT_HPP
@@ -0,0 +1,94 @@
+#pragma once
+#ifndef SYMUSIC_TEST_TIME_WARP_HPP
+#define SYMUSIC_TEST_TIME_WARP_HPP
+
+#include <random>
+#include "symusic.h"
+#include "catch2/catch_test_macros.hpp"
+using namespace symusic;
+
+TEST_CASE("Test time warp", "[symusic][adjust_time]") {
+    SECTION("pretty_midi semantics") {
+        Track<Tick> track("piano", 0, false);
+        track.notes->emplace_back(0, 4, 72, 72);
+        track.notes->emplace_back(4, 6, 72, 72);
+        track.notes->emplace_back(8, 4, 72, 72);
+
+        const auto shrunk = ops::adjust_time(track, {0, 4, 12}, {0, 2, 10});
+        REQUIRE(shrunk.notes->collect() == vec<Note<Tick>>{{0, 2, 72, 72}, {2, 6, 72, 72}, {6, 4, 72, 72}});
+
+        const auto stretched = ops::adjust_time(track, {2, 12}, {4, 14});
+        REQUIRE(stretched.notes->collect() == vec<Note<Tick>>{{6, 6, 72, 72}, {10, 4, 72, 72}});
+        REQUIRE(track.notes->size() == 3);
+    }
+    SECTION("Invalid anchors") {
+        REQUIRE_THROWS_AS(TimeWarp<Tick>({0, 10}, {0}), std::invalid_argument);
+        REQUIRE_THROWS_AS(TimeWarp<Tick>({0}, {0}), std::invalid_argument);
+        REQUIRE_THROWS_AS(TimeWarp<Tick>({10, 0}, {0, 10}), std::invalid_argument);
+        REQUIRE_THROWS_AS(TimeWarp<Tick>({0, 10}, {10, 0}), std::invalid_argument);
+        REQUIRE_THROWS_AS(TimeWarp<Tick>({0, 10}, {0, 20})(11), std::out_of_range);
+    }
+    SECTION("Same as binary search") {
+        std::mt19937 rng(42);
+        // a long alignment with uneven segments
+        vec<i32> original{0}, target{0};
+        for (i32 i = 0; i < 3000; ++i) {
+            original.push_back(original.back() + 1 + static_cast<i32>(rng() % 50));
+            target.push_back(target.back() + static_cast<i32>(rng() % 80));
+        }
+        const TimeWarp<Tick> warp(original, target);
+        auto reference = [&](const i32 t) {
+            const size_t k = std::lower_bound(original.begin() + 1, original.end(), t) - original.begin();
+            const f64 slope = static_cast<f64>(target[k] - target[k - 1])
+                              / static_cast<f64>(original[k] - original[k - 1]);
+            return target[k - 1] + static_cast<i32>(slope * static_cast<f64>(t - original[k - 1]));
+        };
+
+        Track<Tick> track("piano", 0, false);
+        for (i32 i = 0; i < 20000; ++i) {
+            const auto time = static_cast<i32>(rng() % (original.back() + 100)) - 50;
+            track.notes->emplace_back(time, static_cast<i32>(rng() % 200), 60, 100);
+        }
+        auto sorted = track.deepcopy();
+        sorted.sort_inplace();
+
+        for (auto* t : {&track, &sorted}) {
+            vec<Note<Tick>> expected;
+            for (const auto& note : *t->notes) {
+                if (note.time < original.front() || note.end() > original.back()) continue;
+                const i32 start = reference(note.time);
+                expected.emplace_back(start, reference(note.end()) - start, note.pitch, note.velocity);
+            }
+            warp.apply_inplace(*t);
+            REQUIRE(t->notes->collect() == expected);
+        }
+        REQUIRE(std::is_sorted(sorted.notes->begin(), sorted.notes->end(), [](const auto& a, const auto& b) {
+            return a.time < b.time;
+        }));
+        REQUIRE(warp(original[17]) == target[17]);
+    }
+    SECTION("Batch") {
+        Score<Tick> score(480);
+        score.tempos->emplace_back(0, 500000);
+        score.tempos->emplace_back(960, 250000);
+        auto track = std::make_shared<Track<Tick>>("piano", 0, false);
+        track->notes->emplace_back(480, 480, 60, 100);
+        score.tracks->push_back(track);
+
+        const TimeWarp<Quarter> check({0, 1}, {0, 2});
+        REQUIRE(check(0.5f) == 1.f);
+
+        const TimeWarp<Tick> warp({0, 960, 1920}, {0, 480, 1920});
+        vec<shared<Score<Tick>>> scores;
+        for (int i = 0; i < 3; ++i) scores.push_back(std::make_shared<Score<Tick>>(score.deepcopy()));
+        warp.apply_inplace(scores);
+        for (const auto& s : scores) {
+            REQUIRE(*s == ops::adjust_time(score, {0, 960, 1920}, {0, 480, 1920}));
+            REQUIRE((*s->tempos)[1].time == 480);
+            REQUIRE((*(*s->tracks)[0]->notes)[0] == Note<Tick>(240, 240, 60, 100));
+        }
+        REQUIRE((*score.tempos)[1].time == 960);
+    }
+}
+
+#endif   // SYMUSIC_TEST_TIME_WARP_HPP